@@ -0,0 +1,842 @@
+#include "art.h"
+
+static inline int st_art_is_leaf(void *p) {
+    return ((uintptr_t)p & 1) != 0;
+}
+
+static inline void *st_art_leaf(void *value) {
+    return (void *)((uintptr_t)value | 1);
+}
+
+static inline void *st_art_leaf_value(void *leaf) {
+    return (void *)((uintptr_t)leaf & ~(uintptr_t)1);
+}
+
+static inline st_str_t *st_art_leaf_key(st_art_t *art, void *leaf) {
+    return art->key_of(st_art_leaf_value(leaf));
+}
+
+static int st_art_key_equal(st_str_t *a, st_str_t *b) {
+    return a->len == b->len && (a->len == 0 || memcmp(a->bytes, b->bytes, a->len) == 0);
+}
+
+static ssize_t st_art_node_size(int type) {
+
+    switch (type) {
+        case ST_ART_NODE4:
+            return sizeof(st_art_node4_t);
+        case ST_ART_NODE16:
+            return sizeof(st_art_node16_t);
+        case ST_ART_NODE48:
+            return sizeof(st_art_node48_t);
+        default:
+            return sizeof(st_art_node256_t);
+    }
+}
+
+static int st_art_node_new(st_art_t *art, int type, st_art_node_t **node) {
+
+    st_art_node_t *n = NULL;
+    ssize_t size = st_art_node_size(type);
+
+    int ret = st_slab_obj_alloc(art->slab_pool, size, (void **)&n);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    memset(n, 0, size);
+    n->type = type;
+
+    *node = n;
+
+    return ST_OK;
+}
+
+static int st_art_node_free(st_art_t *art, st_art_node_t *node) {
+    return st_slab_obj_free(art->slab_pool, node);
+}
+
+static void st_art_set_prefix(st_art_node_t *node, uint8_t *bytes, uint32_t len) {
+    node->prefix_len = len;
+    memcpy(node->prefix, bytes, st_min(len, ST_ART_MAX_PREFIX_LEN));
+}
+
+/* address of the child of byte c, NULL if there is none */
+static void **st_art_find_child(st_art_node_t *node, uint8_t c) {
+
+    st_art_node4_t *n4 = (st_art_node4_t *)node;
+    st_art_node16_t *n16 = (st_art_node16_t *)node;
+    st_art_node48_t *n48 = (st_art_node48_t *)node;
+    st_art_node256_t *n256 = (st_art_node256_t *)node;
+
+    switch (node->type) {
+        case ST_ART_NODE4:
+            for (int i = 0; i < node->n_children; i++) {
+                if (n4->keys[i] == c) {
+                    return &n4->children[i];
+                }
+            }
+            return NULL;
+
+        case ST_ART_NODE16:
+            for (int i = 0; i < node->n_children; i++) {
+                if (n16->keys[i] == c) {
+                    return &n16->children[i];
+                }
+            }
+            return NULL;
+
+        case ST_ART_NODE48:
+            if (n48->index[c] == 0) {
+                return NULL;
+            }
+            return &n48->children[n48->index[c] - 1];
+
+        default:
+            if (n256->children[c] == NULL) {
+                return NULL;
+            }
+            return &n256->children[c];
+    }
+}
+
+/* address of the child of the smallest byte, and the byte is stored in c */
+static void **st_art_first_child(st_art_node_t *node, uint8_t *c) {
+
+    st_art_node4_t *n4 = (st_art_node4_t *)node;
+    st_art_node16_t *n16 = (st_art_node16_t *)node;
+    st_art_node48_t *n48 = (st_art_node48_t *)node;
+    st_art_node256_t *n256 = (st_art_node256_t *)node;
+
+    switch (node->type) {
+        case ST_ART_NODE4:
+            *c = n4->keys[0];
+            return &n4->children[0];
+
+        case ST_ART_NODE16:
+            *c = n16->keys[0];
+            return &n16->children[0];
+
+        case ST_ART_NODE48:
+            for (int i = 0; i < 256; i++) {
+                if (n48->index[i] != 0) {
+                    *c = i;
+                    return &n48->children[n48->index[i] - 1];
+                }
+            }
+            return NULL;
+
+        default:
+            for (int i = 0; i < 256; i++) {
+                if (n256->children[i] != NULL) {
+                    *c = i;
+                    return &n256->children[i];
+                }
+            }
+            return NULL;
+    }
+}
+
+/* tagged value of the smallest key in a node or a tagged value */
+static void *st_art_minimum(void *p) {
+
+    uint8_t c;
+
+    while (!st_art_is_leaf(p)) {
+        st_art_node_t *node = p;
+
+        /* key ending in node is before any key in its children */
+        if (node->end != NULL) {
+            return node->end;
+        }
+
+        p = *st_art_first_child(node, &c);
+    }
+
+    return p;
+}
+
+static int st_art_node_is_full(st_art_node_t *node) {
+
+    switch (node->type) {
+        case ST_ART_NODE4:
+            return node->n_children == 4;
+        case ST_ART_NODE16:
+            return node->n_children == 16;
+        case ST_ART_NODE48:
+            return node->n_children == 48;
+        default:
+            return 0;
+    }
+}
+
+static void st_art_sorted_add(uint8_t *keys, void **children, int n, uint8_t c, void *child) {
+
+    int i = 0;
+    while (i < n && keys[i] < c) {
+        i++;
+    }
+
+    memmove(&keys[i + 1], &keys[i], n - i);
+    memmove(&children[i + 1], &children[i], (n - i) * sizeof(void *));
+
+    keys[i] = c;
+    children[i] = child;
+}
+
+/* node must not be full */
+static void st_art_add_child_in_place(st_art_node_t *node, uint8_t c, void *child) {
+
+    st_art_node4_t *n4 = (st_art_node4_t *)node;
+    st_art_node16_t *n16 = (st_art_node16_t *)node;
+    st_art_node48_t *n48 = (st_art_node48_t *)node;
+    st_art_node256_t *n256 = (st_art_node256_t *)node;
+
+    switch (node->type) {
+        case ST_ART_NODE4:
+            st_art_sorted_add(n4->keys, n4->children, node->n_children, c, child);
+            break;
+
+        case ST_ART_NODE16:
+            st_art_sorted_add(n16->keys, n16->children, node->n_children, c, child);
+            break;
+
+        case ST_ART_NODE48: {
+            /* slots of removed children are reused */
+            int i = 0;
+            while (n48->children[i] != NULL) {
+                i++;
+            }
+
+            n48->children[i] = child;
+            n48->index[c] = i + 1;
+            break;
+        }
+
+        default:
+            n256->children[c] = child;
+            break;
+    }
+
+    node->n_children++;
+}
+
+static void st_art_remove_child_in_place(st_art_node_t *node, uint8_t c) {
+
+    st_art_node4_t *n4 = (st_art_node4_t *)node;
+    st_art_node16_t *n16 = (st_art_node16_t *)node;
+    st_art_node48_t *n48 = (st_art_node48_t *)node;
+    st_art_node256_t *n256 = (st_art_node256_t *)node;
+
+    uint8_t *keys = NULL;
+    void **children = NULL;
+    int n = node->n_children;
+
+    switch (node->type) {
+        case ST_ART_NODE4:
+            keys = n4->keys;
+            children = n4->children;
+            break;
+
+        case ST_ART_NODE16:
+            keys = n16->keys;
+            children = n16->children;
+            break;
+
+        case ST_ART_NODE48:
+            n48->children[n48->index[c] - 1] = NULL;
+            n48->index[c] = 0;
+            break;
+
+        default:
+            n256->children[c] = NULL;
+            break;
+    }
+
+    if (keys != NULL) {
+        int i = 0;
+        while (keys[i] != c) {
+            i++;
+        }
+
+        memmove(&keys[i], &keys[i + 1], n - i - 1);
+        memmove(&children[i], &children[i + 1], (n - i - 1) * sizeof(void *));
+        children[n - 1] = NULL;
+    }
+
+    node->n_children--;
+}
+
+/* copy header and children of node into a larger node */
+static void st_art_copy_to_grown(st_art_node_t *grown, st_art_node_t *node) {
+
+    st_art_node4_t *n4 = (st_art_node4_t *)node;
+    st_art_node16_t *n16 = (st_art_node16_t *)node;
+    st_art_node48_t *n48 = (st_art_node48_t *)node;
+
+    int type = grown->type;
+    memcpy(grown, node, sizeof(st_art_node_t));
+    grown->type = type;
+
+    switch (node->type) {
+        case ST_ART_NODE4: {
+            st_art_node16_t *g = (st_art_node16_t *)grown;
+
+            memcpy(g->keys, n4->keys, node->n_children);
+            memcpy(g->children, n4->children, node->n_children * sizeof(void *));
+            break;
+        }
+
+        case ST_ART_NODE16: {
+            st_art_node48_t *g = (st_art_node48_t *)grown;
+
+            for (int i = 0; i < node->n_children; i++) {
+                g->children[i] = n16->children[i];
+                g->index[n16->keys[i]] = i + 1;
+            }
+            break;
+        }
+
+        default: {
+            st_art_node256_t *g = (st_art_node256_t *)grown;
+
+            for (int i = 0; i < 256; i++) {
+                if (n48->index[i] != 0) {
+                    g->children[i] = n48->children[n48->index[i] - 1];
+                }
+            }
+            break;
+        }
+    }
+}
+
+/* add a child to node at *ref, a full node is replaced with a larger one */
+static int st_art_add_child(st_art_t *art, void **ref, st_art_node_t *node, uint8_t c,
+                            void *child) {
+
+    if (!st_art_node_is_full(node)) {
+        st_art_add_child_in_place(node, c, child);
+        art->cnt++;
+
+        return ST_OK;
+    }
+
+    st_art_node_t *grown = NULL;
+
+    int ret = st_art_node_new(art, node->type + 1, &grown);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_art_copy_to_grown(grown, node);
+    st_art_add_child_in_place(grown, c, child);
+
+    *ref = grown;
+    art->cnt++;
+
+    return st_art_node_free(art, node);
+}
+
+/* put leaf of key into node, as its end or as a child of key byte at depth */
+static void st_art_node_put(st_art_node_t *node, st_str_t *key, int64_t depth, void *leaf) {
+
+    if (key->len == depth) {
+        node->end = leaf;
+    } else {
+        st_art_add_child_in_place(node, key->bytes[depth], leaf);
+    }
+}
+
+/*
+ * count of leading prefix bytes of node equal to key bytes from depth, it
+ * stops at the end of key.
+ */
+static int64_t st_art_prefix_match(st_art_t *art, st_art_node_t *node, st_str_t *key,
+                                   int64_t depth) {
+
+    uint8_t *bytes = key->bytes + depth;
+    int64_t max = st_min((int64_t)node->prefix_len, key->len - depth);
+    int64_t i = 0;
+
+    for (; i < st_min(max, ST_ART_MAX_PREFIX_LEN); i++) {
+        if (node->prefix[i] != bytes[i]) {
+            return i;
+        }
+    }
+
+    if (i < max) {
+        /* bytes not stored are the same in any key in node */
+        st_str_t *k = st_art_leaf_key(art, st_art_minimum(node));
+        uint8_t *stored = k->bytes + depth;
+
+        for (; i < max; i++) {
+            if (stored[i] != bytes[i]) {
+                return i;
+            }
+        }
+    }
+
+    return i;
+}
+
+/* replace the leaf at *ref with a node holding both it and the new leaf */
+static int st_art_split_leaf(st_art_t *art, void **ref, st_str_t *key, int64_t depth,
+                             void *leaf) {
+
+    st_str_t *other = st_art_leaf_key(art, *ref);
+    int64_t max = st_min(key->len, other->len);
+    int64_t i = depth;
+
+    while (i < max && key->bytes[i] == other->bytes[i]) {
+        i++;
+    }
+
+    if (i == key->len && i == other->len) {
+        return ST_EXISTED;
+    }
+
+    st_art_node_t *node = NULL;
+
+    int ret = st_art_node_new(art, ST_ART_NODE4, &node);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_art_set_prefix(node, key->bytes + depth, i - depth);
+
+    st_art_node_put(node, key, i, leaf);
+    st_art_node_put(node, other, i, *ref);
+
+    *ref = node;
+    art->cnt++;
+
+    return ST_OK;
+}
+
+/*
+ * key differs from prefix of node at *ref after matched bytes, insert a node
+ * with the matched bytes as prefix above it.
+ */
+static int st_art_split_prefix(st_art_t *art, void **ref, st_art_node_t *node, st_str_t *key,
+                               int64_t depth, int64_t matched, void *leaf) {
+
+    st_art_node_t *parent = NULL;
+    uint32_t rest = node->prefix_len - matched - 1;
+    uint8_t c;
+
+    int ret = st_art_node_new(art, ST_ART_NODE4, &parent);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_art_set_prefix(parent, node->prefix, matched);
+
+    if (node->prefix_len <= ST_ART_MAX_PREFIX_LEN) {
+        c = node->prefix[matched];
+        memmove(node->prefix, node->prefix + matched + 1, rest);
+    } else {
+        st_str_t *k = st_art_leaf_key(art, st_art_minimum(node));
+        uint8_t *bytes = k->bytes + depth + matched;
+
+        c = bytes[0];
+        memcpy(node->prefix, bytes + 1, st_min(rest, ST_ART_MAX_PREFIX_LEN));
+    }
+
+    node->prefix_len = rest;
+
+    st_art_add_child_in_place(parent, c, node);
+    st_art_node_put(parent, key, depth + matched, leaf);
+
+    *ref = parent;
+    art->cnt++;
+
+    return ST_OK;
+}
+
+/*
+ * node at *ref has just lost a child or its end, merge it into what is left
+ * if it has only one entry.
+ */
+static int st_art_collapse(st_art_t *art, void **ref, st_art_node_t *node) {
+
+    if (node->n_children + (node->end != NULL) > 1) {
+        return ST_OK;
+    }
+
+    if (node->end != NULL) {
+        *ref = node->end;
+        return st_art_node_free(art, node);
+    }
+
+    uint8_t c;
+    void *child = *st_art_first_child(node, &c);
+
+    if (!st_art_is_leaf(child)) {
+        /* prefix of child becomes prefix of node, c and prefix of child */
+        st_art_node_t *cn = child;
+        uint8_t prefix[ST_ART_MAX_PREFIX_LEN];
+
+        int n = st_min(node->prefix_len, ST_ART_MAX_PREFIX_LEN);
+        memcpy(prefix, node->prefix, n);
+
+        if (n < ST_ART_MAX_PREFIX_LEN) {
+            prefix[n++] = c;
+        }
+
+        if (n < ST_ART_MAX_PREFIX_LEN) {
+            int m = st_min(cn->prefix_len, ST_ART_MAX_PREFIX_LEN - n);
+            memcpy(prefix + n, cn->prefix, m);
+            n += m;
+        }
+
+        memcpy(cn->prefix, prefix, n);
+        cn->prefix_len += node->prefix_len + 1;
+    }
+
+    *ref = child;
+
+    return st_art_node_free(art, node);
+}
+
+/*
+ * slot holding the tagged value of key, NULL if key is not found.
+ * prefix bytes not stored in nodes are checked by comparing the whole key at
+ * last. parent node of the slot is stored in parent_ref if it is not NULL.
+ */
+static void **st_art_find(st_art_t *art, st_str_t *key, void ***parent_ref, uint8_t *c) {
+
+    void **ref = &art->root;
+    void **parent = NULL;
+    int64_t depth = 0;
+
+    while (*ref != NULL && !st_art_is_leaf(*ref)) {
+        st_art_node_t *node = *ref;
+
+        if (node->prefix_len > 0) {
+            if (key->len - depth < node->prefix_len) {
+                return NULL;
+            }
+
+            int n = st_min(node->prefix_len, ST_ART_MAX_PREFIX_LEN);
+            if (memcmp(node->prefix, key->bytes + depth, n) != 0) {
+                return NULL;
+            }
+
+            depth += node->prefix_len;
+        }
+
+        parent = ref;
+
+        if (depth == key->len) {
+            ref = &node->end;
+            break;
+        }
+
+        *c = key->bytes[depth];
+
+        ref = st_art_find_child(node, *c);
+        if (ref == NULL) {
+            return NULL;
+        }
+
+        depth++;
+    }
+
+    if (*ref == NULL || !st_art_key_equal(st_art_leaf_key(art, *ref), key)) {
+        return NULL;
+    }
+
+    if (parent_ref != NULL) {
+        *parent_ref = parent;
+    }
+
+    return ref;
+}
+
+int st_art_init(st_art_t *art, st_slab_pool_t *slab_pool, st_art_key_pt key_of) {
+
+    st_must(art != NULL, ST_ARG_INVALID);
+    st_must(slab_pool != NULL, ST_ARG_INVALID);
+    st_must(key_of != NULL, ST_ARG_INVALID);
+
+    art->root = NULL;
+    art->cnt = 0;
+    art->slab_pool = slab_pool;
+    art->key_of = key_of;
+
+    return ST_OK;
+}
+
+int st_art_destroy(st_art_t *art) {
+
+    st_must(art != NULL, ST_ARG_INVALID);
+
+    void *nodes = st_art_detach(art);
+    int visited_cnt = 0;
+
+    return st_art_free_detached(art->slab_pool, &nodes, INT_MAX, &visited_cnt);
+}
+
+void *st_art_detach(st_art_t *art) {
+
+    void *root = art->root;
+
+    art->root = NULL;
+    art->cnt = 0;
+
+    if (root == NULL || st_art_is_leaf(root)) {
+        return NULL;
+    }
+
+    ((st_art_node_t *)root)->end = NULL;
+
+    return root;
+}
+
+/* push child nodes of node to the list of detached nodes */
+static void st_art_push_children(st_art_node_t *node, void **nodes) {
+
+    st_art_node4_t *n4 = (st_art_node4_t *)node;
+    st_art_node16_t *n16 = (st_art_node16_t *)node;
+    st_art_node48_t *n48 = (st_art_node48_t *)node;
+    st_art_node256_t *n256 = (st_art_node256_t *)node;
+
+    void **children = NULL;
+    int cnt = 0;
+
+    switch (node->type) {
+        case ST_ART_NODE4:
+            children = n4->children;
+            cnt = node->n_children;
+            break;
+
+        case ST_ART_NODE16:
+            children = n16->children;
+            cnt = node->n_children;
+            break;
+
+        case ST_ART_NODE48:
+            /* slots of removed children are NULL */
+            children = n48->children;
+            cnt = 48;
+            break;
+
+        default:
+            children = n256->children;
+            cnt = 256;
+            break;
+    }
+
+    for (int i = 0; i < cnt; i++) {
+        st_art_node_t *child = children[i];
+
+        if (child == NULL || st_art_is_leaf(child)) {
+            continue;
+        }
+
+        child->end = *nodes;
+        *nodes = child;
+    }
+}
+
+int st_art_free_detached(st_slab_pool_t *slab_pool, void **nodes, int max_cnt,
+                         int *visited_cnt) {
+
+    st_must(slab_pool != NULL, ST_ARG_INVALID);
+    st_must(nodes != NULL, ST_ARG_INVALID);
+    st_must(visited_cnt != NULL, ST_ARG_INVALID);
+
+    while (*nodes != NULL && *visited_cnt < max_cnt) {
+        st_art_node_t *node = *nodes;
+
+        *nodes = node->end;
+
+        st_art_push_children(node, nodes);
+
+        int ret = st_slab_obj_free(slab_pool, node);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        (*visited_cnt)++;
+    }
+
+    return ST_OK;
+}
+
+int st_art_insert(st_art_t *art, void *value) {
+
+    st_must(art != NULL, ST_ARG_INVALID);
+    st_must(value != NULL, ST_ARG_INVALID);
+    st_must(!st_art_is_leaf(value), ST_ARG_INVALID);
+
+    st_str_t *key = art->key_of(value);
+    void *leaf = st_art_leaf(value);
+    void **ref = &art->root;
+    int64_t depth = 0;
+
+    while (*ref != NULL) {
+        if (st_art_is_leaf(*ref)) {
+            return st_art_split_leaf(art, ref, key, depth, leaf);
+        }
+
+        st_art_node_t *node = *ref;
+
+        if (node->prefix_len > 0) {
+            int64_t matched = st_art_prefix_match(art, node, key, depth);
+            if (matched < node->prefix_len) {
+                return st_art_split_prefix(art, ref, node, key, depth, matched, leaf);
+            }
+
+            depth += node->prefix_len;
+        }
+
+        if (depth == key->len) {
+            if (node->end != NULL) {
+                return ST_EXISTED;
+            }
+
+            node->end = leaf;
+            art->cnt++;
+
+            return ST_OK;
+        }
+
+        void **child = st_art_find_child(node, key->bytes[depth]);
+        if (child == NULL) {
+            return st_art_add_child(art, ref, node, key->bytes[depth], leaf);
+        }
+
+        ref = child;
+        depth++;
+    }
+
+    *ref = leaf;
+    art->cnt++;
+
+    return ST_OK;
+}
+
+int st_art_replace(st_art_t *art, void *value) {
+
+    st_must(art != NULL, ST_ARG_INVALID);
+    st_must(value != NULL, ST_ARG_INVALID);
+    st_must(!st_art_is_leaf(value), ST_ARG_INVALID);
+
+    uint8_t c;
+
+    void **slot = st_art_find(art, art->key_of(value), NULL, &c);
+    if (slot == NULL) {
+        return ST_NOT_FOUND;
+    }
+
+    *slot = st_art_leaf(value);
+
+    return ST_OK;
+}
+
+int st_art_remove(st_art_t *art, st_str_t *key, void **value) {
+
+    st_must(art != NULL, ST_ARG_INVALID);
+    st_must(key != NULL, ST_ARG_INVALID);
+
+    void **parent_ref = NULL;
+    uint8_t c = 0;
+
+    void **slot = st_art_find(art, key, &parent_ref, &c);
+    if (slot == NULL) {
+        return ST_NOT_FOUND;
+    }
+
+    if (value != NULL) {
+        *value = st_art_leaf_value(*slot);
+    }
+
+    art->cnt--;
+
+    if (parent_ref == NULL) {
+        art->root = NULL;
+        return ST_OK;
+    }
+
+    st_art_node_t *parent = *parent_ref;
+
+    if (slot == &parent->end) {
+        parent->end = NULL;
+    } else {
+        st_art_remove_child_in_place(parent, c);
+    }
+
+    return st_art_collapse(art, parent_ref, parent);
+}
+
+int st_art_get(st_art_t *art, st_str_t *key, void **value) {
+
+    st_must(art != NULL, ST_ARG_INVALID);
+    st_must(key != NULL, ST_ARG_INVALID);
+    st_must(value != NULL, ST_ARG_INVALID);
+
+    uint8_t c;
+
+    void **slot = st_art_find(art, key, NULL, &c);
+    if (slot == NULL) {
+        return ST_NOT_FOUND;
+    }
+
+    *value = st_art_leaf_value(*slot);
+
+    return ST_OK;
+}
+
+int st_art_prefix_first(st_art_t *art, st_str_t *prefix, void **value) {
+
+    st_must(art != NULL, ST_ARG_INVALID);
+    st_must(prefix != NULL, ST_ARG_INVALID);
+    st_must(value != NULL, ST_ARG_INVALID);
+
+    void *p = art->root;
+    int64_t depth = 0;
+
+    while (p != NULL && !st_art_is_leaf(p)) {
+        st_art_node_t *node = p;
+
+        if (node->prefix_len > 0) {
+            int64_t n = st_min((int64_t)node->prefix_len, prefix->len - depth);
+            n = st_min(n, ST_ART_MAX_PREFIX_LEN);
+
+            if (memcmp(node->prefix, prefix->bytes + depth, n) != 0) {
+                return ST_NOT_FOUND;
+            }
+
+            depth += node->prefix_len;
+        }
+
+        /* all keys in node start with prefix, if any of them does */
+        if (depth >= prefix->len) {
+            break;
+        }
+
+        void **child = st_art_find_child(node, prefix->bytes[depth]);
+        if (child == NULL) {
+            return ST_NOT_FOUND;
+        }
+
+        p = *child;
+        depth++;
+    }
+
+    if (p == NULL) {
+        return ST_NOT_FOUND;
+    }
+
+    void *leaf = st_art_minimum(p);
+    st_str_t *k = st_art_leaf_key(art, leaf);
+
+    if (k->len < prefix->len || memcmp(k->bytes, prefix->bytes, prefix->len) != 0) {
+        return ST_NOT_FOUND;
+    }
+
+    *value = st_art_leaf_value(leaf);
+
+    return ST_OK;
+}
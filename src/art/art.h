@@ -0,0 +1,137 @@
+#ifndef _ART_H_INCLUDED_
+#define _ART_H_INCLUDED_
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "inc/err.h"
+#include "inc/log.h"
+#include "inc/util.h"
+#include "slab/slab.h"
+#include "str/str.h"
+
+/*
+ * Adaptive radix tree over key bytes, nodes are allocated from a slab pool
+ * so that it can live in shared memory like tables.
+ *
+ * A lookup visits one node per key byte, or less with path compression, and
+ * compares the full key only once at the leaf. Keys are ordered byte by byte
+ * and a key is before any longer key it is a prefix of, so all keys with a
+ * common prefix are in one subtree.
+ *
+ * Values are stored instead of keys, the key of a value is got by key_of.
+ * Values must be at least 2 bytes aligned, the lowest bit is used to tell a
+ * value from a node. Key bytes of a value must stay valid until it is removed.
+ *
+ * Nodes grow from 4 to 16, 48 and 256 children when they are full, a node
+ * is merged into its only child after removing, and is never shrunk to a
+ * smaller type, so that removing never allocates.
+ */
+
+#define ST_ART_NODE4 0
+#define ST_ART_NODE16 1
+#define ST_ART_NODE48 2
+#define ST_ART_NODE256 3
+
+/* compressed path longer than this is only partly stored in node */
+#define ST_ART_MAX_PREFIX_LEN 10
+
+typedef struct st_art_node_s st_art_node_t;
+typedef struct st_art_node4_s st_art_node4_t;
+typedef struct st_art_node16_s st_art_node16_t;
+typedef struct st_art_node48_s st_art_node48_t;
+typedef struct st_art_node256_s st_art_node256_t;
+typedef struct st_art_s st_art_t;
+typedef st_str_t *(*st_art_key_pt)(void *value);
+
+struct st_art_node_s {
+    uint8_t type;
+    uint16_t n_children;
+
+    /*
+     * bytes shared by all keys in node after the byte leading to it. only the
+     * first ST_ART_MAX_PREFIX_LEN bytes are stored, the rest are read from
+     * any key in node.
+     */
+    uint32_t prefix_len;
+    uint8_t prefix[ST_ART_MAX_PREFIX_LEN];
+
+    /* tagged value whose key ends right after prefix, NULL if no such key */
+    void *end;
+};
+
+/* children are tagged values or nodes, keys are sorted */
+struct st_art_node4_s {
+    st_art_node_t node;
+    uint8_t keys[4];
+    void *children[4];
+};
+
+struct st_art_node16_s {
+    st_art_node_t node;
+    uint8_t keys[16];
+    void *children[16];
+};
+
+/* child of byte c is children[index[c] - 1], index[c] is 0 if there is none */
+struct st_art_node48_s {
+    st_art_node_t node;
+    uint8_t index[256];
+    void *children[48];
+};
+
+struct st_art_node256_s {
+    st_art_node_t node;
+    void *children[256];
+};
+
+struct st_art_s {
+    /* a tagged value or a node, NULL if tree is empty */
+    void *root;
+    int64_t cnt;
+
+    st_slab_pool_t *slab_pool;
+    st_art_key_pt key_of;
+};
+
+int st_art_init(st_art_t *art, st_slab_pool_t *slab_pool, st_art_key_pt key_of);
+
+/* free all nodes, values and their keys are not touched */
+int st_art_destroy(st_art_t *art);
+
+/*
+ * detach all nodes, tree is empty after it. nodes are linked in a list by
+ * their end field and returned, NULL if there is no node. values and their
+ * keys are not touched any more, so values can be freed before nodes.
+ */
+void *st_art_detach(st_art_t *art);
+
+/*
+ * free detached nodes in *nodes till visited_cnt reaches max_cnt, one is
+ * added to visited_cnt for every node freed. *nodes is NULL after all are freed.
+ */
+int st_art_free_detached(st_slab_pool_t *slab_pool, void **nodes, int max_cnt,
+                         int *visited_cnt);
+
+/* return ST_EXISTED if a value of an equal key is in tree */
+int st_art_insert(st_art_t *art, void *value);
+
+/* replace the value of an equal key, return ST_NOT_FOUND if there is none */
+int st_art_replace(st_art_t *art, void *value);
+
+/* removed value is stored in value if it is not NULL */
+int st_art_remove(st_art_t *art, st_str_t *key, void **value);
+
+int st_art_get(st_art_t *art, st_str_t *key, void **value);
+
+/*
+ * get the value of the smallest key starting with prefix, return
+ * ST_NOT_FOUND if no key starts with it.
+ */
+int st_art_prefix_first(st_art_t *art, st_str_t *prefix, void **value);
+
+static inline int st_art_is_empty(st_art_t *art) {
+    return art->root == NULL;
+}
+
+#endif /* _ART_H_INCLUDED_ */
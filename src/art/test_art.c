@@ -0,0 +1,361 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "unittest/unittest.h"
+#include "art.h"
+
+#define TEST_ART_SHM_FN "art_shm_fn"
+#define TEST_ART_SHM_SIZE (1024 * 1024 * 64)
+#define TEST_ART_REGION_CNT 8
+
+typedef struct {
+    void *base;
+    int shm_fd;
+    st_slab_pool_t *slab_pool;
+} setup_info_t;
+
+typedef struct {
+    st_str_t key;
+    uint8_t bytes[64];
+    int in_tree;
+} test_value_t;
+
+static void art_setup(setup_info_t *info) {
+
+    int ret = st_region_shm_create(TEST_ART_SHM_FN, TEST_ART_SHM_SIZE,
+                                   &info->base, &info->shm_fd);
+    st_assert(ret == ST_OK);
+
+    ssize_t page_size = st_page_size();
+    info->slab_pool = (st_slab_pool_t *)info->base;
+
+    void *data = (void *)st_align((uintptr_t)info->base + sizeof(*info->slab_pool), page_size);
+    ssize_t data_len = TEST_ART_SHM_SIZE - ((uintptr_t)data - (uintptr_t)info->base);
+
+    ret = st_region_init(&info->slab_pool->page_pool.region_cb, data,
+                         data_len / page_size / TEST_ART_REGION_CNT,
+                         TEST_ART_REGION_CNT, 0);
+    st_assert(ret == ST_OK);
+
+    ret = st_pagepool_init(&info->slab_pool->page_pool, page_size);
+    st_assert(ret == ST_OK);
+
+    ret = st_slab_pool_init(info->slab_pool);
+    st_assert(ret == ST_OK);
+}
+
+static void art_cleanup(setup_info_t *info) {
+
+    st_assert(st_slab_pool_destroy(info->slab_pool) == ST_OK);
+    st_assert(st_pagepool_destroy(&info->slab_pool->page_pool) == ST_OK);
+    st_assert(st_region_destroy(&info->slab_pool->page_pool.region_cb) == ST_OK);
+
+    st_assert(st_region_shm_destroy(info->shm_fd, TEST_ART_SHM_FN, info->base,
+                                    TEST_ART_SHM_SIZE) == ST_OK);
+}
+
+static st_str_t *value_key(void *value) {
+    return &((test_value_t *)value)->key;
+}
+
+static void set_key(test_value_t *v, const char *bytes, int64_t len) {
+
+    memcpy(v->bytes, bytes, len);
+    v->key = (st_str_t)st_str_wrap(v->bytes, len);
+    v->in_tree = 0;
+}
+
+/*
+ * keys share long common parts, so that compressed paths are longer than
+ * what a node stores, and some keys are prefixes of others.
+ */
+static void random_key(test_value_t *v) {
+
+    static const char *dirs[] = {
+        "",
+        "/",
+        "/bucket/",
+        "/bucket/foo/",
+        "/bucket/foo/bar-with-a-long-name/",
+        "/bucket/fop/",
+        "/other-bucket-with-a-long-name/x/",
+    };
+
+    char buf[64];
+    const char *dir = dirs[random() % st_nelts(dirs)];
+    int64_t len = strlen(dir);
+
+    memcpy(buf, dir, len);
+
+    int suffix_len = random() % 6;
+    for (int i = 0; i < suffix_len; i++) {
+        buf[len++] = "ab/\xff"[random() % 4];
+    }
+
+    set_key(v, buf, len);
+}
+
+static int has_prefix(st_str_t *key, st_str_t *prefix) {
+    return key->len >= prefix->len && memcmp(key->bytes, prefix->bytes, prefix->len) == 0;
+}
+
+/* smallest key in tree starting with prefix by scanning all values */
+static test_value_t *scan_prefix_first(test_value_t *values, int n, st_str_t *prefix) {
+
+    test_value_t *first = NULL;
+
+    for (int i = 0; i < n; i++) {
+        if (!values[i].in_tree || !has_prefix(&values[i].key, prefix)) {
+            continue;
+        }
+
+        if (first == NULL || st_str_cmp(&values[i].key, &first->key) < 0) {
+            first = &values[i];
+        }
+    }
+
+    return first;
+}
+
+static void check_values(st_art_t *art, test_value_t *values, int n) {
+
+    void *got;
+    int64_t cnt = 0;
+
+    for (int i = 0; i < n; i++) {
+        int ret = st_art_get(art, &values[i].key, &got);
+
+        if (values[i].in_tree) {
+            st_ut_eq(ST_OK, ret, "key %d", i);
+            st_ut_eq(&values[i], got, "key %d", i);
+            cnt++;
+        } else if (ret == ST_OK) {
+            // another value of the same key is in tree.
+            st_ut_eq(0, st_str_cmp(&values[i].key, value_key(got)), "key %d", i);
+        }
+    }
+
+    st_ut_eq(cnt, art->cnt, "");
+
+    const char *prefixes[] = {
+        "", "/", "/b", "/bucket/", "/bucket/foo", "/bucket/foo/", "/bucket/foo/bar",
+        "/bucket/foo/bar-with-a-long-name/a", "/bucket/fo", "/bucket/fop/b",
+        "/other-bucket-with-a-long-name/x/", "/other-bucket-with-a-long-nam", "/other-bucket-X",
+        "a", "\xff", "/\xff", "/bucket/foo/bar-with-a-long-name/\xff\xff\xff",
+    };
+
+    for (int i = 0; i < st_nelts(prefixes); i++) {
+        st_str_t prefix = st_str_wrap((uint8_t *)prefixes[i], strlen(prefixes[i]));
+        test_value_t *expected = scan_prefix_first(values, n, &prefix);
+
+        int ret = st_art_prefix_first(art, &prefix, &got);
+
+        if (expected == NULL) {
+            st_ut_eq(ST_NOT_FOUND, ret, "prefix %s", prefixes[i]);
+        } else {
+            st_ut_eq(ST_OK, ret, "prefix %s", prefixes[i]);
+            st_ut_eq(expected, got, "prefix %s", prefixes[i]);
+        }
+    }
+}
+
+st_test(art, init) {
+
+    st_art_t art;
+    setup_info_t info;
+
+    art_setup(&info);
+
+    st_ut_eq(ST_ARG_INVALID, st_art_init(NULL, info.slab_pool, value_key), "");
+    st_ut_eq(ST_ARG_INVALID, st_art_init(&art, NULL, value_key), "");
+    st_ut_eq(ST_ARG_INVALID, st_art_init(&art, info.slab_pool, NULL), "");
+
+    st_ut_eq(ST_OK, st_art_init(&art, info.slab_pool, value_key), "");
+    st_ut_eq(1, st_art_is_empty(&art), "");
+    st_ut_eq(0, art.cnt, "");
+
+    test_value_t v;
+    void *got;
+    set_key(&v, "foo", 3);
+
+    st_ut_eq(ST_NOT_FOUND, st_art_get(&art, &v.key, &got), "");
+    st_ut_eq(ST_NOT_FOUND, st_art_prefix_first(&art, &v.key, &got), "");
+    st_ut_eq(ST_NOT_FOUND, st_art_remove(&art, &v.key, NULL), "");
+    st_ut_eq(ST_NOT_FOUND, st_art_replace(&art, &v), "");
+
+    // the lowest bit of value is used as tag.
+    st_ut_eq(ST_ARG_INVALID, st_art_insert(&art, (uint8_t *)&v + 1), "");
+
+    st_ut_eq(ST_OK, st_art_destroy(&art), "");
+
+    art_cleanup(&info);
+}
+
+st_test(art, insert_get_remove) {
+
+    st_art_t art;
+    setup_info_t info;
+    void *got;
+
+    int n = 3000;
+    test_value_t *values = malloc(sizeof(test_value_t) * (n + 256));
+
+    art_setup(&info);
+    st_art_init(&art, info.slab_pool, value_key);
+
+    for (int i = 0; i < n; i++) {
+        random_key(&values[i]);
+
+        int ret = st_art_insert(&art, &values[i]);
+        if (ret == ST_EXISTED) {
+            st_ut_eq(ST_OK, st_art_get(&art, &values[i].key, &got), "");
+            st_ut_ne(&values[i], got, "");
+            continue;
+        }
+
+        st_ut_eq(ST_OK, ret, "");
+        values[i].in_tree = 1;
+    }
+
+    // children of every byte grow a node to the largest type.
+    for (int i = 0; i < 256; i++) {
+        char buf[] = {'/', 'b', 'u', 'c', 'k', 'e', 't', '/', i};
+
+        set_key(&values[n + i], buf, sizeof(buf));
+
+        int ret = st_art_insert(&art, &values[n + i]);
+        values[n + i].in_tree = ret == ST_OK;
+    }
+
+    n += 256;
+
+    check_values(&art, values, n);
+
+    for (int i = 0; i < n; i++) {
+        if (!values[i].in_tree) {
+            continue;
+        }
+
+        test_value_t v = values[i];
+
+        st_ut_eq(ST_OK, st_art_replace(&art, &v), "");
+        st_ut_eq(ST_OK, st_art_get(&art, &values[i].key, &got), "");
+        st_ut_eq(&v, got, "");
+
+        st_ut_eq(ST_OK, st_art_replace(&art, &values[i]), "");
+    }
+
+    // remove in random order, check after every some removals.
+    for (int i = 0; i < n; i++) {
+        int j = random() % n;
+
+        if (!values[j].in_tree) {
+            continue;
+        }
+
+        st_ut_eq(ST_OK, st_art_remove(&art, &values[j].key, &got), "");
+        st_ut_eq(&values[j], got, "");
+        st_ut_eq(ST_NOT_FOUND, st_art_remove(&art, &values[j].key, &got), "");
+
+        values[j].in_tree = 0;
+
+        if (i % 300 == 0) {
+            check_values(&art, values, n);
+        }
+    }
+
+    check_values(&art, values, n);
+
+    // what is left is freed by destroy.
+    st_ut_ne(0, art.cnt, "");
+    st_ut_eq(ST_OK, st_art_destroy(&art), "");
+    st_ut_eq(1, st_art_is_empty(&art), "");
+    st_ut_eq(0, art.cnt, "");
+
+    free(values);
+
+    art_cleanup(&info);
+}
+
+static ssize_t alloc_cnt(st_slab_pool_t *slab_pool) {
+
+    ssize_t cnt = 0;
+
+    for (int i = 0; i < ST_SLAB_GROUP_CNT; i++) {
+        cnt += slab_pool->groups[i].stat.current.alloc.cnt;
+    }
+
+    return cnt;
+}
+
+st_test(art, detach) {
+
+    st_art_t art;
+    setup_info_t info;
+    void *got;
+
+    int n = 3000;
+    test_value_t *values = malloc(sizeof(test_value_t) * (n + 256));
+
+    art_setup(&info);
+    st_art_init(&art, info.slab_pool, value_key);
+
+    // a tree of a single value has no node.
+    set_key(&values[0], "foo", 3);
+    st_ut_eq(ST_OK, st_art_insert(&art, &values[0]), "");
+    st_ut_eq(NULL, st_art_detach(&art), "");
+    st_ut_eq(1, st_art_is_empty(&art), "");
+
+    for (int i = 0; i < n; i++) {
+        random_key(&values[i]);
+        (void)st_art_insert(&art, &values[i]);
+    }
+
+    for (int i = 0; i < 256; i++) {
+        char buf[] = {'/', 'b', 'u', 'c', 'k', 'e', 't', '/', i};
+
+        set_key(&values[n + i], buf, sizeof(buf));
+        (void)st_art_insert(&art, &values[n + i]);
+    }
+
+    ssize_t node_cnt = alloc_cnt(info.slab_pool);
+    st_ut_gt(node_cnt, 0, "");
+
+    void *nodes = st_art_detach(&art);
+    st_ut_ne(NULL, nodes, "");
+    st_ut_eq(1, st_art_is_empty(&art), "");
+    st_ut_eq(0, art.cnt, "");
+    st_ut_eq(ST_NOT_FOUND, st_art_get(&art, &values[0].key, &got), "");
+
+    // keys are not read when freeing nodes, values may be gone already.
+    memset(values, 0, sizeof(test_value_t) * (n + 256));
+
+    int steps = 0;
+    ssize_t freed = 0;
+
+    while (nodes != NULL) {
+        int visited_cnt = 0;
+
+        st_ut_eq(ST_OK, st_art_free_detached(info.slab_pool, &nodes, 16, &visited_cnt), "");
+        st_ut_le(visited_cnt, 16, "");
+
+        freed += visited_cnt;
+        steps++;
+    }
+
+    st_ut_eq(node_cnt, freed, "");
+    st_ut_eq(0, alloc_cnt(info.slab_pool), "");
+    st_ut_gt(steps, 1, "");
+
+    // detached tree can be used again.
+    set_key(&values[0], "foo", 3);
+    st_ut_eq(ST_OK, st_art_insert(&art, &values[0]), "");
+    st_ut_eq(ST_OK, st_art_get(&art, &values[0].key, &got), "");
+    st_ut_eq(ST_OK, st_art_destroy(&art), "");
+
+    free(values);
+
+    art_cleanup(&info);
+}
+
+st_ut_main;
@@ -48,6 +48,8 @@
 #define st_atomic_incr(p, val, ...) __atomic_add_fetch(p, val, st_atomic_default_(, ## __VA_ARGS__))
 #define st_atomic_decr(p, val, ...) __atomic_sub_fetch(p, val, st_atomic_default_(, ## __VA_ARGS__))
 
+#define st_atomic_fence(order) __atomic_thread_fence(order)
+
 #define st_atomic_cas(p, expected_p, val, ...) \
         __atomic_compare_exchange_n((p), (expected_p), (val), \
                                     0, st_atomic_default2_(, ##__VA_ARGS__))
@@ -163,7 +163,9 @@ st_capi_foreach(st_table_t *table,
                 st_capi_foreach_cb_t foreach_cb,
                 void *args)
 {
-    st_robustlock_lock(&table->lock);
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_rdlock_all(table, slots);
 
     int ret = st_capi_foreach_nolock(table,
                                      init_key,
@@ -171,12 +173,49 @@ st_capi_foreach(st_table_t *table,
                                      foreach_cb,
                                      args);
 
-    st_robustlock_unlock(&table->lock);
+    st_table_rdunlock_all(table, slots);
 
     return ret;
 }
 
 
+int
+st_capi_foreach_snapshot(st_table_t *table,
+                         st_capi_foreach_cb_t foreach_cb,
+                         void *args)
+{
+    st_must(foreach_cb != NULL, ST_ARG_INVALID);
+
+    st_tvalue_t         key;
+    st_tvalue_t         value;
+    st_table_snapshot_t snapshot;
+
+    int ret = st_table_snapshot_init(table, &snapshot);
+    if (ret != ST_OK) {
+        derr("failed to init snapshot: %d", ret);
+
+        return ret;
+    }
+
+    while (1) {
+        ret = st_table_snapshot_next(&snapshot, &key, &value);
+        if (ret != ST_OK) {
+            break;
+        }
+
+        ret = foreach_cb(&key, &value, args);
+        if (ret != ST_OK) {
+            break;
+        }
+    }
+
+    int err = st_table_snapshot_destroy(&snapshot);
+    st_assert_ok(err, "failed to destroy snapshot");
+
+    return (ret == ST_ITER_FINISH ? ST_OK : ret);
+}
+
+
 /** called only by master process */
 static int
 st_capi_do_clean_dead_proot(int max_num, int clean_self, int *cleaned)
@@ -208,6 +247,12 @@ st_capi_do_clean_dead_proot(int max_num, int clean_self, int *cleaned)
             ret = st_capi_remove_gc_root(pstate->lib_state, pstate->proot);
             st_assert_ok(ret, "failed to remove gc root: %d", pstate->pid);
 
+            /** lock free read sections left by the dead process */
+            if (pstate != process_state) {
+                ret = st_table_reader_clean(&lib_state->table_pool, pstate->pid);
+                st_assert_ok(ret, "failed to clean reader: %d", pstate->pid);
+            }
+
             ret = st_slab_obj_free(&lib_state->table_pool.slab_pool, pstate);
             st_assert_ok(ret, "failed to free process state to slab");
 
@@ -566,6 +611,188 @@ st_capi_do_add(st_table_t *table, st_tvalue_t key, st_tvalue_t value, int force)
 }
 
 
+int
+st_capi_set_many(st_table_t *table,
+                 st_tvalue_t *keys,
+                 st_tvalue_t *values,
+                 int64_t cnt)
+{
+    st_assert_nonull(table);
+    st_assert_nonull(keys);
+    st_assert_nonull(values);
+
+    for (int64_t i = 0; i < cnt; i++) {
+        st_assert(keys[i].type != ST_TYPES_TABLE);
+    }
+
+    int ret = st_table_set_many(table, keys, values, cnt);
+    if (ret != ST_OK) {
+        dd("failed to set many key values: %d", ret);
+
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+
+int
+st_capi_txn_begin(st_capi_txn_t *txn)
+{
+    st_assert_nonull(process_state);
+    st_assert_nonull(txn);
+
+    return st_table_txn_init(&process_state->lib_state->table_pool, txn);
+}
+
+
+int
+st_capi_do_txn_set(st_capi_txn_t *txn,
+                   st_table_t *table,
+                   st_tvalue_t key,
+                   st_tvalue_t value)
+{
+    st_assert_nonull(txn);
+    st_assert_nonull(table);
+    st_assert(key.type != ST_TYPES_TABLE);
+
+    int ret = st_table_txn_set(txn, table, key, value);
+    if (ret != ST_OK) {
+        dd("failed to add set to transaction: %d", ret);
+
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+
+int
+st_capi_do_txn_remove(st_capi_txn_t *txn, st_table_t *table, st_tvalue_t key)
+{
+    st_assert_nonull(txn);
+    st_assert_nonull(table);
+    st_assert_nonull(key.bytes);
+    st_assert(key.type != ST_TYPES_TABLE);
+
+    int ret = st_table_txn_remove(txn, table, key);
+    if (ret != ST_OK) {
+        dd("failed to add remove to transaction: %d", ret);
+
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+
+int
+st_capi_txn_commit(st_capi_txn_t *txn)
+{
+    st_assert_nonull(txn);
+
+    int ret = st_table_txn_commit(txn);
+    if (ret != ST_OK) {
+        derr("failed to commit transaction: %d", ret);
+    }
+
+    int err = st_table_txn_destroy(txn);
+    st_assert_ok(err, "failed to destroy transaction");
+
+    return ret;
+}
+
+
+int
+st_capi_txn_abort(st_capi_txn_t *txn)
+{
+    st_assert_nonull(txn);
+
+    return st_table_txn_destroy(txn);
+}
+
+
+int
+st_capi_do_cas(st_table_t *table,
+               st_tvalue_t key,
+               st_tvalue_t expected,
+               st_tvalue_t value)
+{
+    st_assert_nonull(table);
+    st_assert(key.type != ST_TYPES_TABLE);
+
+    int ret = st_table_cas(table, key, expected, value);
+    if (ret != ST_OK) {
+        dd("failed to cas key value: %d", ret);
+
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+
+int
+st_capi_do_set_if_version(st_table_t *table,
+                          st_tvalue_t key,
+                          st_tvalue_t value,
+                          int64_t version)
+{
+    st_assert_nonull(table);
+    st_assert(key.type != ST_TYPES_TABLE);
+
+    int ret = st_table_set_if_version(table, key, value, version);
+    if (ret != ST_OK) {
+        dd("failed to set key value if version: %d", ret);
+
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+
+int
+st_capi_do_incr(st_table_t *table,
+                st_tvalue_t key,
+                st_tvalue_t delta,
+                void *new_value)
+{
+    st_assert_nonull(table);
+    st_assert(key.type != ST_TYPES_TABLE);
+
+    int ret = st_table_incr(table, key, delta, new_value);
+    if (ret != ST_OK) {
+        dd("failed to incr value: %d", ret);
+
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+
+/** set a non-table value which expires ttl_usec microseconds later */
+int
+st_capi_do_set_ex(st_table_t *table,
+                  st_tvalue_t key,
+                  st_tvalue_t value,
+                  int64_t ttl_usec)
+{
+    st_assert_nonull(table);
+    st_assert(key.type != ST_TYPES_TABLE);
+
+    int ret = st_table_set_key_value_ex(table, key, value, ttl_usec);
+    if (ret != ST_OK) {
+        derr("failed to set value with ttl: %d", ret);
+
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+
 int
 st_capi_do_remove_key(st_table_t *table, st_tvalue_t key)
 {
@@ -676,11 +903,20 @@ st_capi_get_groot(st_tvalue_t *ret_val)
 }
 
 
-int
-st_capi_new(st_tvalue_t *ret_val)
+/** shard_cnt is 0 for a normal table */
+static int
+st_capi_new_table(int64_t shard_cnt, st_tvalue_t *ret_val)
 {
+    st_table_pool_t *pool = &process_state->lib_state->table_pool;
     st_table_t *table = NULL;
-    int ret = st_table_new(&process_state->lib_state->table_pool, &table);
+    int ret;
+
+    if (shard_cnt == 0) {
+        ret = st_table_new(pool, &table);
+    } else {
+        ret = st_table_new_sharded(pool, shard_cnt, &table);
+    }
+
     if (ret != ST_OK) {
         derr("failed to create table: %d", ret);
 
@@ -701,6 +937,20 @@ st_capi_new(st_tvalue_t *ret_val)
 }
 
 
+int
+st_capi_new(st_tvalue_t *ret_val)
+{
+    return st_capi_new_table(0, ret_val);
+}
+
+
+int
+st_capi_new_sharded(int64_t shard_cnt, st_tvalue_t *ret_val)
+{
+    return st_capi_new_table(shard_cnt, ret_val);
+}
+
+
 int
 st_capi_free(st_tvalue_t *value)
 {
@@ -732,10 +982,19 @@ st_capi_do_get(st_table_t *table, st_tvalue_t key, st_tvalue_t *ret_val)
     st_assert_nonull(key.bytes);
     st_assert(key.type != ST_TYPES_TABLE);
 
-    st_robustlock_lock(&table->lock);
+    /** try to copy value without lock first */
+    int ret = st_table_get_value_copy(table, key, ret_val);
+    if (ret != ST_AGAIN) {
+        return ret;
+    }
+
+    /** only the shard holding key is locked for a sharded table */
+    st_table_t *shard = st_table_shard_of(table, key);
+
+    int slot = st_robustrwlock_rdlock(&shard->lock);
 
     st_tvalue_t value;
-    int ret = st_table_get_value(table, key, &value);
+    ret = st_table_get_value(shard, key, &value);
     if (ret != ST_OK) {
         dd("failed to get table value: %d", ret);
 
@@ -745,7 +1004,266 @@ st_capi_do_get(st_table_t *table, st_tvalue_t key, st_tvalue_t *ret_val)
     ret = st_capi_copy_out_tvalue(ret_val, &value);
 
 quit:
-    st_robustlock_unlock(&table->lock);
+    st_robustrwlock_rdunlock(&shard->lock, slot);
+
+    return ret;
+}
+
+
+int
+st_capi_get_path(st_table_t *table,
+                 st_tvalue_t *keys,
+                 int64_t cnt,
+                 st_tvalue_t *ret_val)
+{
+    st_assert_nonull(table);
+    st_assert_nonull(keys);
+    st_assert_nonull(ret_val);
+    st_assert(cnt > 0);
+
+    for (int64_t i = 0; i < cnt; i++) {
+        st_assert_nonull(keys[i].bytes);
+        st_assert(keys[i].type != ST_TYPES_TABLE);
+    }
+
+    if (cnt == 1) {
+        return st_capi_do_get(table, keys[0], ret_val);
+    }
+
+    /**
+     * table whose lock was busy, it is referenced in proot to keep it from
+     * being freed while no lock is held.
+     */
+    st_tvalue_t pinned = st_str_null;
+
+    st_table_t *shard = st_table_shard_of(table, keys[0]);
+    int slot = st_robustrwlock_rdlock(&shard->lock);
+
+    st_tvalue_t value;
+    int ret;
+
+    for (int64_t i = 0; ; i++) {
+
+        ret = st_table_get_value(shard, keys[i], &value);
+        if (ret != ST_OK) {
+            dd("failed to get table value of path: %ld, %d", i, ret);
+
+            goto quit;
+        }
+
+        if (i == cnt - 1) {
+            ret = st_capi_copy_out_tvalue(ret_val, &value);
+
+            goto quit;
+        }
+
+        if (!st_types_is_table(value.type)) {
+            ret = ST_NOT_FOUND;
+
+            goto quit;
+        }
+
+        st_table_t *next = st_table_get_table_addr_from_value(value);
+        next = st_table_shard_of(next, keys[i + 1]);
+
+        /** a table may be a value of itself */
+        if (next == shard) {
+            continue;
+        }
+
+        /**
+         * the current lock keeps next referenced until next is locked.
+         * never wait for a lock with another one held, it would deadlock
+         * with writers locking tables in other order, such as transactions.
+         */
+        int next_slot;
+        if (st_robustrwlock_tryrdlock(&next->lock, &next_slot) == ST_OK) {
+            st_robustrwlock_rdunlock(&shard->lock, slot);
+
+            shard = next;
+            slot = next_slot;
+
+            continue;
+        }
+
+        /** next is busy, reference it in proot and wait for it unlocked */
+        st_tvalue_t next_pinned;
+        ret = st_capi_copy_out_tvalue(&next_pinned, &value);
+        if (ret != ST_OK) {
+            goto quit;
+        }
+
+        st_robustrwlock_rdunlock(&shard->lock, slot);
+
+        if (pinned.bytes != NULL) {
+            st_assert_ok(st_capi_free(&pinned), "failed to free pinned table");
+        }
+        pinned = next_pinned;
+
+        shard = next;
+        slot = st_robustrwlock_rdlock(&shard->lock);
+    }
+
+quit:
+    st_robustrwlock_rdunlock(&shard->lock, slot);
+
+    if (pinned.bytes != NULL) {
+        st_assert_ok(st_capi_free(&pinned), "failed to free pinned table");
+    }
+
+    return ret;
+}
+
+
+int
+st_capi_do_set_path(st_table_t *table,
+                    st_tvalue_t *keys,
+                    int64_t cnt,
+                    st_tvalue_t value)
+{
+    st_assert_nonull(table);
+    st_assert_nonull(keys);
+    st_assert(cnt > 0);
+
+    if (cnt == 1) {
+        return st_capi_do_add(table, keys[0], value, 1);
+    }
+
+    /**
+     * table is not locked while it is being set, so the table to set is
+     * referenced in proot by getting it.
+     */
+    st_tvalue_t tbl_val;
+    int ret = st_capi_get_path(table, keys, cnt - 1, &tbl_val);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (!st_types_is_table(tbl_val.type)) {
+        ret = ST_NOT_FOUND;
+
+        goto quit;
+    }
+
+    ret = st_capi_do_add(st_table_get_table_addr_from_value(tbl_val),
+                         keys[cnt - 1],
+                         value,
+                         1);
+
+quit:
+    st_assert_ok(st_capi_free(&tbl_val), "failed to free table value");
+
+    return ret;
+}
+
+
+int
+st_capi_borrow_begin(st_capi_borrow_t *guard)
+{
+    st_assert_nonull(process_state);
+    st_assert_nonull(guard);
+
+    return st_table_borrow_begin(&process_state->lib_state->table_pool, guard);
+}
+
+
+int
+st_capi_do_borrow(st_table_t *table,
+                  st_tvalue_t key,
+                  st_capi_borrow_t *guard,
+                  st_tvalue_t *ret_val)
+{
+    st_assert_nonull(table);
+    st_assert_nonull(guard);
+    st_assert_nonull(ret_val);
+    st_assert_nonull(key.bytes);
+    st_assert(key.type != ST_TYPES_TABLE);
+
+    int ret = st_table_borrow_value(guard, table, key, ret_val);
+    if (ret != ST_OK) {
+        dd("failed to borrow table value: %d", ret);
+    }
+
+    return ret;
+}
+
+
+int
+st_capi_borrow_end(st_capi_borrow_t *guard)
+{
+    st_assert_nonull(guard);
+
+    return st_table_borrow_end(guard);
+}
+
+
+int
+st_capi_get_many(st_table_t *table,
+                 st_tvalue_t *keys,
+                 int64_t cnt,
+                 st_tvalue_t *ret_vals,
+                 uint8_t *buf,
+                 int64_t *buf_size)
+{
+    st_assert_nonull(table);
+    st_assert_nonull(keys);
+    st_assert_nonull(ret_vals);
+    st_assert_nonull(buf_size);
+    st_assert(buf != NULL || *buf_size == 0);
+
+    int64_t capacity = *buf_size;
+    int64_t used     = 0;
+    int ret          = ST_OK;
+
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_rdlock_all(table, slots);
+
+    for (int64_t i = 0; i < cnt; i++) {
+        st_assert_nonull(keys[i].bytes);
+        st_assert(keys[i].type != ST_TYPES_TABLE);
+
+        st_tvalue_t value;
+        ret_vals[i] = (st_tvalue_t)st_str_null;
+
+        int rc = st_table_get_value(table, keys[i], &value);
+        if (rc == ST_NOT_FOUND) {
+            continue;
+        }
+
+        if (rc != ST_OK) {
+            ret = rc;
+            break;
+        }
+
+        /** table reference in proot needs a value owned by caller */
+        if (st_types_is_table(value.type)) {
+            ret = ST_UNSUPPORTED;
+            break;
+        }
+
+        int64_t size = st_align(value.capacity, sizeof(uint64_t));
+
+        /** go on counting the size needed, but stop copying */
+        if (used + size > capacity) {
+            used += size;
+            ret = ST_BUF_NOT_ENOUGH;
+            continue;
+        }
+
+        st_memcpy(buf + used, value.bytes, value.capacity);
+
+        ret_vals[i] = (st_tvalue_t)st_str_wrap_(value.type,
+                                                value.len,
+                                                value.capacity,
+                                                0,
+                                                buf + used);
+        used += size;
+    }
+
+    st_table_rdunlock_all(table, slots);
+
+    *buf_size = used;
 
     return ret;
 }
@@ -762,7 +1280,13 @@ st_capi_init_iterator(st_tvalue_t *tbl_val,
 
     st_table_t *table = st_table_get_table_addr_from_value(*tbl_val);
 
-    st_robustlock_lock(&table->lock);
+    iter->resumable = 0;
+    iter->seek_key  = (st_tvalue_t)st_str_null;
+    iter->seek_side = expected_side;
+
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_rdlock_all(table, slots);
 
     int ret = st_table_iter_init(table,
                                  &iter->iterator,
@@ -775,12 +1299,91 @@ st_capi_init_iterator(st_tvalue_t *tbl_val,
     ret = st_capi_copy_out_tvalue(&iter->table, tbl_val);
 
 quit:
-    st_robustlock_unlock(&table->lock);
+    st_table_rdunlock_all(table, slots);
 
     return ret;
 }
 
 
+int
+st_capi_init_cursor(st_tvalue_t *tbl_val,
+                    st_capi_iter_t *iter,
+                    st_tvalue_t *init_key,
+                    int expected_side)
+{
+    int ret = st_capi_init_iterator(tbl_val, iter, init_key, expected_side);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (init_key != NULL) {
+        ret = st_str_copy(&iter->seek_key, init_key);
+        if (ret != ST_OK) {
+            derr("failed to copy init key: %d", ret);
+
+            st_assert(st_capi_free(&iter->table) == ST_OK);
+
+            return ret;
+        }
+    }
+
+    iter->resumable = 1;
+
+    return ST_OK;
+}
+
+
+/**
+ * lock table before use the function.
+ * resumable iterator re-seeks if table modified, but seek key is not updated.
+ */
+static int
+st_capi_iter_next_nolock(st_table_t *table,
+                         st_capi_iter_t *iter,
+                         st_tvalue_t *key,
+                         st_tvalue_t *value)
+{
+    int ret = st_table_iter_next(table, &iter->iterator, key, value);
+    if (ret != ST_TABLE_MODIFIED || !iter->resumable) {
+        return ret;
+    }
+
+    /** start from the key after the last returned one */
+    st_tvalue_t *seek_key = iter->seek_key.bytes == NULL ? NULL : &iter->seek_key;
+
+    ret = st_table_iter_init(table, &iter->iterator, seek_key, iter->seek_side);
+    if (ret != ST_OK) {
+        derr("failed to re-seek iterator: %d", ret);
+
+        return ret;
+    }
+
+    return st_table_iter_next(table, &iter->iterator, key, value);
+}
+
+
+/** remember key as the last returned one of resumable iterator */
+static int
+st_capi_iter_save_seek_key(st_capi_iter_t *iter, st_tvalue_t *key)
+{
+    st_tvalue_t seek_key = st_str_null;
+
+    int ret = st_str_copy(&seek_key, key);
+    if (ret != ST_OK) {
+        derr("failed to copy seek key: %d", ret);
+
+        return ret;
+    }
+
+    st_str_destroy(&iter->seek_key);
+
+    iter->seek_key  = seek_key;
+    iter->seek_side = ST_SIDE_RIGHT;
+
+    return ST_OK;
+}
+
+
 int
 st_capi_next(st_capi_iter_t *iter, st_tvalue_t *ret_key, st_tvalue_t *ret_value)
 {
@@ -790,12 +1393,18 @@ st_capi_next(st_capi_iter_t *iter, st_tvalue_t *ret_key, st_tvalue_t *ret_value)
 
     st_table_t *table = st_table_get_table_addr_from_value(iter->table);
 
-    st_robustlock_lock(&table->lock);
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_rdlock_all(table, slots);
 
     st_tvalue_t key;
     st_tvalue_t value;
 
-    int ret = st_table_iter_next(table, &iter->iterator, &key, &value);
+    int ret = st_capi_iter_next_nolock(table, iter, &key, &value);
+    if (ret == ST_OK && iter->resumable) {
+        ret = st_capi_iter_save_seek_key(iter, &key);
+    }
+
     if (ret == ST_OK) {
         ret = st_capi_copy_out_tvalue(ret_key, &key);
         if (ret != ST_OK) {
@@ -809,7 +1418,104 @@ st_capi_next(st_capi_iter_t *iter, st_tvalue_t *ret_key, st_tvalue_t *ret_value)
     }
 
 quit:
-    st_robustlock_unlock(&table->lock);
+    st_table_rdunlock_all(table, slots);
+
+    return ret;
+}
+
+
+int
+st_capi_next_batch(st_capi_iter_t *iter,
+                   st_tvalue_t *ret_keys,
+                   st_tvalue_t *ret_values,
+                   int64_t n,
+                   uint8_t *buf,
+                   int64_t *buf_size,
+                   int64_t *cnt)
+{
+    st_assert_nonull(iter);
+    st_assert_nonull(ret_keys);
+    st_assert_nonull(ret_values);
+    st_assert_nonull(buf_size);
+    st_assert_nonull(cnt);
+    st_assert(buf != NULL || *buf_size == 0);
+    st_assert(n > 0);
+
+    st_table_t *table = st_table_get_table_addr_from_value(iter->table);
+
+    int64_t capacity = *buf_size;
+    int64_t used     = 0;
+    int64_t got      = 0;
+    int ret          = ST_OK;
+
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_rdlock_all(table, slots);
+
+    while (got < n) {
+        st_tvalue_t key;
+        st_tvalue_t value;
+
+        /** restored if the entry is not returned in this batch */
+        st_table_iter_t saved = iter->iterator;
+
+        ret = st_capi_iter_next_nolock(table, iter, &key, &value);
+        if (ret != ST_OK) {
+            break;
+        }
+
+        /** table reference in proot needs a value owned by caller */
+        if (st_types_is_table(value.type)) {
+            iter->iterator = saved;
+            ret = ST_UNSUPPORTED;
+            break;
+        }
+
+        int64_t key_size   = st_align(key.capacity, sizeof(uint64_t));
+        int64_t value_size = st_align(value.capacity, sizeof(uint64_t));
+
+        if (used + key_size + value_size > capacity) {
+            iter->iterator = saved;
+            ret = ST_BUF_NOT_ENOUGH;
+
+            if (got == 0) {
+                used = key_size + value_size;
+            }
+
+            break;
+        }
+
+        st_memcpy(buf + used, key.bytes, key.capacity);
+        ret_keys[got] = (st_tvalue_t)st_str_wrap_(key.type,
+                                                  key.len,
+                                                  key.capacity,
+                                                  0,
+                                                  buf + used);
+        used += key_size;
+
+        st_memcpy(buf + used, value.bytes, value.capacity);
+        ret_values[got] = (st_tvalue_t)st_str_wrap_(value.type,
+                                                    value.len,
+                                                    value.capacity,
+                                                    0,
+                                                    buf + used);
+        used += value_size;
+
+        got++;
+    }
+
+    if (got > 0) {
+        ret = ST_OK;
+
+        if (iter->resumable) {
+            ret = st_capi_iter_save_seek_key(iter, &ret_keys[got - 1]);
+        }
+    }
+
+    st_table_rdunlock_all(table, slots);
+
+    *buf_size = used;
+    *cnt      = got;
 
     return ret;
 }
@@ -820,5 +1526,7 @@ st_capi_free_iterator(st_capi_iter_t *iter)
 {
     st_assert_nonull(iter);
 
+    st_str_destroy(&iter->seek_key);
+
     return st_capi_free(&iter->table);
 }
@@ -34,6 +34,8 @@
 
 
 typedef st_str_t                 st_tvalue_t;
+typedef st_table_borrow_t        st_capi_borrow_t;
+typedef st_table_txn_t           st_capi_txn_t;
 typedef struct st_capi_s         st_capi_t;
 typedef struct st_capi_iter_s    st_capi_iter_t;
 typedef struct st_capi_process_s st_capi_process_t;
@@ -43,6 +45,12 @@ struct st_capi_iter_s {
     /** use table.bytes as a unique key in proot */
     st_tvalue_t     table;
     st_table_iter_t iterator;
+
+    /** cursor re-seeks from seek_key instead of failing if table modified */
+    int             resumable;
+    /** the last returned key, or init key before any key returned */
+    st_tvalue_t     seek_key;
+    int             seek_side;
 };
 
 typedef enum st_capi_init_state_e {
@@ -120,6 +128,12 @@ st_tvalue_t st_capi_init_tvalue(void *caddr, st_types_t type, ssize_t size);
  */
 int st_capi_new(st_tvalue_t *ret_val);
 
+/**
+ * like st_capi_new, but keys of the table are split into shard_cnt shards
+ * locked independently, see st_table_new_sharded.
+ */
+int st_capi_new_sharded(int64_t shard_cnt, st_tvalue_t *ret_val);
+
 int st_capi_free(st_tvalue_t *value);
 
 #define st_capi_set(table, key, value)         \
@@ -139,6 +153,124 @@ int st_capi_do_add(st_table_t *table,
                    st_tvalue_t value,
                    int force);
 
+/**
+ * set cnt keys and values with table locked only once.
+ * if a later key is the same as a former one, the later value is set.
+ */
+int st_capi_set_many(st_table_t *table,
+                     st_tvalue_t *keys,
+                     st_tvalue_t *values,
+                     int64_t cnt);
+
+/**
+ * apply sets and removes of keys in one or more tables atomically:
+ *
+ *     st_capi_txn_t txn;
+ *     st_capi_txn_begin(&txn);
+ *     st_capi_txn_set(&txn, t1, key1, value1);
+ *     st_capi_txn_remove(&txn, t2, key2);
+ *     ret = st_capi_txn_commit(&txn);
+ *
+ * keys and values are copied when added, nothing is locked until commit.
+ * commit locks tables in the order of their addresses, so it never deadlocks,
+ * and does gc work of all table values with gc locked only once.
+ * txn is ended by st_capi_txn_commit or st_capi_txn_abort.
+ */
+int st_capi_txn_begin(st_capi_txn_t *txn);
+
+#define st_capi_txn_set(txn, table, key, value)        \
+    st_capi_do_txn_set((txn),                          \
+                       (table),                        \
+                       st_capi_make_tvalue(key),       \
+                       st_capi_make_tvalue(value))
+
+int st_capi_do_txn_set(st_capi_txn_t *txn,
+                       st_table_t *table,
+                       st_tvalue_t key,
+                       st_tvalue_t value);
+
+#define st_capi_txn_remove(txn, table, key) \
+    st_capi_do_txn_remove((txn), (table), st_capi_make_tvalue(key))
+
+int st_capi_do_txn_remove(st_capi_txn_t *txn, st_table_t *table, st_tvalue_t key);
+
+int st_capi_txn_commit(st_capi_txn_t *txn);
+
+/** discard all mutations added */
+int st_capi_txn_abort(st_capi_txn_t *txn);
+
+/**
+ * set value only if current value of key is expected, or return ST_NOT_EQUAL.
+ * use st_capi_cas_absent to set value only if key does not exist.
+ */
+#define st_capi_cas(table, key, expected, value)      \
+    st_capi_do_cas((table),                           \
+                   st_capi_make_tvalue(key),          \
+                   st_capi_make_tvalue(expected),     \
+                   st_capi_make_tvalue(value))
+
+#define st_capi_cas_absent(table, key, value)         \
+    st_capi_do_cas((table),                           \
+                   st_capi_make_tvalue(key),          \
+                   (st_tvalue_t)st_str_null,          \
+                   st_capi_make_tvalue(value))
+
+int st_capi_do_cas(st_table_t *table,
+                   st_tvalue_t key,
+                   st_tvalue_t expected,
+                   st_tvalue_t value);
+
+/**
+ * set value only if table is not modified since version is got by
+ * st_capi_get_version, or return ST_TABLE_MODIFIED.
+ * it is used for optimistic read-modify-write on several keys:
+ *
+ *     int64_t version = st_capi_get_version(table);
+ *     ... st_capi_get keys and compute value ...
+ *     ret = st_capi_set_if_version(table, key, value, version);
+ *     if ret is ST_TABLE_MODIFIED, retry from beginning.
+ */
+#define st_capi_get_version(table) st_table_get_version(table)
+
+#define st_capi_set_if_version(table, key, value, version) \
+    st_capi_do_set_if_version((table),                     \
+                              st_capi_make_tvalue(key),    \
+                              st_capi_make_tvalue(value),  \
+                              (version))
+
+int st_capi_do_set_if_version(st_table_t *table,
+                              st_tvalue_t key,
+                              st_tvalue_t value,
+                              int64_t version);
+
+/**
+ * add delta to the value of key atomically, key is added with delta as value
+ * if it does not exist.
+ * delta must be int, uint64_t or double, and new_value_ptr must be NULL or
+ * point to a variable of the same type to receive the result.
+ */
+#define st_capi_incr(table, key, delta, new_value_ptr) \
+    st_capi_do_incr((table),                           \
+                    st_capi_make_tvalue(key),          \
+                    st_capi_make_tvalue(delta),        \
+                    (new_value_ptr))
+
+int st_capi_do_incr(st_table_t *table,
+                    st_tvalue_t key,
+                    st_tvalue_t delta,
+                    void *new_value);
+
+#define st_capi_set_ex(table, key, value, ttl_usec) \
+    st_capi_do_set_ex((table),                      \
+                      st_capi_make_tvalue(key),     \
+                      st_capi_make_tvalue(value),   \
+                      (ttl_usec))
+
+int st_capi_do_set_ex(st_table_t *table,
+                      st_tvalue_t key,
+                      st_tvalue_t value,
+                      int64_t ttl_usec);
+
 /**
  * here, we copy tvalue.
  * ret_val.bytes is allocated by st_malloc() in st_str_copy(),
@@ -149,6 +281,84 @@ int st_capi_do_add(st_table_t *table,
 
 int st_capi_do_get(st_table_t *table, st_tvalue_t key, st_tvalue_t *ret_val);
 
+/**
+ * get value of keys[cnt - 1] in the table reached by following keys[0] to
+ * keys[cnt - 2] from table, like table[k0][k1]...[kn] in lua.
+ * ret_val is copied out like st_capi_get.
+ *
+ * intermediate tables are read locked hand over hand, so they are not
+ * copied out or referenced in proot, only the lock of the next table is
+ * taken before the lock of the current one is released.
+ *
+ * return ST_NOT_FOUND if any key is not found, or any value but the last
+ * one is not a table.
+ */
+int st_capi_get_path(st_table_t *table,
+                     st_tvalue_t *keys,
+                     int64_t cnt,
+                     st_tvalue_t *ret_val);
+
+/**
+ * set value of keys[cnt - 1] in the table reached like st_capi_get_path, the
+ * table is referenced in proot only once while it is being set.
+ */
+#define st_capi_set_path(table, keys, cnt, value) \
+    st_capi_do_set_path((table), (keys), (cnt), st_capi_make_tvalue(value))
+
+int st_capi_do_set_path(st_table_t *table,
+                        st_tvalue_t *keys,
+                        int64_t cnt,
+                        st_tvalue_t value);
+
+/**
+ * get value without copying it out, ret_val.bytes points into shared memory
+ * and stays valid until guard is released, nothing need to be freed:
+ *
+ *     st_capi_borrow_t guard;
+ *     st_capi_borrow_begin(&guard);
+ *     ret = st_capi_borrow(table, key, &guard, &tval);
+ *     ... read tval.bytes ...
+ *     st_capi_borrow_end(&guard);
+ *
+ * one guard can be used for several values of any table. while a guard is
+ * held, elements removed from tables it borrowed from are not freed and
+ * their values are not overwritten in place, so do not hold it long. it
+ * returns ST_AGAIN if too many tables are pinned by guards and snapshots, or
+ * all reader slots are owned by other processes.
+ *
+ * table value is not supported, use st_capi_get to get it.
+ */
+int st_capi_borrow_begin(st_capi_borrow_t *guard);
+
+#define st_capi_borrow(table, key, guard, tval_ptr) \
+    st_capi_do_borrow((table), st_capi_make_tvalue(key), (guard), (tval_ptr))
+
+int st_capi_do_borrow(st_table_t *table,
+                      st_tvalue_t key,
+                      st_capi_borrow_t *guard,
+                      st_tvalue_t *ret_val);
+
+int st_capi_borrow_end(st_capi_borrow_t *guard);
+
+/**
+ * get cnt values with table locked only once.
+ * value bytes are copied into buf one after another, each is 8 bytes aligned,
+ * and ret_vals[i].bytes points into buf, so nothing need to be freed.
+ * ret_vals[i] is set to st_str_null if keys[i] is not found.
+ *
+ * buf_size is the size of buf when called, and it is set to the size used.
+ * if buf is not enough, return ST_BUF_NOT_ENOUGH and buf_size is set to the
+ * size needed for all values.
+ *
+ * table value is not supported, use st_capi_get to get it.
+ */
+int st_capi_get_many(st_table_t *table,
+                     st_tvalue_t *keys,
+                     int64_t cnt,
+                     st_tvalue_t *ret_vals,
+                     uint8_t *buf,
+                     int64_t *buf_size);
+
 #define st_capi_remove_key(table, key) \
     st_capi_do_remove_key((table), st_capi_make_tvalue(key))
 
@@ -164,6 +374,15 @@ int st_capi_foreach(st_table_t *table,
                     st_capi_foreach_cb_t foreach_cb,
                     void *args);
 
+/**
+ * iterate a snapshot of table, table is locked only in short batches while
+ * taking the snapshot, so foreach_cb may take long without blocking writers.
+ * table value passed to foreach_cb must not be visited without locking.
+ */
+int st_capi_foreach_snapshot(st_table_t *table,
+                             st_capi_foreach_cb_t foreach_cb,
+                             void *args);
+
 int st_capi_clean_dead_proot(int max_num, int *cleaned);
 
 int st_capi_init_iterator(st_tvalue_t *tbl_val,
@@ -171,10 +390,43 @@ int st_capi_init_iterator(st_tvalue_t *tbl_val,
                           st_tvalue_t *init_key,
                           int expected_side);
 
+/**
+ * init a resumable iterator, st_capi_next never returns ST_TABLE_MODIFIED
+ * for it, but continues from the key after the last returned one. keys added
+ * before the last returned one after it is returned are not iterated.
+ */
+int st_capi_init_cursor(st_tvalue_t *tbl_val,
+                        st_capi_iter_t *iter,
+                        st_tvalue_t *init_key,
+                        int expected_side);
+
 int st_capi_next(st_capi_iter_t *iter,
                  st_tvalue_t *ret_key,
                  st_tvalue_t *ret_value);
 
+/**
+ * get up to n entries with table locked only once.
+ * keys and values are copied into buf like st_capi_get_many, cnt is set to
+ * the count of entries got and buf_size is set to the size used.
+ *
+ * if buf is not enough for the next entry, it stops there. if no entry is got,
+ * return ST_BUF_NOT_ENOUGH and buf_size is set to the size needed for the next
+ * entry.
+ *
+ * table value is not supported, it stops before an entry with table value,
+ * if it is the next entry, return ST_UNSUPPORTED and st_capi_next should be
+ * used to get it.
+ *
+ * return ST_ITER_FINISH if no entry is left.
+ */
+int st_capi_next_batch(st_capi_iter_t *iter,
+                       st_tvalue_t *ret_keys,
+                       st_tvalue_t *ret_values,
+                       int64_t n,
+                       uint8_t *buf,
+                       int64_t *buf_size,
+                       int64_t *cnt);
+
 int st_capi_free_iterator(st_capi_iter_t *iter);
 
 int st_capi_get_groot(st_tvalue_t *ret_val);
@@ -705,6 +705,512 @@ st_test(st_capi, set_add_get_remove_key)
 }
 
 
+st_test(st_capi, set_get_many)
+{
+    st_capi_prepare_ut();
+
+    st_capi_process_t *pstate = st_capi_get_process_state();
+
+    st_table_t *root = NULL;
+    st_table_new(&pstate->lib_state->table_pool, &root);
+
+    int int_keys[4] = {1, 2, 3, 4};
+    int int_vals[4] = {10, 20, 30, 40};
+    char *str_val   = "hello world";
+
+    st_tvalue_t keys[5];
+    st_tvalue_t values[4];
+    st_tvalue_t ret_vals[5];
+
+    for (int i = 0; i < 4; i++) {
+        keys[i]   = st_capi_make_tvalue(int_keys[i]);
+        values[i] = st_capi_make_tvalue(int_vals[i]);
+    }
+    values[3] = st_capi_make_tvalue(str_val, strlen(str_val));
+
+    int ret = st_capi_set_many(root, keys, values, 4);
+    st_ut_eq(ST_OK, ret, "failed to set many");
+    st_ut_eq(4, root->element_cnt, "wrong element count");
+
+    /** key 100 is not found */
+    int not_found_key = 100;
+    keys[4] = st_capi_make_tvalue(not_found_key);
+
+    uint8_t buf[64];
+    int64_t buf_size = sizeof(buf);
+
+    ret = st_capi_get_many(root, keys, 5, ret_vals, buf, &buf_size);
+    st_ut_eq(ST_OK, ret, "failed to get many");
+    st_ut_eq(8 * 3 + 16, buf_size, "wrong buf size used");
+
+    for (int i = 0; i < 3; i++) {
+        st_ut_eq(ST_TYPES_INTEGER, ret_vals[i].type, "wrong value type");
+        st_ut_eq(int_vals[i], *(int *)ret_vals[i].bytes, "wrong value");
+        st_ut_eq(buf + i * 8, ret_vals[i].bytes, "value not in buf");
+    }
+
+    st_ut_eq(ST_TYPES_STRING, ret_vals[3].type, "wrong value type");
+    st_ut_eq(strlen(str_val), ret_vals[3].len, "wrong value len");
+    st_ut_eq(0,
+             memcmp(str_val, ret_vals[3].bytes, ret_vals[3].len),
+             "wrong value");
+
+    st_ut_eq(NULL, ret_vals[4].bytes, "not found value must be null");
+
+    /** buf is not enough, the size needed is returned */
+    buf_size = 20;
+    ret = st_capi_get_many(root, keys, 5, ret_vals, buf, &buf_size);
+    st_ut_eq(ST_BUF_NOT_ENOUGH, ret, "buf must be not enough");
+    st_ut_eq(8 * 3 + 16, buf_size, "wrong buf size needed");
+    st_ut_eq(int_vals[1], *(int *)ret_vals[1].bytes, "wrong value");
+    st_ut_eq(NULL, ret_vals[3].bytes, "value not copied must be null");
+
+    /** table value is not supported */
+    st_tvalue_t tbl_val;
+    ret = st_capi_new(&tbl_val);
+    st_ut_eq(ST_OK, ret, "failed to new table");
+
+    ret = st_capi_set_many(root, &keys[0], &tbl_val, 1);
+    st_ut_eq(ST_OK, ret, "failed to set table value");
+
+    buf_size = sizeof(buf);
+    ret = st_capi_get_many(root, keys, 1, ret_vals, buf, &buf_size);
+    st_ut_eq(ST_UNSUPPORTED, ret, "table value is not supported");
+
+    st_ut_eq(ST_OK, st_capi_free(&tbl_val), "failed to free table value");
+
+    st_table_remove_all(root);
+    st_table_free(root);
+
+    st_capi_tear_down_ut();
+}
+
+
+st_test(st_capi, path)
+{
+    st_capi_prepare_ut();
+
+    st_capi_process_t *pstate = st_capi_get_process_state();
+    st_table_t *proot = pstate->proot;
+
+    st_table_t *root = NULL;
+    st_table_new(&pstate->lib_state->table_pool, &root);
+
+    /** root["a"]["b"] is a table, root["a"][2] is a number */
+    char *key_a = "a";
+    char *key_b = "b";
+    int key_num = 2;
+    int key_c   = 3;
+    int num     = 100;
+    int c_val   = 300;
+
+    st_tvalue_t tbl_a;
+    st_tvalue_t tbl_b;
+    st_ut_eq(ST_OK, st_capi_new(&tbl_a), "failed to new table");
+    st_ut_eq(ST_OK, st_capi_new(&tbl_b), "failed to new table");
+
+    int ret = st_capi_do_add(root, st_capi_make_tvalue(key_a), tbl_a, 1);
+    st_ut_eq(ST_OK, ret, "failed to set table value");
+
+    st_table_t *a = st_table_get_table_addr_from_value(tbl_a);
+    st_table_t *b = st_table_get_table_addr_from_value(tbl_b);
+
+    ret = st_capi_do_add(a, st_capi_make_tvalue(key_b), tbl_b, 1);
+    st_ut_eq(ST_OK, ret, "failed to set table value");
+
+    ret = st_capi_set(a, key_num, num);
+    st_ut_eq(ST_OK, ret, "failed to set value");
+
+    st_tvalue_t keys[] = {
+        st_capi_make_tvalue(key_a),
+        st_capi_make_tvalue(key_b),
+        st_capi_make_tvalue(key_c),
+    };
+
+    int64_t proot_cnt = proot->element_cnt;
+
+    ret = st_capi_set_path(root, keys, 3, c_val);
+    st_ut_eq(ST_OK, ret, "failed to set value by path");
+    st_ut_eq(proot_cnt, proot->element_cnt, "table ref left in proot");
+
+    st_tvalue_t value = st_str_null;
+    ret = st_capi_get(b, key_c, &value);
+    st_ut_eq(ST_OK, ret, "failed to get value");
+    st_ut_eq(300, *(int *)value.bytes, "wrong value");
+    st_capi_free(&value);
+
+    ret = st_capi_get_path(root, keys, 3, &value);
+    st_ut_eq(ST_OK, ret, "failed to get value by path");
+    st_ut_eq(300, *(int *)value.bytes, "wrong value");
+    st_ut_eq(proot_cnt, proot->element_cnt, "table ref left in proot");
+    st_capi_free(&value);
+
+    /** last value is a table, it is copied out like st_capi_get */
+    ret = st_capi_get_path(root, keys, 2, &value);
+    st_ut_eq(ST_OK, ret, "failed to get table by path");
+    st_ut_eq(b, st_table_get_table_addr_from_value(value), "wrong table");
+    st_ut_eq(proot_cnt + 1, proot->element_cnt, "table ref not in proot");
+    st_capi_free(&value);
+
+    /** a table in path whose lock is busy is waited for */
+    int pid = fork();
+    if (pid == 0) {
+        st_robustrwlock_wrlock(&b->lock);
+        usleep(200 * 1000);
+        st_robustrwlock_wrunlock(&b->lock);
+        exit(0);
+    }
+
+    usleep(50 * 1000);
+
+    ret = st_capi_get_path(root, keys, 3, &value);
+    st_ut_eq(ST_OK, ret, "failed to get value by path");
+    st_ut_eq(300, *(int *)value.bytes, "wrong value");
+    st_ut_eq(proot_cnt, proot->element_cnt, "table ref left in proot");
+    st_capi_free(&value);
+
+    waitpid(pid, &ret, 0);
+    st_ut_eq(ST_OK, ret, "failed to lock table in child");
+
+    /** not found */
+    st_tvalue_t no_keys[] = {
+        st_capi_make_tvalue(key_a),
+        st_capi_make_tvalue(key_c),
+        st_capi_make_tvalue(key_c),
+    };
+
+    ret = st_capi_get_path(root, no_keys, 3, &value);
+    st_ut_eq(ST_NOT_FOUND, ret, "key must not be found");
+
+    ret = st_capi_set_path(root, no_keys, 3, c_val);
+    st_ut_eq(ST_NOT_FOUND, ret, "key must not be found");
+
+    /** value in path is not a table */
+    st_tvalue_t num_keys[] = {
+        st_capi_make_tvalue(key_a),
+        st_capi_make_tvalue(key_num),
+        st_capi_make_tvalue(key_c),
+    };
+
+    ret = st_capi_get_path(root, num_keys, 3, &value);
+    st_ut_eq(ST_NOT_FOUND, ret, "number is not a table");
+
+    ret = st_capi_set_path(root, num_keys, 3, c_val);
+    st_ut_eq(ST_NOT_FOUND, ret, "number is not a table");
+    st_ut_eq(proot_cnt, proot->element_cnt, "table ref left in proot");
+
+    st_ut_eq(ST_OK, st_capi_free(&tbl_a), "failed to free table value");
+    st_ut_eq(ST_OK, st_capi_free(&tbl_b), "failed to free table value");
+
+    st_table_remove_all(root);
+    st_table_free(root);
+
+    st_capi_tear_down_ut();
+}
+
+
+st_test(st_capi, borrow)
+{
+    st_capi_prepare_ut();
+
+    st_capi_process_t *pstate = st_capi_get_process_state();
+
+    st_table_t *root = NULL;
+    st_table_new(&pstate->lib_state->table_pool, &root);
+
+    int key       = 1;
+    char *str_val = "hello world";
+    char *new_val = "hello again";
+
+    int ret = st_capi_do_add(root,
+                             st_capi_make_tvalue(key),
+                             st_capi_make_tvalue(str_val, strlen(str_val)),
+                             1);
+    st_ut_eq(ST_OK, ret, "failed to set value");
+
+    st_capi_borrow_t guard;
+    st_tvalue_t value = st_str_null;
+
+    ret = st_capi_borrow_begin(&guard);
+    st_ut_eq(ST_OK, ret, "failed to begin borrowing");
+
+    ret = st_capi_borrow(root, key, &guard, &value);
+    st_ut_eq(ST_OK, ret, "failed to borrow value");
+    st_ut_eq(ST_TYPES_STRING, value.type, "wrong value type");
+    st_ut_eq(strlen(str_val), value.len, "wrong value len");
+    st_ut_eq(0, memcmp(str_val, value.bytes, value.len), "wrong value");
+
+    /** borrowed value is not changed by writers until guard is released */
+    ret = st_capi_do_add(root,
+                         st_capi_make_tvalue(key),
+                         st_capi_make_tvalue(new_val, strlen(new_val)),
+                         1);
+    st_ut_eq(ST_OK, ret, "failed to set value");
+    st_ut_eq(0, memcmp(str_val, value.bytes, value.len), "borrowed value changed");
+
+    st_tvalue_t new_value = st_str_null;
+    ret = st_capi_borrow(root, key, &guard, &new_value);
+    st_ut_eq(ST_OK, ret, "failed to borrow value");
+    st_ut_eq(0, memcmp(new_val, new_value.bytes, new_value.len), "wrong value");
+
+    int not_found_key = 100;
+    ret = st_capi_borrow(root, not_found_key, &guard, &value);
+    st_ut_eq(ST_NOT_FOUND, ret, "key must not be found");
+
+    /** table value is not supported */
+    st_tvalue_t tbl_val;
+    ret = st_capi_new(&tbl_val);
+    st_ut_eq(ST_OK, ret, "failed to new table");
+
+    ret = st_capi_do_add(root, st_capi_make_tvalue(not_found_key), tbl_val, 1);
+    st_ut_eq(ST_OK, ret, "failed to set table value");
+
+    ret = st_capi_borrow(root, not_found_key, &guard, &value);
+    st_ut_eq(ST_UNSUPPORTED, ret, "table value is not supported");
+
+    ret = st_capi_borrow_end(&guard);
+    st_ut_eq(ST_OK, ret, "failed to end borrowing");
+    st_ut_eq(0, guard.pin_cnt, "guard not released");
+    st_ut_eq(0, root->pin, "table not unpinned");
+
+    st_ut_eq(ST_OK, st_capi_free(&tbl_val), "failed to free table value");
+
+    st_table_remove_all(root);
+    st_table_free(root);
+
+    st_capi_tear_down_ut();
+}
+
+
+st_test(st_capi, txn)
+{
+    st_capi_prepare_ut();
+
+    st_capi_process_t *pstate = st_capi_get_process_state();
+
+    st_table_t *t1 = NULL;
+    st_table_t *t2 = NULL;
+    st_table_new(&pstate->lib_state->table_pool, &t1);
+    st_table_new(&pstate->lib_state->table_pool, &t2);
+
+    int key   = 1;
+    int value = 10;
+
+    int ret = st_capi_set(t1, key, value);
+    st_ut_eq(ST_OK, ret, "failed to set value");
+
+    st_capi_txn_t txn;
+    ret = st_capi_txn_begin(&txn);
+    st_ut_eq(ST_OK, ret, "failed to begin transaction");
+
+    /** value is copied when added */
+    value = 20;
+    ret = st_capi_txn_set(&txn, t2, key, value);
+    st_ut_eq(ST_OK, ret, "failed to add set");
+    value = 30;
+
+    ret = st_capi_txn_remove(&txn, t1, key);
+    st_ut_eq(ST_OK, ret, "failed to add remove");
+
+    /** table value */
+    st_tvalue_t tbl_val;
+    ret = st_capi_new(&tbl_val);
+    st_ut_eq(ST_OK, ret, "failed to new table");
+
+    char *tbl_key = "table";
+    ret = st_capi_do_txn_set(&txn, t1, st_capi_make_tvalue(tbl_key), tbl_val);
+    st_ut_eq(ST_OK, ret, "failed to add set of table value");
+
+    st_ut_eq(1, t1->element_cnt, "nothing is applied before commit");
+    st_ut_eq(0, t2->element_cnt, "nothing is applied before commit");
+
+    ret = st_capi_txn_commit(&txn);
+    st_ut_eq(ST_OK, ret, "failed to commit transaction");
+    st_ut_eq(NULL, txn.ops, "transaction is not ended");
+
+    st_tvalue_t check_value = st_str_null;
+    ret = st_capi_get(t2, key, &check_value);
+    st_ut_eq(ST_OK, ret, "failed to get value");
+    st_ut_eq(20, *(int *)check_value.bytes, "wrong value");
+    st_capi_free(&check_value);
+
+    ret = st_capi_get(t1, key, &check_value);
+    st_ut_eq(ST_NOT_FOUND, ret, "key must be removed");
+
+    st_ut_eq(1, t1->table_value_cnt, "table value is not set");
+
+    /** aborted transaction changes nothing */
+    ret = st_capi_txn_begin(&txn);
+    st_ut_eq(ST_OK, ret, "failed to begin transaction");
+
+    ret = st_capi_txn_set(&txn, t1, key, value);
+    st_ut_eq(ST_OK, ret, "failed to add set");
+
+    ret = st_capi_txn_abort(&txn);
+    st_ut_eq(ST_OK, ret, "failed to abort transaction");
+
+    ret = st_capi_get(t1, key, &check_value);
+    st_ut_eq(ST_NOT_FOUND, ret, "aborted set must not be applied");
+
+    st_ut_eq(ST_OK, st_capi_free(&tbl_val), "failed to free table value");
+
+    st_table_remove_all(t1);
+    st_table_remove_all(t2);
+    st_table_free(t1);
+    st_table_free(t2);
+
+    st_capi_tear_down_ut();
+}
+
+
+st_test(st_capi, incr)
+{
+    st_capi_prepare_ut();
+
+    st_capi_process_t *pstate = st_capi_get_process_state();
+
+    st_table_t *root = NULL;
+    st_table_new(&pstate->lib_state->table_pool, &root);
+
+    int key       = 1;
+    int delta     = 10;
+    int new_value = 0;
+
+    int ret = st_capi_incr(root, key, delta, &new_value);
+    st_ut_eq(ST_OK, ret, "failed to incr int value");
+    st_ut_eq(10, new_value, "wrong new value");
+
+    delta = -3;
+    ret = st_capi_incr(root, key, delta, &new_value);
+    st_ut_eq(ST_OK, ret, "failed to decr int value");
+    st_ut_eq(7, new_value, "wrong new value");
+
+    double number_delta = 1.0;
+    double number_value = 0;
+    ret = st_capi_incr(root, key, number_delta, &number_value);
+    st_ut_eq(ST_STATE_INVALID, ret, "value type must be the same as delta");
+
+    char *str_key       = "bytes";
+    uint64_t u64_delta  = 1024;
+    uint64_t u64_value  = 0;
+    ret = st_capi_incr(root, str_key, u64_delta, &u64_value);
+    st_ut_eq(ST_OK, ret, "failed to incr u64 value");
+    st_ut_eq(1024, u64_value, "wrong new value");
+
+    st_tvalue_t check_value = st_str_null;
+    ret = st_capi_get(root, key, &check_value);
+    st_ut_eq(ST_OK, ret, "failed to get int value");
+    st_ut_eq(7, *(int *)check_value.bytes, "wrong value");
+    st_capi_free(&check_value);
+
+    st_table_remove_all(root);
+    st_table_free(root);
+
+    st_capi_tear_down_ut();
+}
+
+
+st_test(st_capi, cas_and_set_if_version)
+{
+    st_capi_prepare_ut();
+
+    st_capi_process_t *pstate = st_capi_get_process_state();
+
+    st_table_t *root = NULL;
+    st_table_new(&pstate->lib_state->table_pool, &root);
+
+    int key      = 1;
+    int value    = 10;
+    int expected = 10;
+
+    int ret = st_capi_cas_absent(root, key, value);
+    st_ut_eq(ST_OK, ret, "failed to set absent key");
+
+    ret = st_capi_cas_absent(root, key, value);
+    st_ut_eq(ST_NOT_EQUAL, ret, "key already exists");
+
+    value = 20;
+    ret = st_capi_cas(root, key, expected, value);
+    st_ut_eq(ST_OK, ret, "failed to cas value");
+
+    ret = st_capi_cas(root, key, expected, value);
+    st_ut_eq(ST_NOT_EQUAL, ret, "value is not expected any more");
+
+    int64_t version = st_capi_get_version(root);
+
+    value = 30;
+    ret = st_capi_set_if_version(root, key, value, version);
+    st_ut_eq(ST_OK, ret, "failed to set value if version");
+
+    ret = st_capi_set_if_version(root, key, value, version);
+    st_ut_eq(ST_TABLE_MODIFIED, ret, "table is modified");
+
+    st_tvalue_t check_value = st_str_null;
+    ret = st_capi_get(root, key, &check_value);
+    st_ut_eq(ST_OK, ret, "failed to get value");
+    st_ut_eq(30, *(int *)check_value.bytes, "wrong value");
+    st_capi_free(&check_value);
+
+    st_table_remove_all(root);
+    st_table_free(root);
+
+    st_capi_tear_down_ut();
+}
+
+
+static int
+st_capi_sum_and_set_cb(const st_tvalue_t *key, st_tvalue_t *value, void *args)
+{
+    st_table_t *table = ((st_table_t **)args)[0];
+    int *sum          = ((int **)args)[1];
+
+    *sum += *(int *)value->bytes;
+
+    /** writers are not blocked by iterating snapshot */
+    int new_value = 100;
+    int ret = st_capi_set(table, *(int *)key->bytes, new_value);
+    st_ut_eq(ST_OK, ret, "failed to set value in foreach");
+
+    return ST_OK;
+}
+
+
+st_test(st_capi, foreach_snapshot)
+{
+    st_capi_prepare_ut();
+
+    st_capi_process_t *pstate = st_capi_get_process_state();
+
+    st_table_t *root = NULL;
+    st_table_new(&pstate->lib_state->table_pool, &root);
+
+    for (int i = 1; i <= 10; i++) {
+        int ret = st_capi_set(root, i, i);
+        st_ut_eq(ST_OK, ret, "failed to set value");
+    }
+
+    int sum = 0;
+    void *args[] = {root, &sum};
+
+    int ret = st_capi_foreach_snapshot(root, st_capi_sum_and_set_cb, args);
+    st_ut_eq(ST_OK, ret, "failed to foreach snapshot");
+    st_ut_eq(55, sum, "snapshot must not see values set in foreach");
+
+    sum = 0;
+    ret = st_capi_foreach_snapshot(root, st_capi_sum_and_set_cb, args);
+    st_ut_eq(ST_OK, ret, "failed to foreach snapshot");
+    st_ut_eq(1000, sum, "wrong sum");
+
+    ret = st_capi_foreach_snapshot(root, NULL, args);
+    st_ut_eq(ST_ARG_INVALID, ret, "foreach_cb must not be NULL");
+
+    st_table_remove_all(root);
+    st_table_free(root);
+
+    st_capi_tear_down_ut();
+}
+
+
 st_test(st_capi, worker_init)
 {
     st_capi_prepare_ut();
@@ -1012,6 +1518,300 @@ st_test(st_capi, iterator)
 }
 
 
+st_test(st_capi, cursor)
+{
+    st_capi_prepare_ut();
+
+    int
+    st_capi_test_cursor_cb(void)
+    {
+        st_tvalue_t tbl_val = st_str_null;
+        int ret = st_capi_new(&tbl_val);
+        st_ut_eq(ST_OK, ret, "failed to new table: %d", ret);
+
+        st_table_t *table = st_table_get_table_addr_from_value(tbl_val);
+
+        for (int i = 1; i <= 10; i++) {
+            ret = st_capi_set(table, i, i);
+            st_ut_eq(ST_OK, ret, "failed to set value");
+        }
+
+        st_tvalue_t key;
+        st_tvalue_t value;
+        st_capi_iter_t iter;
+        st_capi_iter_t cursor;
+
+        ret = st_capi_init_iterator(&tbl_val, &iter, NULL, 0);
+        st_ut_eq(ST_OK, ret, "failed to init iterator: %d", ret);
+
+        ret = st_capi_init_cursor(&tbl_val, &cursor, NULL, 0);
+        st_ut_eq(ST_OK, ret, "failed to init cursor: %d", ret);
+
+        for (int i = 1; i <= 3; i++) {
+            ret = st_capi_next(&cursor, &key, &value);
+            st_ut_eq(ST_OK, ret, "failed to next cursor: %d", ret);
+            st_ut_eq(i, *(int *)key.bytes, "wrong key");
+
+            st_capi_free(&key);
+            st_capi_free(&value);
+        }
+
+        /** keys before the last returned one are not iterated */
+        int k = 0;
+        ret = st_capi_set(table, k, k);
+        st_ut_eq(ST_OK, ret, "failed to set value");
+
+        k = 4;
+        ret = st_capi_remove_key(table, k);
+        st_ut_eq(ST_OK, ret, "failed to remove key");
+
+        k = 20;
+        ret = st_capi_set(table, k, k);
+        st_ut_eq(ST_OK, ret, "failed to set value");
+
+        ret = st_capi_next(&iter, &key, &value);
+        st_ut_eq(ST_TABLE_MODIFIED, ret, "iterator must fail if table modified");
+
+        int expected[] = {5, 6, 7, 8, 9, 10, 20};
+        for (int i = 0; i < st_nelts(expected); i++) {
+            ret = st_capi_next(&cursor, &key, &value);
+            st_ut_eq(ST_OK, ret, "failed to resume cursor: %d", ret);
+            st_ut_eq(expected[i], *(int *)key.bytes, "wrong key");
+            st_ut_eq(expected[i], *(int *)value.bytes, "wrong value");
+
+            st_capi_free(&key);
+            st_capi_free(&value);
+        }
+
+        ret = st_capi_next(&cursor, &key, &value);
+        st_ut_eq(ST_ITER_FINISH, ret, "failed to finish cursor: %d", ret);
+
+        st_ut_eq(ST_OK, st_capi_free_iterator(&iter), "failed to free iterator");
+        st_ut_eq(ST_OK, st_capi_free_iterator(&cursor), "failed to free cursor");
+        st_ut_eq(NULL, cursor.seek_key.bytes, "failed to free seek key");
+
+        /** modified before the first key returned, seek from init key */
+        k = 5;
+        st_tvalue_t init_key = st_capi_make_tvalue(k);
+        ret = st_capi_init_cursor(&tbl_val, &cursor, &init_key, ST_SIDE_RIGHT_EQ);
+        st_ut_eq(ST_OK, ret, "failed to init cursor: %d", ret);
+
+        k = 6;
+        ret = st_capi_remove_key(table, k);
+        st_ut_eq(ST_OK, ret, "failed to remove key");
+
+        ret = st_capi_next(&cursor, &key, &value);
+        st_ut_eq(ST_OK, ret, "failed to resume cursor: %d", ret);
+        st_ut_eq(5, *(int *)key.bytes, "wrong key");
+
+        st_capi_free(&key);
+        st_capi_free(&value);
+
+        st_ut_eq(ST_OK, st_capi_free_iterator(&cursor), "failed to free cursor");
+
+        st_capi_free(&tbl_val);
+
+        return ST_OK;
+    }
+
+    st_ut_eq(ST_OK,
+             st_capi_test_fork_wrapper(st_capi_test_cursor_cb),
+             "callback failed");
+
+    st_capi_tear_down_ut();
+}
+
+
+st_test(st_capi, next_batch)
+{
+    st_capi_prepare_ut();
+
+    int
+    st_capi_test_next_batch_cb(void)
+    {
+        st_tvalue_t tbl_val = st_str_null;
+        int ret = st_capi_new(&tbl_val);
+        st_ut_eq(ST_OK, ret, "failed to new table: %d", ret);
+
+        st_tvalue_t sub_val = st_str_null;
+        ret = st_capi_new(&sub_val);
+        st_ut_eq(ST_OK, ret, "failed to new table: %d", ret);
+
+        st_table_t *table = st_table_get_table_addr_from_value(tbl_val);
+        st_table_t *sub   = st_table_get_table_addr_from_value(sub_val);
+
+        for (int i = 1; i <= 10; i++) {
+            ret = st_capi_set(table, i, i);
+            st_ut_eq(ST_OK, ret, "failed to set value");
+        }
+
+        int k = 11;
+        ret = st_capi_set(table, k, sub);
+        st_ut_eq(ST_OK, ret, "failed to set table value");
+
+        st_tvalue_t keys[16];
+        st_tvalue_t values[16];
+        uint8_t buf[1024];
+        int64_t buf_size;
+        int64_t cnt;
+        st_capi_iter_t iter;
+
+        ret = st_capi_init_iterator(&tbl_val, &iter, NULL, 0);
+        st_ut_eq(ST_OK, ret, "failed to init iterator: %d", ret);
+
+        /** each entry of int key and int value uses 16 bytes */
+        buf_size = 0;
+        ret = st_capi_next_batch(&iter, keys, values, 16, buf, &buf_size, &cnt);
+        st_ut_eq(ST_BUF_NOT_ENOUGH, ret, "buf must not be enough");
+        st_ut_eq(0, cnt, "wrong cnt");
+        st_ut_eq(16, buf_size, "wrong size needed");
+
+        buf_size = 64;
+        ret = st_capi_next_batch(&iter, keys, values, 16, buf, &buf_size, &cnt);
+        st_ut_eq(ST_OK, ret, "failed to next batch: %d", ret);
+        st_ut_eq(4, cnt, "stop if buf is not enough");
+        st_ut_eq(64, buf_size, "wrong size used");
+
+        for (int i = 0; i < cnt; i++) {
+            st_ut_eq(i + 1, *(int *)keys[i].bytes, "wrong key");
+            st_ut_eq(i + 1, *(int *)values[i].bytes, "wrong value");
+            st_ut_eq(buf + i * 16, keys[i].bytes, "key must be in buf");
+        }
+
+        buf_size = sizeof(buf);
+        ret = st_capi_next_batch(&iter, keys, values, 2, buf, &buf_size, &cnt);
+        st_ut_eq(ST_OK, ret, "failed to next batch: %d", ret);
+        st_ut_eq(2, cnt, "wrong cnt");
+        st_ut_eq(5, *(int *)keys[0].bytes, "wrong key");
+        st_ut_eq(6, *(int *)keys[1].bytes, "wrong key");
+
+        /** stop before table value */
+        buf_size = sizeof(buf);
+        ret = st_capi_next_batch(&iter, keys, values, 16, buf, &buf_size, &cnt);
+        st_ut_eq(ST_OK, ret, "failed to next batch: %d", ret);
+        st_ut_eq(4, cnt, "wrong cnt");
+        st_ut_eq(10, *(int *)keys[3].bytes, "wrong key");
+
+        buf_size = sizeof(buf);
+        ret = st_capi_next_batch(&iter, keys, values, 16, buf, &buf_size, &cnt);
+        st_ut_eq(ST_UNSUPPORTED, ret, "table value is not supported");
+        st_ut_eq(0, cnt, "wrong cnt");
+
+        st_tvalue_t key;
+        st_tvalue_t value;
+        ret = st_capi_next(&iter, &key, &value);
+        st_ut_eq(ST_OK, ret, "failed to next: %d", ret);
+        st_ut_eq(11, *(int *)key.bytes, "wrong key");
+        st_ut_eq(sub, st_table_get_table_addr_from_value(value), "wrong value");
+
+        st_capi_free(&key);
+        st_capi_free(&value);
+
+        buf_size = sizeof(buf);
+        ret = st_capi_next_batch(&iter, keys, values, 16, buf, &buf_size, &cnt);
+        st_ut_eq(ST_ITER_FINISH, ret, "failed to finish: %d", ret);
+        st_ut_eq(0, cnt, "wrong cnt");
+
+        st_ut_eq(ST_OK, st_capi_free_iterator(&iter), "failed to free iterator");
+
+        /** cursor resumes from the last key of the last batch */
+        ret = st_capi_init_cursor(&tbl_val, &iter, NULL, 0);
+        st_ut_eq(ST_OK, ret, "failed to init cursor: %d", ret);
+
+        buf_size = sizeof(buf);
+        ret = st_capi_next_batch(&iter, keys, values, 3, buf, &buf_size, &cnt);
+        st_ut_eq(ST_OK, ret, "failed to next batch: %d", ret);
+        st_ut_eq(3, cnt, "wrong cnt");
+
+        k = 4;
+        ret = st_capi_remove_key(table, k);
+        st_ut_eq(ST_OK, ret, "failed to remove key");
+
+        buf_size = sizeof(buf);
+        ret = st_capi_next_batch(&iter, keys, values, 3, buf, &buf_size, &cnt);
+        st_ut_eq(ST_OK, ret, "failed to next batch: %d", ret);
+        st_ut_eq(3, cnt, "wrong cnt");
+        st_ut_eq(5, *(int *)keys[0].bytes, "wrong key");
+        st_ut_eq(7, *(int *)keys[2].bytes, "wrong key");
+
+        st_ut_eq(ST_OK, st_capi_free_iterator(&iter), "failed to free cursor");
+
+        st_capi_free(&sub_val);
+        st_capi_free(&tbl_val);
+
+        return ST_OK;
+    }
+
+    st_ut_eq(ST_OK,
+             st_capi_test_fork_wrapper(st_capi_test_next_batch_cb),
+             "callback failed");
+
+    st_capi_tear_down_ut();
+}
+
+
+st_test(st_capi, sharded)
+{
+    st_capi_prepare_ut();
+
+    int
+    st_capi_test_sharded_cb(void)
+    {
+        st_tvalue_t tbl_val = st_str_null;
+        int ret = st_capi_new_sharded(8, &tbl_val);
+        st_ut_eq(ST_OK, ret, "failed to new sharded table: %d", ret);
+
+        st_table_t *table = st_table_get_table_addr_from_value(tbl_val);
+        st_ut_eq(8, table->shard_cnt, "wrong shard count");
+
+        for (int i = 1; i <= 20; i++) {
+            ret = st_capi_set(table, i, i);
+            st_ut_eq(ST_OK, ret, "failed to set value");
+        }
+
+        st_tvalue_t key;
+        st_tvalue_t value;
+
+        for (int i = 1; i <= 20; i++) {
+            ret = st_capi_get(table, i, &value);
+            st_ut_eq(ST_OK, ret, "failed to get value: %d", ret);
+            st_ut_eq(i, *(int *)value.bytes, "wrong value");
+
+            st_capi_free(&value);
+        }
+
+        st_capi_iter_t iter;
+
+        ret = st_capi_init_iterator(&tbl_val, &iter, NULL, 0);
+        st_ut_eq(ST_OK, ret, "failed to init iterator: %d", ret);
+
+        for (int i = 1; i <= 20; i++) {
+            ret = st_capi_next(&iter, &key, &value);
+            st_ut_eq(ST_OK, ret, "failed to next: %d", ret);
+            st_ut_eq(i, *(int *)key.bytes, "wrong key");
+
+            st_capi_free(&key);
+            st_capi_free(&value);
+        }
+
+        ret = st_capi_next(&iter, &key, &value);
+        st_ut_eq(ST_ITER_FINISH, ret, "failed to finish iterator: %d", ret);
+
+        st_ut_eq(ST_OK, st_capi_free_iterator(&iter), "failed to free iterator");
+
+        st_capi_free(&tbl_val);
+
+        return ST_OK;
+    }
+
+    st_ut_eq(ST_OK,
+             st_capi_test_fork_wrapper(st_capi_test_sharded_cb),
+             "callback failed");
+
+    st_capi_tear_down_ut();
+}
+
+
 st_test(capi, groot_and_clean_dead_proot)
 {
     st_capi_prepare_ut();
@@ -30,7 +30,9 @@ static int st_gc_table_unknown_children_to_queue(st_gc_t *gc, st_table_t *table,
     st_list_t *lnode = NULL;
 
     int ret;
-    st_robustlock_lock(&table->lock);
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_rdlock_all(table, slots);
 
     ret = st_table_iter_init(table, &iter, NULL, 0);
     if (ret != ST_OK) {
@@ -73,7 +75,7 @@ static int st_gc_table_unknown_children_to_queue(st_gc_t *gc, st_table_t *table,
     }
 
 quit:
-    st_robustlock_unlock(&table->lock);
+    st_table_rdunlock_all(table, slots);
     return ret;
 }
 
@@ -198,7 +200,16 @@ quit:
     return ret;
 }
 
-static int st_gc_free_tables(st_gc_t *gc) {
+// usec is the time spent on freeing in this step, including pre_step.
+static void st_gc_adjust_max_free_cnt(st_gc_t *gc, int64_t usec) {
+
+    if (gc->curr_free_cnt > 0) {
+        float per_usec = st_max((float)usec / gc->curr_free_cnt, 0.1);
+        gc->max_free_cnt = st_max(ST_GC_MAX_TIME_IN_USEC / per_usec, 1);
+    }
+}
+
+static int st_gc_free_tables(st_gc_t *gc, int64_t pre_step_usec) {
 
     int64_t start_usec = 0;
     int64_t end_usec = 0;
@@ -239,10 +250,8 @@ static int st_gc_free_tables(st_gc_t *gc) {
         return ret;
     }
 
-    if (gc->curr_free_cnt > 0) {
-        float usec = st_max((float)(end_usec - start_usec) / gc->curr_free_cnt, 0.1);
-        gc->max_free_cnt = st_max(ST_GC_MAX_TIME_IN_USEC / usec, 1);
-    }
+    // objects freed by pre_step are counted in curr_free_cnt too.
+    st_gc_adjust_max_free_cnt(gc, end_usec - start_usec + pre_step_usec);
 
     dd("free use usec: %d, curr_free_cnt: %d, next max_free_cnt: %d",
        (int)(end_usec - start_usec), gc->curr_free_cnt, gc->max_free_cnt);
@@ -258,8 +267,39 @@ int st_gc_run(st_gc_t *gc) {
     gc->curr_free_cnt = 0;
 
     int ret;
+    int64_t pre_step_usec = 0;
+
     st_robustlock_lock(&gc->lock);
 
+    if (gc->pre_step != NULL) {
+        int64_t start_usec = 0;
+        int64_t end_usec = 0;
+
+        ret = st_time_in_usec(&start_usec);
+        if (ret != ST_OK) {
+            goto quit;
+        }
+
+        int pre_ret = gc->pre_step(gc, gc->pre_step_data);
+
+        ret = st_time_in_usec(&end_usec);
+        if (ret != ST_OK) {
+            goto quit;
+        }
+
+        pre_step_usec = end_usec - start_usec;
+
+        // pre_step shares the budget with freeing tables.
+        if (pre_ret != ST_EMPTY) {
+            if (pre_ret == ST_OK) {
+                st_gc_adjust_max_free_cnt(gc, pre_step_usec);
+            }
+
+            ret = pre_ret;
+            goto quit;
+        }
+    }
+
     if (!gc->begin) {
 
         if (st_list_empty(&gc->sweep_queue) && st_list_empty(&gc->prev_sweep_queue)) {
@@ -282,7 +322,7 @@ int st_gc_run(st_gc_t *gc) {
         goto quit;
     }
 
-    ret = st_gc_free_tables(gc);
+    ret = st_gc_free_tables(gc, pre_step_usec);
     if (ret != ST_EMPTY) {
         goto quit;
     }
@@ -392,9 +432,12 @@ quit:
     return ret;
 }
 
-int st_gc_init(st_gc_t *gc) {
+int st_gc_init(st_gc_t *gc, st_gc_pre_step_pt pre_step, void *pre_step_data) {
     st_must(gc != NULL, ST_ARG_INVALID);
 
+    gc->pre_step = pre_step;
+    gc->pre_step_data = pre_step_data;
+
     gc->round = 0;
     gc->begin = 0;
     gc->max_visit_cnt = 100;
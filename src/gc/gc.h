@@ -18,6 +18,13 @@
 typedef struct st_gc_head_s st_gc_head_t;
 typedef struct st_gc_s st_gc_t;
 
+// called by st_gc_run with gc locked before each gc step, for the owner of gc
+// to free what it defers to gc within the same budget. gc step goes on if it
+// returns ST_EMPTY when nothing is left to free, or ends with what it returns.
+// what it frees is counted in curr_free_cnt, and the time it takes is counted
+// when max_free_cnt is adjusted.
+typedef int (*st_gc_pre_step_pt)(st_gc_t *gc, void *data);
+
 // each table has gc head, used for sweep unused table.
 struct st_gc_head_s {
     // used by mark_queue in gc struct.
@@ -70,6 +77,10 @@ struct st_gc_s {
     int max_free_cnt;
     int curr_free_cnt;
 
+    // optional, data is passed to pre_step as is.
+    st_gc_pre_step_pt pre_step;
+    void *pre_step_data;
+
     pthread_mutex_t lock;
 };
 
@@ -98,7 +109,7 @@ static inline void st_gc_head_init(st_gc_t *gc, st_gc_head_t *gc_head) {
     gc_head->mark = st_gc_status_unknown(gc);
 }
 
-int st_gc_init(st_gc_t *gc);
+int st_gc_init(st_gc_t *gc, st_gc_pre_step_pt pre_step, void *pre_step_data);
 
 int st_gc_destroy(st_gc_t *gc);
 
@@ -36,8 +36,9 @@ static ssize_t get_alloc_cnt_in_slab(st_table_pool_t *pool, uint64_t size) {
     return pool->slab_pool.groups[idx].stat.current.alloc.cnt;
 }
 
+// tables may be in the same slab chunk size as elements, count them by pool.
 static ssize_t remain_table_cnt(st_table_pool_t *pool) {
-    return get_alloc_cnt_in_slab(pool, sizeof(st_table_t));
+    return pool->table_cnt;
 }
 
 static st_table_pool_t *alloc_table_pool() {
@@ -260,7 +261,7 @@ static int check_table_children_reachable(st_table_t *table, st_gc_t *gc) {
     st_table_iter_t iter;
 
     int ret;
-    st_robustlock_lock(&table->lock);
+    int slot = st_robustrwlock_rdlock(&table->lock);
 
     ret = st_table_iter_init(table, &iter, NULL, 0);
     if (ret != ST_OK) {
@@ -290,7 +291,7 @@ static int check_table_children_reachable(st_table_t *table, st_gc_t *gc) {
     }
 
 quit:
-    st_robustlock_unlock(&table->lock);
+    st_robustrwlock_rdunlock(&table->lock, slot);
     return ret;
 }
 
@@ -142,3 +142,249 @@ int st_robustlock_destroy(pthread_mutex_t *lock) {
 
     return pthread_mutex_destroy(lock);
 }
+
+
+
+/* pid of this thread's process, it is reset in the child after fork */
+static __thread pid_t st_robustrwlock_pid = 0;
+
+static pthread_once_t st_robustrwlock_once = PTHREAD_ONCE_INIT;
+
+static void st_robustrwlock_reset_pid(void) {
+    st_robustrwlock_pid = 0;
+}
+
+static void st_robustrwlock_register_fork(void) {
+    pthread_atfork(NULL, NULL, st_robustrwlock_reset_pid);
+}
+
+static uint64_t st_robustrwlock_get_pid(void) {
+
+    if (st_robustrwlock_pid == 0) {
+        st_robustrwlock_pid = getpid();
+    }
+
+    return (uint64_t)st_robustrwlock_pid;
+}
+
+/* add a reader to the entry of this process, return -1 if no entry is free */
+static int st_robustrwlock_reader_add(st_robustrwlock_t *rwlock) {
+
+    uint64_t pid = st_robustrwlock_get_pid();
+
+    for (int i = 0; i < ST_ROBUSTRWLOCK_READER_CNT; i++) {
+        uint64_t v = st_atomic_load(&rwlock->readers[i], __ATOMIC_RELAXED);
+
+        /* entry of a process is changed only by its readers and by the
+         * writer dropping it after the process died */
+        while (v >> 32 == pid) {
+            if (st_atomic_cas(&rwlock->readers[i], &v, v + 1)) {
+                return i;
+            }
+        }
+    }
+
+    for (int i = 0; i < ST_ROBUSTRWLOCK_READER_CNT; i++) {
+        uint64_t v = 0;
+
+        if (st_atomic_cas(&rwlock->readers[i], &v, pid << 32 | 1)) {
+            return i;
+        }
+
+        /* another thread of this process took it */
+        while (v >> 32 == pid) {
+            if (st_atomic_cas(&rwlock->readers[i], &v, v + 1)) {
+                return i;
+            }
+        }
+    }
+
+    return -1;
+}
+
+static void st_robustrwlock_reader_remove(st_robustrwlock_t *rwlock, int slot) {
+
+    uint64_t v = st_atomic_load(&rwlock->readers[slot], __ATOMIC_RELAXED);
+
+    while (1) {
+        uint64_t next = (v & 0xffffffff) == 1 ? 0 : v - 1;
+
+        if (st_atomic_cas(&rwlock->readers[slot], &v, next)) {
+            return;
+        }
+    }
+}
+
+static int st_robustrwlock_process_dead(pid_t pid) {
+    return kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+/* wait until all readers left, readers of dead processes are dropped */
+static void st_robustrwlock_wait_readers(st_robustrwlock_t *rwlock) {
+
+    for (int64_t n = 0; ; n++) {
+        int busy = 0;
+
+        for (int i = 0; i < ST_ROBUSTRWLOCK_READER_CNT; i++) {
+            uint64_t v = st_atomic_load(&rwlock->readers[i]);
+            if (v == 0) {
+                continue;
+            }
+
+            /* checking process is a syscall, only do it after waiting a while */
+            if (n % 64 == 63 && st_robustrwlock_process_dead(v >> 32)) {
+                st_atomic_cas(&rwlock->readers[i], &v, 0);
+                continue;
+            }
+
+            busy = 1;
+        }
+
+        if (!busy) {
+            return;
+        }
+
+        sched_yield();
+    }
+}
+
+int st_robustrwlock_init(st_robustrwlock_t *rwlock) {
+
+    st_assert_nonull(rwlock);
+
+    pthread_once(&st_robustrwlock_once, st_robustrwlock_register_fork);
+
+    int ret = st_robustlock_init(&rwlock->writer);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    rwlock->writing = 0;
+
+    for (int i = 0; i < ST_ROBUSTRWLOCK_READER_CNT; i++) {
+        rwlock->readers[i] = 0;
+    }
+
+    return ST_OK;
+}
+
+
+int st_robustrwlock_destroy(st_robustrwlock_t *rwlock) {
+
+    st_assert_nonull(rwlock);
+
+    return st_robustlock_destroy(&rwlock->writer);
+}
+
+
+/* lock writer and add reader, or keep writer locked if no entry is free */
+static int st_robustrwlock_rdlock_writer(st_robustrwlock_t *rwlock) {
+
+    /* no writer is running with writer locked, writing is left set only by a
+     * dead writer */
+    st_atomic_store(&rwlock->writing, 0, __ATOMIC_RELAXED);
+
+    int slot = st_robustrwlock_reader_add(rwlock);
+    if (slot < 0) {
+        return ST_ROBUSTRWLOCK_READER_CNT;
+    }
+
+    st_robustlock_unlock(&rwlock->writer);
+
+    return slot;
+}
+
+/* add reader if no writer is running, return -1 if it fails */
+static int st_robustrwlock_rdlock_fast(st_robustrwlock_t *rwlock) {
+
+    if (st_atomic_load(&rwlock->writing) != 0) {
+        return -1;
+    }
+
+    int slot = st_robustrwlock_reader_add(rwlock);
+    if (slot < 0) {
+        return -1;
+    }
+
+    /* adding reader and checking writing pairs with setting writing and
+     * checking readers in st_robustrwlock_wrlock, one sees the other */
+    if (st_atomic_load(&rwlock->writing) == 0) {
+        return slot;
+    }
+
+    st_robustrwlock_reader_remove(rwlock, slot);
+
+    return -1;
+}
+
+
+int st_robustrwlock_rdlock(st_robustrwlock_t *rwlock) {
+
+    st_assert_nonull(rwlock);
+
+    int slot = st_robustrwlock_rdlock_fast(rwlock);
+    if (slot >= 0) {
+        return slot;
+    }
+
+    st_robustlock_lock(&rwlock->writer);
+
+    return st_robustrwlock_rdlock_writer(rwlock);
+}
+
+
+int st_robustrwlock_tryrdlock(st_robustrwlock_t *rwlock, int *slot) {
+
+    st_assert_nonull(rwlock);
+    st_assert_nonull(slot);
+
+    *slot = st_robustrwlock_rdlock_fast(rwlock);
+    if (*slot >= 0) {
+        return ST_OK;
+    }
+
+    if (st_robustlock_trylock(&rwlock->writer) != ST_OK) {
+        return ST_AGAIN;
+    }
+
+    *slot = st_robustrwlock_rdlock_writer(rwlock);
+
+    return ST_OK;
+}
+
+
+void st_robustrwlock_rdunlock(st_robustrwlock_t *rwlock, int slot) {
+
+    st_assert_nonull(rwlock);
+    st_assert(slot >= 0 && slot <= ST_ROBUSTRWLOCK_READER_CNT,
+              "invalid reader slot: %d", slot);
+
+    if (slot == ST_ROBUSTRWLOCK_READER_CNT) {
+        st_robustlock_unlock(&rwlock->writer);
+        return;
+    }
+
+    st_robustrwlock_reader_remove(rwlock, slot);
+}
+
+
+void st_robustrwlock_wrlock(st_robustrwlock_t *rwlock) {
+
+    st_assert_nonull(rwlock);
+
+    st_robustlock_lock(&rwlock->writer);
+
+    st_atomic_store(&rwlock->writing, 1);
+
+    st_robustrwlock_wait_readers(rwlock);
+}
+
+
+void st_robustrwlock_wrunlock(st_robustrwlock_t *rwlock) {
+
+    st_assert_nonull(rwlock);
+
+    st_atomic_store(&rwlock->writing, 0);
+
+    st_robustlock_unlock(&rwlock->writer);
+}
@@ -2,14 +2,19 @@
 #define _ROBUST_LOCK_H_INCLUDED_
 
 #include <pthread.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <sched.h>
+#include <signal.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/syscall.h>
 
 #include "inc/util.h"
 #include "inc/err.h"
 #include "inc/log.h"
+#include "atomic/atomic.h"
 
 int st_robustlock_init(pthread_mutex_t *lock);
 void st_robustlock_lock(pthread_mutex_t *lock);
@@ -17,4 +22,50 @@ void st_robustlock_unlock(pthread_mutex_t *lock);
 int st_robustlock_destroy(pthread_mutex_t *lock);
 int st_robustlock_trylock(pthread_mutex_t *lock);
 
+/* number of processes holding read lock of st_robustrwlock_t at once */
+#define ST_ROBUSTRWLOCK_READER_CNT 4
+
+/*
+ * process shared, robust reader/writer lock.
+ *
+ * A writer locks the robust mutex `writer`, sets `writing` and waits until
+ * no reader is left. A reader adds itself to the count of its process in
+ * `readers` without locking anything, unless a writer is writing, then it
+ * locks `writer` to wait for it.
+ *
+ * A lock held by a dead writer is recovered the same way as
+ * st_robustlock_lock does, and readers of a dead process are dropped by the
+ * writer waiting for them. A reader of a process finding no free entry in
+ * `readers` holds `writer` instead, so it is recovered the same way.
+ *
+ * Reader lock is not recursive, a thread must not read lock a lock twice.
+ */
+typedef struct st_robustrwlock_s st_robustrwlock_t;
+
+struct st_robustrwlock_s {
+    pthread_mutex_t writer;
+
+    /* set while a writer holds or is waiting for the lock */
+    int32_t writing;
+
+    /* pid << 32 | count of readers of the process, 0 if it is free */
+    uint64_t readers[ST_ROBUSTRWLOCK_READER_CNT];
+};
+
+int st_robustrwlock_init(st_robustrwlock_t *rwlock);
+int st_robustrwlock_destroy(st_robustrwlock_t *rwlock);
+
+/* return the reader slot, which must be passed to st_robustrwlock_rdunlock */
+int st_robustrwlock_rdlock(st_robustrwlock_t *rwlock);
+void st_robustrwlock_rdunlock(st_robustrwlock_t *rwlock, int slot);
+
+/*
+ * read lock without waiting, return ST_AGAIN if a writer is holding or waiting
+ * for the lock. slot is set if it returns ST_OK.
+ */
+int st_robustrwlock_tryrdlock(st_robustrwlock_t *rwlock, int *slot);
+
+void st_robustrwlock_wrlock(st_robustrwlock_t *rwlock);
+void st_robustrwlock_wrunlock(st_robustrwlock_t *rwlock);
+
 #endif /* _ROBUST_LOCK_H_INCLUDED_ */
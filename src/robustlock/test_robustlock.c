@@ -217,4 +217,215 @@ st_test(robustlock, concurrent_deadlock) {
     free_lock(lock);
 }
 
+st_robustrwlock_t *alloc_rwlock() {
+    st_robustrwlock_t *rwlock = NULL;
+
+    rwlock = share_alloc(sizeof(*rwlock));
+
+    st_robustrwlock_init(rwlock);
+
+    return rwlock;
+}
+
+void free_rwlock(st_robustrwlock_t *rwlock) {
+    int ret = -1;
+
+    ret = st_robustrwlock_destroy(rwlock);
+    st_ut_eq(ST_OK, ret, "rwlock destroy");
+
+    munmap(rwlock, sizeof(*rwlock));
+}
+
+st_test(robustrwlock, read_write) {
+    int ret = -1;
+    int *flag = NULL;
+    st_robustrwlock_t *rwlock = NULL;
+
+    flag = share_alloc(sizeof(*flag));
+    rwlock = alloc_rwlock();
+
+    int slot = st_robustrwlock_rdlock(rwlock);
+    st_ut_le(0, slot, "reader slot");
+    st_ut_gt(ST_ROBUSTRWLOCK_READER_CNT, slot, "reader slot");
+
+    /** readers do not block each other */
+    int pid = fork();
+    if (pid == 0) {
+        int s = st_robustrwlock_rdlock(rwlock);
+        st_robustrwlock_rdunlock(rwlock, s);
+        exit(0);
+    }
+
+    waitpid(pid, &ret, 0);
+    st_ut_eq(ST_OK, ret, "read lock in child");
+
+    st_robustrwlock_rdunlock(rwlock, slot);
+
+    /** writer blocks readers */
+    st_robustrwlock_wrlock(rwlock);
+
+    *flag = 0;
+
+    pid = fork();
+    if (pid == 0) {
+        int s = st_robustrwlock_rdlock(rwlock);
+        *flag = 1;
+        st_robustrwlock_rdunlock(rwlock, s);
+        exit(0);
+    }
+
+    usleep(100 * 1000);
+    st_ut_eq(0, *flag, "reader is blocked by writer");
+
+    st_robustrwlock_wrunlock(rwlock);
+
+    waitpid(pid, &ret, 0);
+    st_ut_eq(ST_OK, ret, "read lock in child");
+    st_ut_eq(1, *flag, "reader got lock after writer unlock");
+
+    st_ut_bug(st_robustrwlock_rdunlock(rwlock, ST_ROBUSTRWLOCK_READER_CNT + 1), "invalid slot");
+
+    free_rwlock(rwlock);
+    munmap(flag, sizeof(*flag));
+}
+
+st_test(robustrwlock, tryrdlock) {
+    int ret = -1;
+    int slot = -1;
+    st_robustrwlock_t *rwlock = NULL;
+
+    rwlock = alloc_rwlock();
+
+    ret = st_robustrwlock_tryrdlock(rwlock, &slot);
+    st_ut_eq(ST_OK, ret, "tryrdlock unlocked lock");
+    st_ut_le(0, slot, "reader slot");
+    st_ut_gt(ST_ROBUSTRWLOCK_READER_CNT, slot, "reader slot");
+
+    /** readers do not block each other */
+    int pid = fork();
+    if (pid == 0) {
+        int s = -1;
+        if (st_robustrwlock_tryrdlock(rwlock, &s) != ST_OK) {
+            exit(1);
+        }
+        st_robustrwlock_rdunlock(rwlock, s);
+        exit(0);
+    }
+
+    waitpid(pid, &ret, 0);
+    st_ut_eq(ST_OK, ret, "tryrdlock in child");
+
+    st_robustrwlock_rdunlock(rwlock, slot);
+
+    /** writer fails it at once */
+    st_robustrwlock_wrlock(rwlock);
+
+    pid = fork();
+    if (pid == 0) {
+        int s = -1;
+        exit(st_robustrwlock_tryrdlock(rwlock, &s) == ST_AGAIN ? 0 : 1);
+    }
+
+    waitpid(pid, &ret, 0);
+    st_ut_eq(ST_OK, ret, "tryrdlock is busy in child");
+
+    st_robustrwlock_wrunlock(rwlock);
+
+    st_ut_bug(st_robustrwlock_tryrdlock(NULL, &slot), "lock NULL");
+
+    free_rwlock(rwlock);
+}
+
+st_test(robustrwlock, concurrent) {
+    int ret = -1;
+    int pids[ST_ROBUSTRWLOCK_READER_CNT * 2];
+    int *shared = share_alloc(sizeof(int) * 3);
+    st_robustrwlock_t *rwlock = alloc_rwlock();
+
+    int *writing = &shared[0];
+    int *stop_flag = &shared[1];
+    int *violated = &shared[2];
+
+    /** more processes than reader entries */
+    for (int i = 0; i < st_nelts(pids); i++) {
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            while (st_atomic_load(stop_flag) == 0) {
+                int slot = st_robustrwlock_rdlock(rwlock);
+
+                if (st_atomic_load(writing) != 0) {
+                    st_atomic_store(violated, 1);
+                }
+
+                st_robustrwlock_rdunlock(rwlock, slot);
+            }
+            exit(0);
+        }
+    }
+
+    for (int i = 0; i < 200; i++) {
+        st_robustrwlock_wrlock(rwlock);
+
+        st_atomic_store(writing, 1);
+        usleep(100);
+        st_atomic_store(writing, 0);
+
+        st_robustrwlock_wrunlock(rwlock);
+        usleep(100);
+    }
+
+    st_atomic_store(stop_flag, 1);
+    wait_children(pids, st_nelts(pids));
+
+    st_ut_eq(0, *violated, "reader runs with writer");
+
+    int slot = -1;
+    ret = st_robustrwlock_tryrdlock(rwlock, &slot);
+    st_ut_eq(ST_OK, ret, "no reader left");
+    st_robustrwlock_rdunlock(rwlock, slot);
+
+    free_rwlock(rwlock);
+    munmap(shared, sizeof(int) * 3);
+}
+
+st_test(robustrwlock, owner_dead) {
+    int ret = -1;
+    st_robustrwlock_t *rwlock = NULL;
+
+    rwlock = alloc_rwlock();
+
+    /** lock held by a dead reader */
+    for (int i = 0; i < ST_ROBUSTRWLOCK_READER_CNT * 2; i++) {
+        int pid = fork();
+        if (pid == 0) {
+            st_robustrwlock_rdlock(rwlock);
+            exit(0);
+        }
+
+        waitpid(pid, &ret, 0);
+        st_ut_eq(ST_OK, ret, "dead reader");
+    }
+
+    st_ut_nobug(st_robustrwlock_wrlock(rwlock), "write lock after reader dead");
+    st_ut_nobug(st_robustrwlock_wrunlock(rwlock), "write unlock");
+
+    /** lock held by a dead writer */
+    int pid = fork();
+    if (pid == 0) {
+        st_robustrwlock_wrlock(rwlock);
+        exit(0);
+    }
+
+    waitpid(pid, &ret, 0);
+    st_ut_eq(ST_OK, ret, "dead writer");
+
+    int slot = st_robustrwlock_rdlock(rwlock);
+    st_robustrwlock_rdunlock(rwlock, slot);
+
+    st_ut_nobug(st_robustrwlock_wrlock(rwlock), "write lock after writer dead");
+    st_ut_nobug(st_robustrwlock_wrunlock(rwlock), "write unlock");
+
+    free_rwlock(rwlock);
+}
+
 st_ut_main;
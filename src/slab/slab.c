@@ -316,6 +316,19 @@ st_slab_obj_alloc(st_slab_pool_t *slab_pool, ssize_t size, void **ret_addr)
                                       ret_addr);
 }
 
+ssize_t
+st_slab_obj_size(ssize_t size)
+{
+    st_must(size > 0, ST_ARG_INVALID);
+
+    int index = st_slab_size_to_index((uint64_t)size);
+    if (index == ST_SLAB_GROUP_CNT - 1) {
+        return size;
+    }
+
+    return (ssize_t)1 << index;
+}
+
 st_pagepool_page_t *
 st_slab_get_master_page(st_pagepool_page_t *page)
 {
@@ -123,6 +123,13 @@ int st_slab_pool_destroy(st_slab_pool_t *slab_pool);
  */
 int st_slab_obj_alloc(st_slab_pool_t *slab_pool, ssize_t size, void **ret_addr);
 
+/**
+ * return size of the object st_slab_obj_alloc allocates for size bytes,
+ * all of it can be used by caller.
+ * huge object size is not rounded, it is the same as size.
+ */
+ssize_t st_slab_obj_size(ssize_t size);
+
 /**
  * free the memory space of pointed to by addr which must be allocated by
  * st_slab_obj_alloc before. otherwise, or if addr is freed before,
@@ -145,6 +145,30 @@ st_test(st_slab, size_to_index)
     }
 }
 
+st_test(st_slab, obj_size)
+{
+    struct obj_size {
+        ssize_t size;
+        ssize_t obj_size;
+    } cases [] = {
+        {0, ST_ARG_INVALID},
+        {1, 8},
+        {8, 8},
+        {9, 16},
+        {100, 128},
+        {512, 512},
+        {513, 1024},
+        {2048, 2048},
+        {2049, 2049},
+        {5000, 5000},
+    };
+
+    for (int cnt = 0; cnt < st_nelts(cases); cnt++) {
+        ssize_t rst = st_slab_obj_size(cases[cnt].size);
+        st_ut_eq(cases[cnt].obj_size, rst, "failed to calc obj size %d", cnt);
+    }
+}
+
 void st_slab_update_obj_stat(st_slab_group_t *group, int alloc, int free);
 void st_slab_update_pages_stat(st_slab_group_t *group, int alloc, int free);
 
@@ -1,550 +1,5315 @@
 #include "table.h"
 
+// st_str_cmp compares keys of these types by bytes.
+static int st_table_key_cmp_by_bytes(int64_t type) {
+
+    switch (type) {
+    case ST_TYPES_INTEGER:
+    case ST_TYPES_U64:
+    case ST_TYPES_NUMBER:
+    case ST_TYPES_BOOLEAN:
+    case ST_TYPES_NIL:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+// first 8 bytes of key in big endian, padded with 0, so that comparing
+// prefixes of two keys is the same as comparing their first 8 bytes with
+// st_str_cmp. it is 0 for keys not compared by bytes.
+static uint64_t st_table_key_prefix(st_str_t *key) {
+
+    uint64_t prefix = 0;
+
+    if (!st_table_key_cmp_by_bytes(key->type)) {
+        return 0;
+    }
+
+    st_memcpy(&prefix, key->bytes, st_min(key->len, 8));
+
+    return htobe64(prefix);
+}
+
+// equal interned keys share bytes, they are equal without comparing bytes.
+static int st_table_key_same(st_str_t *a, st_str_t *b) {
+    return a->bytes == b->bytes && a->len == b->len && a->type == b->type;
+}
+
+// compare key with prefix to element key, the same as st_str_cmp.
+static int st_table_cmp_key(st_str_t *key, uint64_t prefix, st_table_element_t *e) {
+
+    if (prefix != e->key_prefix && key->type == e->key.type) {
+        return prefix < e->key_prefix ? -1 : 1;
+    }
+
+    if (st_table_key_same(key, &e->key)) {
+        return 0;
+    }
+
+    return st_str_cmp(key, &e->key);
+}
+
 static int st_table_cmp_element(st_rbtree_node_t *a, st_rbtree_node_t *b) {
 
     st_table_element_t *ea = st_owner(a, st_table_element_t, rbnode);
     st_table_element_t *eb = st_owner(b, st_table_element_t, rbnode);
 
-    return st_str_cmp(&ea->key, &eb->key);
+    return st_table_cmp_key(&ea->key, ea->key_prefix, eb);
 }
 
-static int st_table_new_element(st_table_t *table, st_str_t key,
-                                st_str_t value, st_table_element_t **elem) {
-    st_assert(key.len <= key.capacity);
-    st_assert(value.len <= value.capacity);
+static uint64_t st_table_hash_key(st_str_t *key) {
 
-    st_table_pool_t *pool = table->pool;
-    st_table_element_t *e = NULL;
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
 
-    ssize_t size = sizeof(st_table_element_t) + st_align(key.capacity, 8) + value.capacity;
+    uint8_t *p = key->bytes;
+    int64_t len = key->len;
+    double zero = 0;
+    uint64_t w;
 
-    int ret = st_slab_obj_alloc(&pool->slab_pool, size, (void **)&e);
-    if (ret != ST_OK) {
-        return ret;
+    if (key->type == ST_TYPES_NIL) {
+        // st_str_cmp treats all nil keys equal.
+        len = 0;
+    } else if (key->type == ST_TYPES_NUMBER && *(double *)key->bytes == 0) {
+        // 0.0 and -0.0 are equal in st_str_cmp, they must have the same hash.
+        p = (uint8_t *)&zero;
     }
 
-    e->rbnode = (st_rbtree_node_t)st_rbtree_node_empty;
+    uint64_t h = fib_hash64(key->type + 1) ^ (len * m);
+
+    for (; len >= 8; len -= 8, p += 8) {
+        st_memcpy(&w, p, 8);
 
-    st_memcpy(e->kv_data, key.bytes, key.len);
-    e->key = (st_str_t)st_str_wrap_common(e->kv_data, key.type, key.len);
-    if (key.len < key.capacity) {
-        e->key.bytes[key.len] = 0;
+        w *= m;
+        w ^= w >> 47;
+        w *= m;
+
+        h ^= w;
+        h *= m;
     }
 
-    uint8_t *value_start = e->kv_data + st_align(key.capacity, 8);
-    st_memcpy(value_start, value.bytes, value.len);
-    e->value = (st_str_t)st_str_wrap_common(value_start, value.type, value.len);
-    if (value.len < value.capacity) {
-        e->value.bytes[value.len] = 0;
+    if (len > 0) {
+        w = 0;
+        st_memcpy(&w, p, len);
+
+        h ^= w;
+        h *= m;
     }
 
-    *elem = e;
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+
+    return h;
+}
+
+static int st_table_free_retired_list(st_table_pool_t *pool, st_table_retired_t *list) {
+
+    int ret = ST_OK;
+
+    while (list != NULL) {
+        st_table_retired_t *next = list->next;
+
+        int free_ret = st_slab_obj_free(&pool->slab_pool, list);
+        if (free_ret != ST_OK) {
+            ret = free_ret;
+        }
+
+        list = next;
+    }
 
     return ret;
 }
 
-static int st_table_free_element(st_table_t *table, st_table_element_t *elem) {
+// slot of this thread's process in the reclaim used last, it is reset in the
+// child after fork, which must find a slot of its own.
+static __thread st_table_reclaim_t *st_table_reader_reclaim = NULL;
+static __thread pid_t st_table_reader_pid = 0;
+static __thread int st_table_reader_idx = -1;
 
-    st_table_pool_t *pool = table->pool;
+static pthread_once_t st_table_reader_once = PTHREAD_ONCE_INIT;
 
-    return st_slab_obj_free(&pool->slab_pool, elem);
+static void st_table_reader_reset_after_fork(void) {
+    st_table_reader_reclaim = NULL;
+    st_table_reader_pid = 0;
+    st_table_reader_idx = -1;
 }
 
-static int st_table_add_element(st_table_t *table, st_table_element_t *new_elem, int force,
-                                st_table_element_t **existed_elem) {
+static void st_table_reader_register_fork(void) {
+    pthread_atfork(NULL, NULL, st_table_reader_reset_after_fork);
+}
 
-    st_rbtree_node_t *existed_node = NULL;
+// return -1 if all slots are owned by other processes.
+static int st_table_reader_slot_claim(st_table_reclaim_t *reclaim, pid_t pid) {
 
-    int ret;
-    st_robustlock_lock(&table->lock);
+    int64_t cnt = st_atomic_load(&reclaim->slot_cnt);
 
-    ret = st_rbtree_insert(&table->elements, &new_elem->rbnode, 0, &existed_node);
-    if (ret != ST_OK && ret != ST_EXISTED) {
-        goto quit;
+    for (int64_t i = 0; i < cnt; i++) {
+        if (st_atomic_load(&reclaim->slots[i].pid, __ATOMIC_RELAXED) == pid) {
+            return i;
+        }
     }
 
-    if (ret == ST_OK) {
-        table->element_cnt++;
-        table->version++;
-        goto quit;
-    }
+    for (int64_t i = 0; i < ST_TABLE_READER_SLOT_CNT; i++) {
+        pid_t free_pid = 0;
 
-    // element is existed.
-    if (force) {
-        int replace_ret = st_rbtree_replace(&table->elements, existed_node, &new_elem->rbnode);
-        if (replace_ret != ST_OK) {
-            ret = replace_ret;
-            goto quit;
+        if (!st_atomic_cas(&reclaim->slots[i].pid, &free_pid, pid)) {
+            continue;
         }
 
-        table->version++;
+        // writers check slots before slot_cnt, it must cover the slot before
+        // any reader registers in it.
+        while (cnt <= i && !st_atomic_cas(&reclaim->slot_cnt, &cnt, i + 1)) {
+        }
 
-        *existed_elem = st_owner(existed_node, st_table_element_t, rbnode);
+        return i;
     }
 
-quit:
-    st_robustlock_unlock(&table->lock);
-    return ret;
+    return -1;
 }
 
-static int st_table_get_element(st_table_t *table, st_str_t key, st_table_element_t **elem) {
+// return -1 if process has no slot, a slot may be freed later by
+// st_table_reader_clean, so claiming is tried again next time.
+static int st_table_reader_slot(st_table_reclaim_t *reclaim) {
 
-    st_table_element_t tmp = {.key = key};
+    int idx = st_table_reader_idx;
 
-    st_rbtree_node_t *n = st_rbtree_search(&table->elements, &tmp.rbnode, ST_SIDE_EQ);
-    if (n == NULL) {
-        return ST_NOT_FOUND;
+    if (st_table_reader_reclaim == reclaim && idx >= 0
+            && st_atomic_load(&reclaim->slots[idx].pid, __ATOMIC_RELAXED)
+               == st_table_reader_pid) {
+        return idx;
     }
 
-    *elem = st_owner(n, st_table_element_t, rbnode);
+    pid_t pid = getpid();
 
-    return ST_OK;
+    idx = st_table_reader_slot_claim(reclaim, pid);
+
+    st_table_reader_reclaim = reclaim;
+    st_table_reader_pid = pid;
+    st_table_reader_idx = idx;
+
+    return idx;
 }
 
-static int st_table_remove_element(st_table_t *table, st_str_t key, st_table_element_t **removed) {
+// count of readers entered in epoch of the parity.
+static int64_t st_table_reader_cnt(st_table_reclaim_t *reclaim, int parity) {
 
-    int ret;
-    st_robustlock_lock(&table->lock);
+    int64_t cnt = st_atomic_load(&reclaim->slot_cnt);
+    int64_t readers = 0;
 
-    ret = st_table_get_element(table, key, removed);
-    if (ret != ST_OK) {
-        goto quit;
+    for (int64_t i = 0; i < cnt; i++) {
+        readers += st_atomic_load(&reclaim->slots[i].readers[parity]);
     }
 
-    st_rbtree_delete(&table->elements, &(*removed)->rbnode);
-    table->version++;
-    table->element_cnt--;
+    return readers;
+}
 
-quit:
-    st_robustlock_unlock(&table->lock);
-    return ret;
+static int st_table_no_reader(st_table_reclaim_t *reclaim) {
+    return st_table_reader_cnt(reclaim, 0) == 0 && st_table_reader_cnt(reclaim, 1) == 0;
 }
 
-static int st_table_init(st_table_t *table, st_table_pool_t *pool) {
+// lock reclaim before use the function.
+// return the retired list that can be freed after epoch advanced.
+static st_table_retired_t *st_table_reclaim_advance(st_table_reclaim_t *reclaim) {
 
-    int ret = st_rbtree_init(&table->elements, st_table_cmp_element);
-    if (ret != ST_OK) {
-        return ret;
-    }
+    int64_t epoch = reclaim->epoch;
 
-    ret = st_robustlock_init(&table->lock);
-    if (ret != ST_OK) {
-        return ret;
+    // readers entered in previous epoch may still see objects retired in
+    // previous epoch and the one before.
+    if (st_table_reader_cnt(reclaim, (epoch + 1) % 2) != 0) {
+        return NULL;
     }
 
-    st_gc_head_init(&pool->gc, &table->gc_head);
+    epoch++;
+    st_atomic_store(&reclaim->epoch, epoch);
 
-    table->pool = pool;
-    table->version = 0;
-    table->element_cnt = 0;
-    table->inited = 1;
+    // it is the list retired in epoch - 3, no reader can see it.
+    st_table_retired_t *freeable = reclaim->retired[epoch % 3];
+    reclaim->retired[epoch % 3] = NULL;
 
-    return ret;
+    return freeable;
 }
 
-static int st_table_destroy(st_table_t *table) {
+// lock reclaim before use the function.
+static st_table_retired_t *st_table_reclaim_detach_all(st_table_reclaim_t *reclaim) {
 
-    if (table->element_cnt != 0) {
-        return ST_NOT_EMPTY;
-    }
+    st_table_retired_t *all = NULL;
 
-    int ret = st_robustlock_destroy(&table->lock);
-    if (ret != ST_OK) {
-        return ret;
-    }
+    for (int i = 0; i < 3; i++) {
+        st_table_retired_t *list = reclaim->retired[i];
 
-    table->pool = NULL;
-    table->version = 0;
-    table->element_cnt = 0;
-    table->inited = 0;
+        while (list != NULL) {
+            st_table_retired_t *next = list->next;
 
-    return ret;
+            list->next = all;
+            all = list;
+
+            list = next;
+        }
+
+        reclaim->retired[i] = NULL;
+    }
+
+    return all;
 }
 
-static int st_table_run_gc_if_needed(st_table_t *table) {
+// free an object which has been removed from table, it is deferred if some
+// lock free reader may still be visiting it.
+static int st_table_retire(st_table_pool_t *pool, st_table_retired_t *obj) {
 
-    st_gc_t *gc = &table->pool->gc;
+    st_table_reclaim_t *reclaim = &pool->reclaim;
+    st_table_retired_t *freeable = NULL;
 
-    if (table->pool->run_gc_periodical == 1) {
-        return ST_OK;
-    }
+    obj->next = NULL;
 
-    if (fib_hash64((uintptr_t)table) > (1UL << 63)) {
-        return ST_OK;
-    }
+    // order removing object from table before checking readers, pairs with
+    // the increasing of readers in st_table_reader_enter.
+    st_atomic_fence(ST_ATOMIC_STRONGEST);
 
-    int ret = st_gc_run(gc);
-    if (ret == ST_NO_GC_DATA) {
-        return ST_OK;
-    }
+    if (st_table_no_reader(reclaim)) {
+        int ret = st_slab_obj_free(&pool->slab_pool, obj);
+        if (ret != ST_OK) {
+            return ret;
+        }
 
-    return ret;
-}
+        if (st_atomic_load(&reclaim->retired[0], __ATOMIC_RELAXED) == NULL
+                && st_atomic_load(&reclaim->retired[1], __ATOMIC_RELAXED) == NULL
+                && st_atomic_load(&reclaim->retired[2], __ATOMIC_RELAXED) == NULL) {
+            return ST_OK;
+        }
 
-int st_table_new(st_table_pool_t *pool, st_table_t **table) {
+        // readers must be checked again with lock held, objects retired by
+        // others after the check above may be visible to new readers.
+        st_robustlock_lock(&reclaim->lock);
 
-    st_must(pool != NULL, ST_ARG_INVALID);
-    st_must(table != NULL, ST_ARG_INVALID);
+        if (st_table_no_reader(reclaim)) {
+            freeable = st_table_reclaim_detach_all(reclaim);
+        }
 
-    st_table_t *t = NULL;
-    st_slab_pool_t *slab_pool = &pool->slab_pool;
+        st_robustlock_unlock(&reclaim->lock);
 
-    int ret = st_slab_obj_alloc(slab_pool, sizeof(st_table_t), (void **)&t);
-    if (ret != ST_OK) {
-        return ret;
+        return st_table_free_retired_list(pool, freeable);
     }
 
-    ret = st_table_init(t, pool);
-    if (ret != ST_OK) {
-        st_slab_obj_free(slab_pool, t);
-        return ret;
-    }
+    st_robustlock_lock(&reclaim->lock);
 
-    pool->table_cnt++;
+    int64_t idx = reclaim->epoch % 3;
+    obj->next = reclaim->retired[idx];
+    st_atomic_store(&reclaim->retired[idx], obj, __ATOMIC_RELAXED);
 
-    *table = t;
+    freeable = st_table_reclaim_advance(reclaim);
 
-    return ret;
-}
+    st_robustlock_unlock(&reclaim->lock);
 
-int st_table_free(st_table_t *table) {
+    return st_table_free_retired_list(pool, freeable);
+}
 
-    st_must(table != NULL, ST_ARG_INVALID);
-    st_must(table->inited, ST_UNINITED);
+// return value is slot index * 2 + epoch parity.
+int st_table_reader_enter(st_table_pool_t *pool) {
 
-    st_table_pool_t *pool = table->pool;
+    st_table_reclaim_t *reclaim = &pool->reclaim;
 
-    int ret = st_table_destroy(table);
-    if (ret != ST_OK) {
-        return ret;
+    int idx = st_table_reader_slot(reclaim);
+    if (idx < 0) {
+        return ST_AGAIN;
     }
 
-    pool->table_cnt--;
+    int64_t *readers = reclaim->slots[idx].readers;
 
-    return st_slab_obj_free(&pool->slab_pool, table);
-}
+    while (1) {
+        int64_t epoch = st_atomic_load(&reclaim->epoch);
+        int parity = epoch % 2;
 
-static int st_table_remove_all_elements(st_table_t *table, st_rbtree_node_t *node,
-                                        int removed_flag) {
+        st_atomic_incr(&readers[parity], 1);
 
-    st_rbtree_node_t *sentinel = &table->elements.sentinel;
+        // epoch may advanced before registered, then writers may not wait for
+        // the slot any more.
+        if (st_atomic_load(&reclaim->epoch) == epoch) {
+            return idx * 2 + parity;
+        }
 
-    if (node == sentinel) {
-        return ST_OK;
+        st_atomic_decr(&readers[parity], 1);
     }
+}
 
-    int ret = st_table_remove_all_elements(table, node->left, removed_flag);
-    if (ret != ST_OK) {
-        return ret;
-    }
+void st_table_reader_leave(st_table_pool_t *pool, int slot) {
+    st_atomic_decr(&pool->reclaim.slots[slot / 2].readers[slot % 2], 1);
+}
 
-    ret = st_table_remove_all_elements(table, node->right, removed_flag);
+static int st_table_reclaim_init(st_table_reclaim_t *reclaim) {
+
+    int ret = st_robustlock_init(&reclaim->lock);
     if (ret != ST_OK) {
         return ret;
     }
 
-    st_table_element_t *e = st_owner(node, st_table_element_t, rbnode);
+    pthread_once(&st_table_reader_once, st_table_reader_register_fork);
 
-    if (removed_flag == ST_TABLE_PUSH_TO_GC) {
-        if (st_types_is_table(e->value.type)) {
-            st_table_t *t = st_table_get_table_addr_from_value(e->value);
+    reclaim->epoch = 0;
+    reclaim->slot_cnt = 0;
 
-            ret = st_gc_push_to_sweep(&t->pool->gc, &t->gc_head);
-            st_assert(ret == ST_OK);
-        }
+    for (int i = 0; i < ST_TABLE_READER_SLOT_CNT; i++) {
+        reclaim->slots[i].pid = 0;
+        reclaim->slots[i].readers[0] = 0;
+        reclaim->slots[i].readers[1] = 0;
     }
 
-    table->version++;
+    for (int i = 0; i < 3; i++) {
+        reclaim->retired[i] = NULL;
+    }
 
-    return st_table_free_element(table, e);
+    return ST_OK;
 }
 
-// this function is only used for gc, other one please use st_table_remove_all.
-int st_table_remove_all_for_gc(st_table_t *table) {
+static int st_table_reclaim_destroy(st_table_pool_t *pool) {
 
-    st_must(table != NULL, ST_ARG_INVALID);
-    st_must(table->inited, ST_UNINITED);
+    st_table_reclaim_t *reclaim = &pool->reclaim;
 
-    int ret;
-    st_robustlock_lock(&table->lock);
+    st_robustlock_lock(&reclaim->lock);
+    st_table_retired_t *all = st_table_reclaim_detach_all(reclaim);
+    st_robustlock_unlock(&reclaim->lock);
 
-    ret = st_table_remove_all_elements(table, table->elements.root, ST_TABLE_NOT_PUSH_TO_GC);
+    int ret = st_table_free_retired_list(pool, all);
     if (ret != ST_OK) {
-        goto quit;
+        return ret;
     }
 
-    table->elements.root = &table->elements.sentinel;
-    table->element_cnt = 0;
-
-quit:
-    st_robustlock_unlock(&table->lock);
-    return ret;
+    return st_robustlock_destroy(&reclaim->lock);
 }
 
-int st_table_remove_all(st_table_t *table) {
+static int st_table_key_internable(st_table_pool_t *pool, st_str_t *key) {
 
-    st_must(table != NULL, ST_ARG_INVALID);
-    st_must(table->inited, ST_UNINITED);
+    if (key->type != ST_TYPES_STRING) {
+        return 0;
+    }
 
-    st_gc_t *gc = &table->pool->gc;
+    return key->len <= st_atomic_load(&pool->intern.max_key_len, __ATOMIC_RELAXED);
+}
 
-    int ret;
-    st_robustlock_lock(&gc->lock);
-    st_robustlock_lock(&table->lock);
+// bytes taken by tails of element before its key.
+static ssize_t st_table_element_tails_size(uint32_t flags) {
 
-    ret = st_table_remove_all_elements(table, table->elements.root, ST_TABLE_PUSH_TO_GC);
-    if (ret != ST_OK) {
-        goto quit;
+    ssize_t size = 0;
+
+    if (flags & ST_TABLE_ELEMENT_TTL) {
+        size += sizeof(st_table_ttl_tail_t);
     }
 
-    table->elements.root = &table->elements.sentinel;
-    table->element_cnt = 0;
+    if (flags & ST_TABLE_ELEMENT_CACHE) {
+        size += sizeof(st_table_cache_tail_t);
+    }
 
-quit:
-    st_robustlock_unlock(&table->lock);
-    st_robustlock_unlock(&gc->lock);
+    return size;
+}
 
-    if (ret == ST_OK) {
-        return st_table_run_gc_if_needed(table);
+// key and value bytes stored in element start here.
+static uint8_t *st_table_element_data(st_table_element_t *elem) {
+    return elem->kv_data + st_table_element_tails_size(elem->flags);
+}
+
+static st_table_cache_tail_t *st_table_element_cache(st_table_element_t *elem) {
+
+    if (!(elem->flags & ST_TABLE_ELEMENT_CACHE)) {
+        return NULL;
     }
 
-    return ret;
+    // cache tail follows ttl tail.
+    ssize_t offset = st_table_element_tails_size(elem->flags & ST_TABLE_ELEMENT_TTL);
+
+    return (st_table_cache_tail_t *)(elem->kv_data + offset);
 }
 
-int st_table_set_key_value(st_table_t *table, st_str_t key, st_str_t value) {
+static st_table_ttl_tail_t *st_table_element_ttl(st_table_element_t *elem) {
 
-    st_must(table != NULL, ST_ARG_INVALID);
-    st_must(table->inited, ST_UNINITED);
-    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
-    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+    if (!(elem->flags & ST_TABLE_ELEMENT_TTL)) {
+        return NULL;
+    }
 
-    st_table_t *t = NULL;
-    st_table_element_t *elem = NULL;
-    st_table_element_t *existed_elem = NULL;
+    return (st_table_ttl_tail_t *)elem->kv_data;
+}
 
-    st_gc_t *gc = &table->pool->gc;
+static st_table_intern_key_t *st_table_element_intern_key(st_table_element_t *elem) {
 
-    int ret = st_table_new_element(table, key, value, &elem);
-    if (ret != ST_OK) {
-        return ret;
+    if (elem->key.bytes == st_table_element_data(elem)) {
+        return NULL;
     }
 
-    st_robustlock_lock(&gc->lock);
+    return st_owner(elem->key.bytes, st_table_intern_key_t, bytes);
+}
 
-    ret = st_table_add_element(table, elem, 1, &existed_elem);
-    if (ret != ST_OK && ret != ST_EXISTED) {
-        st_table_free_element(table, elem);
-        st_robustlock_unlock(&gc->lock);
-        return ret;
-    }
+// lock intern before use the function.
+// it does not matter if it fails, then buckets are just more crowded.
+static void st_table_intern_resize(st_table_pool_t *pool, int64_t capacity) {
 
-    if (ret == ST_EXISTED) {
-        if (st_types_is_table(existed_elem->value.type)) {
-            t = st_table_get_table_addr_from_value(existed_elem->value);
+    st_table_intern_t *intern = &pool->intern;
+    st_table_intern_key_t **buckets = NULL;
 
-            ret = st_gc_push_to_sweep(gc, &t->gc_head);
-            st_assert(ret == ST_OK);
-        }
+    int ret = st_slab_obj_alloc(&pool->slab_pool, sizeof(*buckets) * capacity,
+                                (void **)&buckets);
+    if (ret != ST_OK) {
+        return;
     }
 
-    if (st_types_is_table(value.type)) {
-        t = st_table_get_table_addr_from_value(value);
-
-        ret = st_gc_push_to_mark(gc, &t->gc_head);
-        st_assert(ret == ST_OK);
+    for (int64_t i = 0; i < capacity; i++) {
+        buckets[i] = NULL;
     }
 
-    st_robustlock_unlock(&gc->lock);
+    for (int64_t i = 0; i < intern->capacity; i++) {
+        st_table_intern_key_t *ikey = intern->buckets[i];
 
-    if (existed_elem != NULL) {
-        ret = st_table_free_element(table, existed_elem);
-        if (ret != ST_OK) {
-            return ret;
+        while (ikey != NULL) {
+            st_table_intern_key_t *next = ikey->next;
+            int64_t idx = ikey->hash & (capacity - 1);
+
+            ikey->next = buckets[idx];
+            buckets[idx] = ikey;
+
+            ikey = next;
         }
     }
 
-    return st_table_run_gc_if_needed(table);
+    if (intern->buckets != NULL) {
+        (void)st_slab_obj_free(&pool->slab_pool, intern->buckets);
+    }
+
+    intern->buckets = buckets;
+    intern->capacity = capacity;
 }
 
-int st_table_add_key_value(st_table_t *table, st_str_t key, st_str_t value) {
+// get the interned key equal to key and add a reference to it, it is
+// interned if it is not yet. hash must be st_table_hash_key(key).
+static int st_table_intern_acquire(st_table_pool_t *pool, st_str_t *key, uint64_t hash,
+                                   st_table_intern_key_t **ikey) {
 
-    st_must(table != NULL, ST_ARG_INVALID);
-    st_must(table->inited, ST_UNINITED);
+    st_table_intern_t *intern = &pool->intern;
+    st_table_intern_key_t *k = NULL;
+    int ret = ST_OK;
+
+    st_robustlock_lock(&intern->lock);
+
+    if (intern->buckets == NULL) {
+        st_table_intern_resize(pool, ST_TABLE_INTERN_MIN_CAPACITY);
+
+        if (intern->buckets == NULL) {
+            ret = ST_OUT_OF_MEMORY;
+            goto quit;
+        }
+    }
+
+    int64_t idx = hash & (intern->capacity - 1);
+
+    for (k = intern->buckets[idx]; k != NULL; k = k->next) {
+        if (k->hash == hash && k->len == key->len
+                && st_memcmp(k->bytes, key->bytes, key->len) == 0) {
+            k->refcnt++;
+            goto quit;
+        }
+    }
+
+    ret = st_slab_obj_alloc(&pool->slab_pool, sizeof(*k) + key->len + 1, (void **)&k);
+    if (ret != ST_OK) {
+        goto quit;
+    }
+
+    k->retired.next = NULL;
+    k->hash = hash;
+    k->refcnt = 1;
+    k->len = key->len;
+
+    st_memcpy(k->bytes, key->bytes, key->len);
+    k->bytes[key->len] = 0;
+
+    k->next = intern->buckets[idx];
+    intern->buckets[idx] = k;
+    intern->cnt++;
+
+    if (intern->cnt > intern->capacity) {
+        st_table_intern_resize(pool, intern->capacity * 2);
+    }
+
+quit:
+    st_robustlock_unlock(&intern->lock);
+
+    *ikey = k;
+
+    return ret;
+}
+
+// remove a reference to interned key, it is retired after the last one.
+static int st_table_intern_release(st_table_pool_t *pool, st_table_intern_key_t *ikey) {
+
+    st_table_intern_t *intern = &pool->intern;
+
+    st_robustlock_lock(&intern->lock);
+
+    ikey->refcnt--;
+    if (ikey->refcnt > 0) {
+        st_robustlock_unlock(&intern->lock);
+        return ST_OK;
+    }
+
+    st_table_intern_key_t **p = &intern->buckets[ikey->hash & (intern->capacity - 1)];
+
+    while (*p != ikey) {
+        p = &(*p)->next;
+    }
+
+    *p = ikey->next;
+    intern->cnt--;
+
+    st_robustlock_unlock(&intern->lock);
+
+    return st_table_retire(pool, &ikey->retired);
+}
+
+// start to modify table, lock table before use the function.
+// lock free readers started before st_table_write_end will retry.
+static int64_t st_table_write_begin(st_table_t *table) {
+
+    int64_t version = table->version;
+
+    // version may be odd if the last writer died in modifying.
+    st_atomic_store(&table->version, (version + 1) | 1);
+
+    // order the version store before modifying table.
+    st_atomic_fence(ST_ATOMIC_STRONGEST);
+
+    return version;
+}
+
+static void st_table_write_end(st_table_t *table) {
+    st_atomic_store(&table->version, table->version + 1);
+}
+
+// nothing in table is changed, readers need not retry.
+static void st_table_write_cancel(st_table_t *table, int64_t version) {
+
+    if (version % 2 != 0) {
+        st_table_write_end(table);
+        return;
+    }
+
+    st_atomic_store(&table->version, version);
+}
+
+static int st_table_hash_index_new(st_table_t *table, int64_t capacity,
+                                   st_table_hash_index_t **index) {
+
+    st_table_hash_index_t *idx = NULL;
+    ssize_t size = sizeof(st_table_hash_index_t) + capacity * sizeof(st_table_element_t *);
+
+    int ret = st_slab_obj_alloc(&table->pool->slab_pool, size, (void **)&idx);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    idx->capacity = capacity;
+    idx->used = 0;
+    memset(idx->slots, 0, capacity * sizeof(st_table_element_t *));
+
+    *index = idx;
+
+    return ST_OK;
+}
+
+static int st_table_hash_index_free(st_table_t *table, st_table_hash_index_t *index) {
+    return st_table_retire(table->pool, &index->retired);
+}
+
+static int64_t st_table_hash_index_home(st_table_hash_index_t *index, uint64_t hash) {
+    return hash & (index->capacity - 1);
+}
+
+// return slot index of the element with the key, or -1 if not found.
+// hash must be st_table_hash_key(key).
+static int64_t st_table_hash_index_find(st_table_hash_index_t *index, st_str_t *key,
+                                        uint64_t hash) {
+
+    int64_t mask = index->capacity - 1;
+    int64_t i = st_table_hash_index_home(index, hash);
+
+    while (index->slots[i] != NULL) {
+        st_table_element_t *e = index->slots[i];
+
+        if (e->key_hash == (uint32_t)hash
+                && (st_table_key_same(&e->key, key) || st_str_cmp(&e->key, key) == 0)) {
+            return i;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return -1;
+}
+
+// caller must guarantee there is free slot and the key is not in index.
+static void st_table_hash_index_insert(st_table_hash_index_t *index, st_table_element_t *elem) {
+
+    int64_t mask = index->capacity - 1;
+    int64_t i = st_table_hash_index_home(index, elem->key_hash);
+
+    while (index->slots[i] != NULL) {
+        i = (i + 1) & mask;
+    }
+
+    index->slots[i] = elem;
+    index->used++;
+}
+
+// remove the slot and shift following elements backward, so that no tombstone
+// is needed in linear probing.
+static void st_table_hash_index_remove_slot(st_table_hash_index_t *index, int64_t i) {
+
+    int64_t mask = index->capacity - 1;
+    int64_t j = i;
+    int64_t home;
+
+    index->slots[i] = NULL;
+    index->used--;
+
+    while (1) {
+        j = (j + 1) & mask;
+
+        if (index->slots[j] == NULL) {
+            return;
+        }
+
+        home = st_table_hash_index_home(index, index->slots[j]->key_hash);
+
+        // the element in slot j can be moved to slot i only if its home is
+        // not in the cyclic range (i, j].
+        if ((j > i && (home <= i || home > j)) || (j < i && (home <= i && home > j))) {
+            index->slots[i] = index->slots[j];
+            index->slots[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+static int st_table_hash_index_resize(st_table_t *table, int64_t capacity) {
+
+    st_table_hash_index_t *old = table->hash_index;
+    st_table_hash_index_t *index = NULL;
+
+    int ret = st_table_hash_index_new(table, capacity, &index);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    for (int64_t i = 0; i < old->capacity; i++) {
+        if (old->slots[i] != NULL) {
+            st_table_hash_index_insert(index, old->slots[i]);
+        }
+    }
+
+    st_atomic_store(&table->hash_index, index);
+
+    return st_table_hash_index_free(table, old);
+}
+
+// make sure there is room for one more element before modifying rbtree,
+// so that the rbtree and the index never disagree on failure.
+static int st_table_hash_index_reserve(st_table_t *table) {
+
+    st_table_hash_index_t *index = table->hash_index;
+
+    if (index == NULL || (index->used + 1) * 4 <= index->capacity * 3) {
+        return ST_OK;
+    }
+
+    return st_table_hash_index_resize(table, index->capacity * 2);
+}
+
+static void st_table_hash_index_shrink_if_needed(st_table_t *table) {
+
+    st_table_hash_index_t *index = table->hash_index;
+
+    if (index == NULL || index->capacity <= ST_TABLE_HASH_INDEX_MIN_CAPACITY) {
+        return;
+    }
+
+    if (index->used * 8 >= index->capacity) {
+        return;
+    }
+
+    // it is fine to keep the bigger index if failed to shrink.
+    (void)st_table_hash_index_resize(table, index->capacity / 2);
+}
+
+static st_str_t *st_table_element_key(void *elem) {
+    return &((st_table_element_t *)elem)->key;
+}
+
+// only string keys are in prefix index.
+static int st_table_prefix_indexed(st_table_t *table, st_str_t *key) {
+    return table->prefix_index != NULL && key->type == ST_TYPES_STRING;
+}
+
+static int st_table_key_has_prefix(st_str_t *key, st_str_t *prefix) {
+
+    if (key->type != ST_TYPES_STRING || key->len < prefix->len) {
+        return 0;
+    }
+
+    return prefix->len == 0 || st_memcmp(key->bytes, prefix->bytes, prefix->len) == 0;
+}
+
+// return slot index of the key in array part, or -1 if the key does not
+// belong to array part.
+static int64_t st_table_array_index(st_table_array_t *array, st_str_t *key) {
+
+    if (array == NULL || key->type != ST_TYPES_INTEGER) {
+        return -1;
+    }
+
+    int64_t k = *(int *)key->bytes;
+
+    if (k < 1 || k > array->capacity) {
+        return -1;
+    }
+
+    return k - 1;
+}
+
+// return the first element in array part from slot i towards right.
+static st_table_element_t *st_table_array_first_from(st_table_array_t *array, int64_t i) {
+
+    for (i = st_max(i, 0); i < array->capacity; i++) {
+        if (array->slots[i] != NULL) {
+            return array->slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+// return the first element in array part from slot i towards left.
+static st_table_element_t *st_table_array_last_from(st_table_array_t *array, int64_t i) {
+
+    for (i = st_min(i, array->capacity - 1); i >= 0; i--) {
+        if (array->slots[i] != NULL) {
+            return array->slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+// search array part the same way as st_rbtree_search.
+static st_table_element_t *st_table_array_search(st_table_array_t *array, st_str_t *key,
+                                                 int expected_side) {
+
+    if (array == NULL) {
+        return NULL;
+    }
+
+    int left = st_side_strip_eq(expected_side) == ST_SIDE_LEFT;
+    int right = st_side_strip_eq(expected_side) == ST_SIDE_RIGHT;
+
+    // st_str_cmp compares type first.
+    if (key->type < ST_TYPES_INTEGER) {
+        return right ? st_table_array_first_from(array, 0) : NULL;
+    }
+
+    if (key->type > ST_TYPES_INTEGER) {
+        return left ? st_table_array_last_from(array, array->capacity - 1) : NULL;
+    }
+
+    int64_t k = *(int *)key->bytes;
+
+    switch (expected_side) {
+        case ST_SIDE_EQ:
+            return (k >= 1 && k <= array->capacity) ? array->slots[k - 1] : NULL;
+        case ST_SIDE_RIGHT_EQ:
+            return st_table_array_first_from(array, k - 1);
+        case ST_SIDE_RIGHT:
+            return st_table_array_first_from(array, k);
+        case ST_SIDE_LEFT_EQ:
+            return st_table_array_last_from(array, k - 1);
+        case ST_SIDE_LEFT:
+            return st_table_array_last_from(array, k - 2);
+    }
+
+    return NULL;
+}
+
+// compare key with prefix to key of small part entry, the same as st_str_cmp.
+static int st_table_small_cmp_key(st_str_t *key, uint64_t prefix, st_table_small_entry_t *entry) {
+
+    if (key->type != entry->key_type) {
+        return key->type < entry->key_type ? -1 : 1;
+    }
+
+    if (prefix != entry->key_prefix) {
+        return prefix < entry->key_prefix ? -1 : 1;
+    }
+
+    if (st_table_key_same(key, &entry->element->key)) {
+        return 0;
+    }
+
+    return st_str_cmp(key, &entry->element->key);
+}
+
+// return index of the first entry in small part not less than key, found is
+// set to 1 if its key is equal to key.
+static int64_t st_table_small_lower_bound(st_table_t *table, st_str_t *key, int *found) {
+
+    uint64_t prefix = st_table_key_prefix(key);
+    int64_t lo = 0;
+    int64_t hi = table->small_cnt;
+
+    *found = 0;
+
+    while (lo < hi) {
+        int64_t mid = (lo + hi) / 2;
+
+        int ret = st_table_small_cmp_key(key, prefix, &table->small[mid]);
+        if (ret == 0) {
+            *found = 1;
+            return mid;
+        }
+
+        if (ret < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
+// search small part the same way as st_rbtree_search.
+static st_table_element_t *st_table_small_search(st_table_t *table, st_str_t *key,
+                                                 int expected_side) {
+    int found;
+    int64_t i = st_table_small_lower_bound(table, key, &found);
+
+    switch (expected_side) {
+        case ST_SIDE_EQ:
+            break;
+        case ST_SIDE_RIGHT_EQ:
+            found = i < table->small_cnt;
+            break;
+        case ST_SIDE_RIGHT:
+            i += found;
+            found = i < table->small_cnt;
+            break;
+        case ST_SIDE_LEFT_EQ:
+            if (!found) {
+                i--;
+                found = i >= 0;
+            }
+            break;
+        case ST_SIDE_LEFT:
+            i--;
+            found = i >= 0;
+            break;
+        default:
+            found = 0;
+            break;
+    }
+
+    return found ? table->small[i].element : NULL;
+}
+
+// move elements in small part to rbtree, elements in the same table have
+// different keys, so moving never fails.
+static void st_table_small_to_tree(st_table_t *table) {
+
+    for (int64_t i = 0; i < table->small_cnt; i++) {
+        st_table_element_t *e = table->small[i].element;
+
+        int ret = st_rbtree_insert(&table->elements, &e->rbnode, 0, NULL);
+        st_assert(ret == ST_OK);
+    }
+
+    st_atomic_store(&table->small_cnt, -1);
+}
+
+// insert an element which is not in array part into small part or rbtree.
+// it returns ST_EXISTED and sets existed if the key is already in table.
+static int st_table_sorted_insert(st_table_t *table, st_table_element_t *elem,
+                                  st_table_element_t **existed) {
+
+    st_rbtree_node_t *existed_node = NULL;
+
+    if (table->small_cnt >= 0) {
+        int found;
+        int64_t i = st_table_small_lower_bound(table, &elem->key, &found);
+
+        if (found) {
+            *existed = table->small[i].element;
+            return ST_EXISTED;
+        }
+
+        if (table->small_cnt < ST_TABLE_SMALL_CAPACITY) {
+            memmove(&table->small[i + 1], &table->small[i],
+                    (table->small_cnt - i) * sizeof(st_table_small_entry_t));
+
+            table->small[i].key_type = elem->key.type;
+            table->small[i].key_prefix = elem->key_prefix;
+            table->small[i].element = elem;
+            table->small_cnt++;
+
+            return ST_OK;
+        }
+
+        st_table_small_to_tree(table);
+    }
+
+    int ret = st_rbtree_insert(&table->elements, &elem->rbnode, 0, &existed_node);
+    if (ret == ST_EXISTED) {
+        *existed = st_owner(existed_node, st_table_element_t, rbnode);
+    }
+
+    return ret;
+}
+
+// replace an element in small part or rbtree with one of the same key.
+static int st_table_sorted_replace(st_table_t *table, st_table_element_t *existed,
+                                   st_table_element_t *elem) {
+
+    if (table->small_cnt < 0) {
+        return st_rbtree_replace(&table->elements, &existed->rbnode, &elem->rbnode);
+    }
+
+    int found;
+    int64_t i = st_table_small_lower_bound(table, &existed->key, &found);
+    st_assert(found);
+
+    table->small[i].element = elem;
+
+    return ST_OK;
+}
+
+// remove an element from small part or rbtree, small part is used again once
+// rbtree becomes empty.
+static void st_table_sorted_delete(st_table_t *table, st_table_element_t *elem) {
+
+    if (table->small_cnt < 0) {
+        st_rbtree_delete(&table->elements, &elem->rbnode);
+
+        if (st_rbtree_is_empty(&table->elements)) {
+            st_atomic_store(&table->small_cnt, 0);
+        }
+
+        return;
+    }
+
+    int found;
+    int64_t i = st_table_small_lower_bound(table, &elem->key, &found);
+    st_assert(found);
+
+    table->small_cnt--;
+    memmove(&table->small[i], &table->small[i + 1],
+            (table->small_cnt - i) * sizeof(st_table_small_entry_t));
+}
+
+static st_table_element_t *st_table_sorted_first(st_table_t *table) {
+
+    if (table->small_cnt >= 0) {
+        return table->small_cnt == 0 ? NULL : table->small[0].element;
+    }
+
+    st_rbtree_node_t *n = st_rbtree_left_most(&table->elements);
+    if (n == NULL) {
+        return NULL;
+    }
+
+    return st_owner(n, st_table_element_t, rbnode);
+}
+
+static st_table_element_t *st_table_sorted_next(st_table_t *table, st_table_element_t *elem) {
+
+    if (table->small_cnt >= 0) {
+        return st_table_small_search(table, &elem->key, ST_SIDE_RIGHT);
+    }
+
+    st_rbtree_node_t *n = st_rbtree_get_next(&table->elements, &elem->rbnode);
+    if (n == NULL) {
+        return NULL;
+    }
+
+    return st_owner(n, st_table_element_t, rbnode);
+}
+
+// search small part or rbtree, whichever is used.
+static st_table_element_t *st_table_tree_search(st_table_t *table, st_str_t *key,
+                                                int expected_side) {
+
+    if (table->small_cnt >= 0) {
+        return st_table_small_search(table, key, expected_side);
+    }
+
+    st_table_element_t target = {.key = *key, .key_prefix = st_table_key_prefix(key)};
+
+    st_rbtree_node_t *n = st_rbtree_search(&table->elements, &target.rbnode, expected_side);
+    if (n == NULL) {
+        return NULL;
+    }
+
+    return st_owner(n, st_table_element_t, rbnode);
+}
+
+// choose the one nearer to the target from results of array part and rbtree.
+static st_table_element_t *st_table_nearer_element(st_table_element_t *a, st_table_element_t *b,
+                                                   int expected_side) {
+    if (a == NULL) {
+        return b;
+    }
+
+    if (b == NULL) {
+        return a;
+    }
+
+    int ret = st_table_cmp_key(&a->key, a->key_prefix, b);
+
+    if (st_side_strip_eq(expected_side) == ST_SIDE_LEFT) {
+        return ret > 0 ? a : b;
+    }
+
+    return ret < 0 ? a : b;
+}
+
+// search both array part and rbtree, like st_rbtree_search.
+static st_table_element_t *st_table_search_element(st_table_t *table, st_str_t *key,
+                                                   int expected_side) {
+
+    st_table_element_t *a = st_table_array_search(table->array, key, expected_side);
+    st_table_element_t *t = st_table_tree_search(table, key, expected_side);
+
+    return st_table_nearer_element(a, t, expected_side);
+}
+
+static st_table_element_t *st_table_first_element(st_table_t *table) {
+
+    st_table_element_t *a = NULL;
+    st_table_element_t *t = st_table_sorted_first(table);
+
+    if (table->array != NULL) {
+        a = st_table_array_first_from(table->array, 0);
+    }
+
+    return st_table_nearer_element(a, t, ST_SIDE_RIGHT);
+}
+
+static st_table_element_t *st_table_next_element(st_table_t *table, st_table_element_t *elem) {
+
+    st_table_array_t *array = table->array;
+
+    int64_t i = st_table_array_index(array, &elem->key);
+    if (i >= 0) {
+        // keys in rbtree are all less than 1 or greater than array capacity.
+        st_table_element_t *next = st_table_array_first_from(array, i + 1);
+        if (next != NULL) {
+            return next;
+        }
+
+        return st_table_tree_search(table, &elem->key, ST_SIDE_RIGHT);
+    }
+
+    st_table_element_t *t = st_table_sorted_next(table, elem);
+    st_table_element_t *a = st_table_array_search(array, &elem->key, ST_SIDE_RIGHT);
+
+    return st_table_nearer_element(a, t, ST_SIDE_RIGHT);
+}
+
+// like st_table_first_element, st_table_search_element and
+// st_table_next_element, but elements of all shards of a sharded table are
+// visited in key order. all shards must be locked.
+static st_table_element_t *st_table_merged_first(st_table_t *table) {
+
+    if (table->shards == NULL) {
+        return st_table_first_element(table);
+    }
+
+    st_table_element_t *first = NULL;
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        st_table_element_t *e = st_table_first_element(table->shards[i]);
+        first = st_table_nearer_element(first, e, ST_SIDE_RIGHT);
+    }
+
+    return first;
+}
+
+static st_table_element_t *st_table_merged_search(st_table_t *table, st_str_t *key,
+                                                  int expected_side) {
+
+    if (table->shards == NULL) {
+        return st_table_search_element(table, key, expected_side);
+    }
+
+    st_table_element_t *found = NULL;
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        st_table_element_t *e = st_table_search_element(table->shards[i], key, expected_side);
+        found = st_table_nearer_element(found, e, expected_side);
+    }
+
+    return found;
+}
+
+static st_table_element_t *st_table_merged_next(st_table_t *table, st_table_element_t *elem) {
+
+    if (table->shards == NULL) {
+        return st_table_next_element(table, elem);
+    }
+
+    return st_table_merged_search(table, &elem->key, ST_SIDE_RIGHT);
+}
+
+// any modification to any shard changes version of a sharded table.
+static int64_t st_table_merged_version(st_table_t *table) {
+
+    if (table->shards == NULL) {
+        return table->version;
+    }
+
+    int64_t version = 0;
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        version += table->shards[i]->version;
+    }
+
+    return version;
+}
+
+static int64_t st_table_merged_cnt(st_table_t *table) {
+
+    if (table->shards == NULL) {
+        return table->element_cnt;
+    }
+
+    int64_t cnt = 0;
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        cnt += table->shards[i]->element_cnt;
+    }
+
+    return cnt;
+}
+
+// the first element whose key starts with prefix, NULL if there is none.
+// prefix index finds it without comparing whole keys, or it is searched in
+// rbtree.
+static st_table_element_t *st_table_prefix_first(st_table_t *table, st_str_t *prefix) {
+
+    st_table_element_t *e = NULL;
+
+    if (table->shards != NULL) {
+        st_table_element_t *first = NULL;
+
+        for (int64_t i = 0; i < table->shard_cnt; i++) {
+            e = st_table_prefix_first(table->shards[i], prefix);
+            first = st_table_nearer_element(first, e, ST_SIDE_RIGHT);
+        }
+
+        return first;
+    }
+
+    if (table->prefix_index != NULL) {
+        if (st_art_prefix_first(table->prefix_index, prefix, (void **)&e) != ST_OK) {
+            return NULL;
+        }
+
+        return e;
+    }
+
+    e = st_table_search_element(table, prefix, ST_SIDE_RIGHT_EQ);
+    if (e == NULL || !st_table_key_has_prefix(&e->key, prefix)) {
+        return NULL;
+    }
+
+    return e;
+}
+
+// resize array part and move elements between array part and small part or
+// rbtree. elements in the same table have different keys, so moving never
+// fails.
+static int st_table_array_resize(st_table_t *table, int64_t capacity) {
+
+    st_table_array_t *old = table->array;
+    st_table_array_t *array = NULL;
+    int64_t old_capacity = old == NULL ? 0 : old->capacity;
+
+    if (capacity > 0) {
+        ssize_t size = sizeof(st_table_array_t) + capacity * sizeof(st_table_element_t *);
+
+        int ret = st_slab_obj_alloc(&table->pool->slab_pool, size, (void **)&array);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        array->capacity = capacity;
+        memset(array->slots, 0, capacity * sizeof(st_table_element_t *));
+
+        int64_t cnt = st_min(capacity, old_capacity);
+        if (cnt > 0) {
+            st_memcpy(array->slots, old->slots, cnt * sizeof(st_table_element_t *));
+        }
+    }
+
+    // shrink: move elements out of new capacity to rbtree.
+    for (int64_t i = capacity; i < old_capacity; i++) {
+        st_table_element_t *e = old->slots[i];
+        if (e == NULL) {
+            continue;
+        }
+
+        st_table_element_t *existed = NULL;
+
+        int ret = st_table_sorted_insert(table, e, &existed);
+        st_assert(ret == ST_OK);
+
+        table->array_cnt--;
+    }
+
+    // grow: move elements with key in (old_capacity, capacity] to array.
+    if (capacity > old_capacity) {
+        int k = old_capacity + 1;
+        st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+
+        st_table_element_t *e = st_table_tree_search(table, &key, ST_SIDE_RIGHT_EQ);
+
+        while (e != NULL) {
+            int64_t i = st_table_array_index(array, &e->key);
+            if (i < 0) {
+                break;
+            }
+
+            st_table_element_t *next = st_table_sorted_next(table, e);
+
+            st_table_sorted_delete(table, e);
+            array->slots[i] = e;
+            table->array_cnt++;
+
+            e = next;
+        }
+    }
+
+    st_atomic_store(&table->array, array);
+
+    if (old != NULL) {
+        return st_table_retire(table->pool, &old->retired);
+    }
+
+    return ST_OK;
+}
+
+// grow array part before adding an element with the key.
+// return 1 if elements are moved, it is fine to keep elements in rbtree if
+// failed to grow.
+static int st_table_array_grow_if_needed(st_table_t *table, st_str_t *key) {
+
+    if (key->type != ST_TYPES_INTEGER) {
+        return 0;
+    }
+
+    int64_t k = *(int *)key->bytes;
+    int64_t capacity = table->array == NULL ? 0 : table->array->capacity;
+    int grown = 0;
+
+    // count the element being added.
+    while (k == capacity + 1 && (capacity == 0 || (table->array_cnt + 1) * 2 > capacity)) {
+
+        if (capacity * 2 > INT_MAX) {
+            break;
+        }
+
+        int64_t new_capacity = st_max(capacity * 2, ST_TABLE_ARRAY_MIN_CAPACITY);
+
+        if (st_table_array_resize(table, new_capacity) != ST_OK) {
+            break;
+        }
+
+        grown = 1;
+        capacity = new_capacity;
+
+        // keys added in descending order are still in rbtree, keep moving
+        // them to array part.
+        int next = capacity + 1;
+        st_str_t next_key = st_str_wrap_common(&next, ST_TYPES_INTEGER, sizeof(next));
+
+        k = st_table_tree_search(table, &next_key, ST_SIDE_EQ) == NULL ? -1 : next;
+    }
+
+    return grown;
+}
+
+static void st_table_array_shrink_if_needed(st_table_t *table) {
+
+    st_table_array_t *array = table->array;
+
+    if (array == NULL) {
+        return;
+    }
+
+    // it is fine to keep the bigger array if failed to shrink.
+    if (table->array_cnt == 0) {
+        (void)st_table_array_resize(table, 0);
+
+    } else if (array->capacity > ST_TABLE_ARRAY_MIN_CAPACITY
+               && table->array_cnt * 4 < array->capacity) {
+        (void)st_table_array_resize(table, array->capacity / 2);
+    }
+}
+
+static st_table_blob_t *st_table_element_blob(st_table_element_t *elem) {
+
+    if (!(elem->flags & ST_TABLE_ELEMENT_BLOB)) {
+        return NULL;
+    }
+
+    return st_owner(elem->value.bytes, st_table_blob_t, bytes);
+}
+
+static int st_table_blob_release(st_table_pool_t *pool, st_table_blob_t *blob) {
+
+    if (st_atomic_decr(&blob->refcnt, 1) > 0) {
+        return ST_OK;
+    }
+
+    return st_table_retire(pool, &blob->retired);
+}
+
+// blob is NULL if value is stored in element, or a blob holding value bytes
+// whose reference is taken over by the new element.
+// expire_at is expire time in usec of element, 0 if it never expires.
+static int st_table_new_element_with_blob(st_table_t *table, st_str_t key, st_str_t value,
+                                          st_table_blob_t *blob, int64_t expire_at,
+                                          st_table_element_t **elem) {
+    st_assert(key.len <= key.capacity);
+    st_assert(value.len <= value.capacity);
+
+    st_table_pool_t *pool = table->pool;
+    st_table_element_t *e = NULL;
+    st_table_intern_key_t *ikey = NULL;
+
+    uint64_t hash = st_table_hash_key(&key);
+    ssize_t key_size = st_align(key.capacity, 8);
+    ssize_t value_size = value.capacity;
+
+    // key of element with blob takes no more than it needs, so that the size
+    // of element can be got from its key.
+    if (blob != NULL) {
+        st_str_t k = st_str_wrap_common(key.bytes, key.type, key.len);
+        key_size = st_align(k.capacity, 8);
+        value_size = 0;
+    }
+
+    // key is stored in element if it can not be interned.
+    if (st_table_key_internable(pool, &key)
+            && st_table_intern_acquire(pool, &key, hash, &ikey) == ST_OK) {
+        key_size = 0;
+    }
+
+    // elements of cache table and elements with ttl carry bookkeeping of them
+    // in their tails.
+    uint32_t flags = blob != NULL ? ST_TABLE_ELEMENT_BLOB : 0;
+    if (st_atomic_load(&table->cache, __ATOMIC_RELAXED)) {
+        flags |= ST_TABLE_ELEMENT_CACHE;
+    }
+
+    if (expire_at != 0) {
+        flags |= ST_TABLE_ELEMENT_TTL;
+    }
+
+    ssize_t size = sizeof(st_table_element_t) + st_table_element_tails_size(flags)
+                   + key_size + value_size;
+
+    int ret = st_slab_obj_alloc(&pool->slab_pool, size, (void **)&e);
+    if (ret != ST_OK) {
+        if (ikey != NULL) {
+            (void)st_table_intern_release(pool, ikey);
+        }
+        return ret;
+    }
+
+    e->rbnode = (st_rbtree_node_t)st_rbtree_node_empty;
+    e->flags = flags;
+
+    st_table_ttl_tail_t *ttl = st_table_element_ttl(e);
+    if (ttl != NULL) {
+        ttl->expire_at = expire_at;
+        st_list_init(&ttl->lnode);
+    }
+
+    st_table_cache_tail_t *cache = st_table_element_cache(e);
+    if (cache != NULL) {
+        st_list_init(&cache->lnode);
+        // new element is not evicted before the clock hand passes it once.
+        cache->referenced = 1;
+        cache->offset = (uint8_t *)cache - (uint8_t *)e;
+    }
+
+    uint8_t *data = st_table_element_data(e);
+
+    if (ikey != NULL) {
+        e->key = (st_str_t)st_str_wrap_common(ikey->bytes, key.type, key.len);
+    } else {
+        st_memcpy(data, key.bytes, key.len);
+        e->key = (st_str_t)st_str_wrap_common(data, key.type, key.len);
+        if (key.len < key_size) {
+            e->key.bytes[key.len] = 0;
+        }
+    }
+
+    e->key_hash = hash;
+    e->key_prefix = st_table_key_prefix(&e->key);
+
+    if (blob != NULL) {
+        e->value = (st_str_t)st_str_wrap_common(blob->bytes, value.type, value.len);
+    } else {
+        uint8_t *value_start = data + key_size;
+        st_memcpy(value_start, value.bytes, value.len);
+        e->value = (st_str_t)st_str_wrap_common(value_start, value.type, value.len);
+        if (value.len < value.capacity) {
+            e->value.bytes[value.len] = 0;
+        }
+    }
+
+    *elem = e;
+
+    return ret;
+}
+
+static int st_table_new_element_ex(st_table_t *table, st_str_t key, st_str_t value,
+                                   int64_t expire_at, st_table_element_t **elem) {
+
+    st_table_pool_t *pool = table->pool;
+    st_table_blob_t *blob = NULL;
+
+    int64_t min_len = st_atomic_load(&pool->blob_min_len, __ATOMIC_RELAXED);
+
+    if (min_len > 0 && value.len >= min_len && !st_types_is_table(value.type)) {
+        st_str_t v = st_str_wrap_common(NULL, value.type, value.len);
+
+        int ret = st_slab_obj_alloc(&pool->slab_pool, sizeof(*blob) + v.capacity,
+                                    (void **)&blob);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        blob->retired.next = NULL;
+        blob->refcnt = 1;
+
+        st_memcpy(blob->bytes, value.bytes, value.len);
+        if (value.len < v.capacity) {
+            blob->bytes[value.len] = 0;
+        }
+    }
+
+    int ret = st_table_new_element_with_blob(table, key, value, blob, expire_at, elem);
+    if (ret != ST_OK && blob != NULL) {
+        (void)st_table_blob_release(pool, blob);
+    }
+
+    return ret;
+}
+
+static int st_table_new_element(st_table_t *table, st_str_t key,
+                                st_str_t value, st_table_element_t **elem) {
+    return st_table_new_element_ex(table, key, value, 0, elem);
+}
+
+// element, its interned key and blob are freed after lock free readers left.
+static int st_table_retire_element(st_table_pool_t *pool, st_table_element_t *elem) {
+
+    st_table_intern_key_t *ikey = st_table_element_intern_key(elem);
+    st_table_blob_t *blob = st_table_element_blob(elem);
+
+    int ret = st_table_retire(pool, &elem->retired);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (blob != NULL) {
+        ret = st_table_blob_release(pool, blob);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    if (ikey != NULL) {
+        return st_table_intern_release(pool, ikey);
+    }
+
+    return ST_OK;
+}
+
+// retire elements linked by retired.next.
+static int st_table_retire_element_list(st_table_pool_t *pool, st_table_retired_t *list) {
+
+    int ret = ST_OK;
+
+    while (list != NULL) {
+        st_table_retired_t *next = list->next;
+
+        int err = st_table_retire_element(pool, (st_table_element_t *)list);
+        if (err != ST_OK) {
+            ret = err;
+        }
+
+        list = next;
+    }
+
+    return ret;
+}
+
+// set pin of table and its shards to `to` if it is `from`.
+static void st_table_set_pin(st_table_t *table, int from, int to) {
+
+    int expected = from;
+    st_atomic_cas(&table->pin, &expected, to);
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        expected = from;
+        st_atomic_cas(&table->shards[i]->pin, &expected, to);
+    }
+}
+
+// lock pin_lock before use the function.
+// unpin the table and return elements deferred by the pin.
+static st_table_retired_t *st_table_pin_free(st_table_pool_t *pool, int pin) {
+
+    st_table_pin_t *p = &pool->pins[pin - 1];
+    st_table_retired_t *deferred = p->deferred;
+
+    if (p->table != NULL) {
+        st_table_set_pin(p->table, pin, 0);
+    }
+
+    p->table = NULL;
+    p->deferred = NULL;
+
+    return deferred;
+}
+
+// pin table and its shards for this process.
+// return ST_AGAIN if all pins in pool are in use, or the process has no reader
+// slot to count its holders in.
+static int st_table_pin(st_table_t *table, int *pin) {
+
+    st_table_pool_t *pool = table->pool;
+
+    int idx = st_table_reader_slot(&pool->reclaim);
+    if (idx < 0) {
+        return ST_AGAIN;
+    }
+
+    st_robustlock_lock(&pool->pin_lock);
+
+    int p = table->pin;
+
+    if (p == 0) {
+        for (int i = 0; i < ST_TABLE_PIN_CNT && p == 0; i++) {
+            if (pool->pins[i].holder_cnt == 0) {
+                p = i + 1;
+            }
+        }
+
+        if (p == 0) {
+            st_robustlock_unlock(&pool->pin_lock);
+            return ST_AGAIN;
+        }
+
+        // writers check pin of the table they modify, which is a shard if
+        // table is sharded.
+        pool->pins[p - 1].table = table;
+        st_table_set_pin(table, 0, p);
+    }
+
+    pool->pins[p - 1].holders[idx]++;
+    pool->pins[p - 1].holder_cnt++;
+
+    st_robustlock_unlock(&pool->pin_lock);
+
+    *pin = p;
+
+    return ST_OK;
+}
+
+static int st_table_unpin(st_table_pool_t *pool, int pin) {
+
+    st_table_pin_t *p = &pool->pins[pin - 1];
+    st_table_retired_t *deferred = NULL;
+    int idx = st_table_reader_slot(&pool->reclaim);
+
+    st_robustlock_lock(&pool->pin_lock);
+
+    // process pinning owns a slot until it dies.
+    if (idx >= 0 && p->holders[idx] > 0) {
+        p->holders[idx]--;
+        p->holder_cnt--;
+
+        if (p->holder_cnt == 0) {
+            deferred = st_table_pin_free(pool, pin);
+        }
+    }
+
+    st_robustlock_unlock(&pool->pin_lock);
+
+    return st_table_retire_element_list(pool, deferred);
+}
+
+// the pin may be held after table is freed, it must not unpin freed table.
+static void st_table_pin_forget(st_table_t *table) {
+
+    st_table_pool_t *pool = table->pool;
+
+    st_robustlock_lock(&pool->pin_lock);
+
+    if (table->pin != 0 && pool->pins[table->pin - 1].table == table) {
+        pool->pins[table->pin - 1].table = NULL;
+        st_table_set_pin(table, table->pin, 0);
+    }
+
+    st_robustlock_unlock(&pool->pin_lock);
+}
+
+// retire element removed from a table with the pin, it is kept by the pin
+// until the pin is released if the pin is held.
+static int st_table_retire_pinned(st_table_pool_t *pool, int pin, st_table_element_t *elem) {
+
+    if (pin != 0) {
+        st_table_pin_t *p = &pool->pins[pin - 1];
+
+        st_robustlock_lock(&pool->pin_lock);
+
+        if (p->holder_cnt > 0) {
+            elem->retired.next = p->deferred;
+            p->deferred = &elem->retired;
+
+            st_robustlock_unlock(&pool->pin_lock);
+            return ST_OK;
+        }
+
+        st_robustlock_unlock(&pool->pin_lock);
+    }
+
+    return st_table_retire_element(pool, elem);
+}
+
+static int st_table_free_element(st_table_t *table, st_table_element_t *elem) {
+
+    return st_table_retire_pinned(table->pool, st_atomic_load(&table->pin), elem);
+}
+
+int st_table_reader_clean(st_table_pool_t *pool, pid_t pid) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(pid > 0, ST_ARG_INVALID);
+
+    st_table_reclaim_t *reclaim = &pool->reclaim;
+    st_table_retired_t *deferred = NULL;
+
+    for (int64_t i = 0; i < ST_TABLE_READER_SLOT_CNT; i++) {
+        st_table_reader_slot_t *slot = &reclaim->slots[i];
+
+        if (st_atomic_load(&slot->pid) != pid) {
+            continue;
+        }
+
+        // release pins before the slot can be owned by another process.
+        st_robustlock_lock(&pool->pin_lock);
+
+        for (int j = 0; j < ST_TABLE_PIN_CNT; j++) {
+            st_table_pin_t *p = &pool->pins[j];
+
+            if (p->holders[i] == 0) {
+                continue;
+            }
+
+            p->holder_cnt -= p->holders[i];
+            p->holders[i] = 0;
+
+            if (p->holder_cnt > 0) {
+                continue;
+            }
+
+            st_table_retired_t *list = st_table_pin_free(pool, j + 1);
+
+            while (list != NULL) {
+                st_table_retired_t *next = list->next;
+
+                list->next = deferred;
+                deferred = list;
+
+                list = next;
+            }
+        }
+
+        st_robustlock_unlock(&pool->pin_lock);
+
+        st_atomic_store(&slot->readers[0], 0);
+        st_atomic_store(&slot->readers[1], 0);
+        st_atomic_store(&slot->pid, 0);
+    }
+
+    return st_table_retire_element_list(pool, deferred);
+}
+
+// slab bytes used by element, value overwritten in place always fits in the
+// same size class. a shared blob is counted in every element using it.
+static int64_t st_table_element_size(st_table_element_t *elem) {
+
+    if (!(elem->flags & ST_TABLE_ELEMENT_BLOB)) {
+        return st_slab_obj_size(elem->value.bytes - (uint8_t *)elem + elem->value.capacity);
+    }
+
+    ssize_t key_size = 0;
+    if (st_table_element_intern_key(elem) == NULL) {
+        key_size = st_align(elem->key.capacity, 8);
+    }
+
+    return st_slab_obj_size(sizeof(*elem) + st_table_element_tails_size(elem->flags) + key_size)
+           + st_slab_obj_size(sizeof(st_table_blob_t) + elem->value.capacity);
+}
+
+static int st_table_element_expired(st_table_element_t *elem) {
+
+    st_table_ttl_tail_t *ttl = st_table_element_ttl(elem);
+    if (ttl == NULL) {
+        return 0;
+    }
+
+    int64_t now = 0;
+    st_time_in_usec(&now);
+
+    return now >= ttl->expire_at;
+}
+
+static st_list_t *st_table_ttl_slot(st_table_ttl_t *ttl, int64_t expire_at) {
+    return &ttl->slots[(expire_at / ST_TABLE_TTL_SLOT_USEC) % ST_TABLE_TTL_SLOT_CNT];
+}
+
+// mark elem as recently used in cache mode, it is called by readers.
+static void st_table_touch_element(st_table_t *table, st_table_element_t *elem) {
+
+    st_table_cache_tail_t *cache = st_table_element_cache(elem);
+
+    if (cache != NULL && st_atomic_load(&table->cache, __ATOMIC_RELAXED)
+            && st_atomic_load(&cache->referenced, __ATOMIC_RELAXED) == 0) {
+        st_atomic_store(&cache->referenced, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// lock table and begin writing before use the function.
+// replace existed element with new_elem of the same key, slot is where existed
+// is in array part, or NULL if it is not in array part.
+static int st_table_replace_element(st_table_t *table, st_table_element_t *existed,
+                                    st_table_element_t *new_elem,
+                                    st_table_element_t **slot) {
+
+    if (slot != NULL) {
+        *slot = new_elem;
+    } else {
+        int ret = st_table_sorted_replace(table, existed, new_elem);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    table->table_value_cnt += st_types_is_table(new_elem->value.type);
+    table->table_value_cnt -= st_types_is_table(existed->value.type);
+
+    table->used_bytes += st_table_element_size(new_elem);
+    table->used_bytes -= st_table_element_size(existed);
+
+    st_table_cache_tail_t *cache = st_table_element_cache(existed);
+    if (cache != NULL) {
+        st_list_remove(&cache->lnode);
+    }
+
+    cache = st_table_element_cache(new_elem);
+    if (cache != NULL) {
+        st_list_insert_last(&table->clock, &cache->lnode);
+    }
+
+    st_table_ttl_tail_t *ttl = st_table_element_ttl(existed);
+    if (ttl != NULL) {
+        st_list_remove(&ttl->lnode);
+    }
+
+    ttl = st_table_element_ttl(new_elem);
+    if (ttl != NULL) {
+        st_list_insert_last(st_table_ttl_slot(table->ttl, ttl->expire_at), &ttl->lnode);
+    }
+
+    if (table->hash_index != NULL) {
+        int64_t i = st_table_hash_index_find(table->hash_index, &new_elem->key,
+                                             new_elem->key_hash);
+        st_assert(i >= 0);
+
+        table->hash_index->slots[i] = new_elem;
+    }
+
+    if (st_table_prefix_indexed(table, &new_elem->key)) {
+        int ret = st_art_replace(table->prefix_index, new_elem);
+        st_assert(ret == ST_OK);
+    }
+
+    return ST_OK;
+}
+
+// lock table and begin writing before use the function.
+// modified is set to 1 if anything in table is changed.
+static int st_table_insert_element(st_table_t *table, st_table_element_t *new_elem, int force,
+                                   st_table_element_t **existed_elem, int *modified) {
+
+    st_table_element_t *existed = NULL;
+    st_table_element_t **slot = NULL;
+    int prefix_indexed = st_table_prefix_indexed(table, &new_elem->key);
+
+    int ret = st_table_hash_index_reserve(table);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    // prefix index is updated before anything else, it finds existed key as
+    // rbtree does, and nothing is changed if it fails to allocate.
+    if (prefix_indexed) {
+        ret = st_art_insert(table->prefix_index, new_elem);
+        if (ret != ST_OK && ret != ST_EXISTED) {
+            return ret;
+        }
+    }
+
+    if (st_table_array_grow_if_needed(table, &new_elem->key)) {
+        *modified = 1;
+    }
+
+    int64_t i = st_table_array_index(table->array, &new_elem->key);
+    if (i >= 0) {
+        slot = &table->array->slots[i];
+        existed = *slot;
+
+        if (existed == NULL) {
+            *slot = new_elem;
+            table->array_cnt++;
+            ret = ST_OK;
+        } else {
+            ret = ST_EXISTED;
+        }
+
+    } else {
+        ret = st_table_sorted_insert(table, new_elem, &existed);
+        if (ret != ST_OK && ret != ST_EXISTED) {
+            if (prefix_indexed) {
+                (void)st_art_remove(table->prefix_index, &new_elem->key, NULL);
+            }
+
+            return ret;
+        }
+    }
+
+    if (ret == ST_OK) {
+        if (table->hash_index != NULL) {
+            st_table_hash_index_insert(table->hash_index, new_elem);
+        }
+
+        table->element_cnt++;
+        table->table_value_cnt += st_types_is_table(new_elem->value.type);
+        table->used_bytes += st_table_element_size(new_elem);
+
+        st_table_cache_tail_t *cache = st_table_element_cache(new_elem);
+        if (cache != NULL) {
+            st_list_insert_last(&table->clock, &cache->lnode);
+        }
+
+        st_table_ttl_tail_t *ttl = st_table_element_ttl(new_elem);
+        if (ttl != NULL) {
+            st_list_insert_last(st_table_ttl_slot(table->ttl, ttl->expire_at), &ttl->lnode);
+        }
+
+        *modified = 1;
+        return ret;
+    }
+
+    // element is existed, expired one is replaced as if it is not existed.
+    int expired = st_table_element_expired(existed);
+
+    if (force || expired) {
+        ret = st_table_replace_element(table, existed, new_elem, slot);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        *modified = 1;
+
+        *existed_elem = existed;
+
+        return expired && !force ? ST_OK : ST_EXISTED;
+    }
+
+    return ST_EXISTED;
+}
+
+static int st_table_add_element(st_table_t *table, st_table_element_t *new_elem, int force,
+                                st_table_element_t **existed_elem) {
+
+    int modified = 0;
+
+    int ret;
+    st_robustrwlock_wrlock(&table->lock);
+
+    int64_t version = st_table_write_begin(table);
+
+    ret = st_table_insert_element(table, new_elem, force, existed_elem, &modified);
+
+    if (modified) {
+        st_table_write_end(table);
+    } else {
+        st_table_write_cancel(table, version);
+    }
+
+    st_robustrwlock_wrunlock(&table->lock);
+    return ret;
+}
+
+static int st_table_find_element(st_table_t *table, st_str_t key, st_table_element_t **elem) {
+
+    int64_t i = st_table_array_index(table->array, &key);
+    if (i >= 0) {
+        if (table->array->slots[i] == NULL) {
+            return ST_NOT_FOUND;
+        }
+
+        *elem = table->array->slots[i];
+
+        return ST_OK;
+    }
+
+    if (table->hash_index != NULL) {
+        int64_t i = st_table_hash_index_find(table->hash_index, &key, st_table_hash_key(&key));
+        if (i < 0) {
+            return ST_NOT_FOUND;
+        }
+
+        *elem = table->hash_index->slots[i];
+
+        return ST_OK;
+    }
+
+    if (st_table_prefix_indexed(table, &key)) {
+        return st_art_get(table->prefix_index, &key, (void **)elem);
+    }
+
+    *elem = st_table_tree_search(table, &key, ST_SIDE_EQ);
+    if (*elem == NULL) {
+        return ST_NOT_FOUND;
+    }
+
+    return ST_OK;
+}
+
+// expired element is not got.
+static int st_table_get_element(st_table_t *table, st_str_t key, st_table_element_t **elem) {
+
+    int ret = st_table_find_element(table, key, elem);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (st_table_element_expired(*elem)) {
+        return ST_NOT_FOUND;
+    }
+
+    return ST_OK;
+}
+
+// search element without lock, table may be modified at the same time, so
+// the search is bounded and it returns ST_AGAIN if it finds table is broken.
+static int st_table_search_optimistic(st_table_t *table, st_str_t *key,
+                                      st_table_element_t **elem) {
+
+    st_table_array_t *array = st_atomic_load(&table->array, __ATOMIC_ACQUIRE);
+
+    int64_t k = st_table_array_index(array, key);
+    if (k >= 0) {
+        *elem = st_atomic_load(&array->slots[k], __ATOMIC_RELAXED);
+
+        return *elem == NULL ? ST_NOT_FOUND : ST_OK;
+    }
+
+    st_table_hash_index_t *index = st_atomic_load(&table->hash_index, __ATOMIC_ACQUIRE);
+
+    if (index != NULL) {
+        uint64_t hash = st_table_hash_key(key);
+        int64_t mask = index->capacity - 1;
+        int64_t i = st_table_hash_index_home(index, hash);
+
+        for (int64_t n = 0; n < index->capacity; n++) {
+            st_table_element_t *e = st_atomic_load(&index->slots[i], __ATOMIC_RELAXED);
+            if (e == NULL) {
+                return ST_NOT_FOUND;
+            }
+
+            if (e->key_hash == (uint32_t)hash && st_str_cmp(&e->key, key) == 0) {
+                *elem = e;
+                return ST_OK;
+            }
+
+            i = (i + 1) & mask;
+        }
+
+        return ST_AGAIN;
+    }
+
+    uint64_t prefix = st_table_key_prefix(key);
+
+    int64_t small_cnt = st_atomic_load(&table->small_cnt, __ATOMIC_ACQUIRE);
+
+    if (small_cnt >= 0) {
+        int64_t lo = 0;
+        int64_t hi = small_cnt;
+
+        if (hi > ST_TABLE_SMALL_CAPACITY) {
+            return ST_AGAIN;
+        }
+
+        while (lo < hi) {
+            int64_t mid = (lo + hi) / 2;
+            st_table_small_entry_t *entry = &table->small[mid];
+
+            st_table_small_entry_t copy = {
+                .key_type = st_atomic_load(&entry->key_type, __ATOMIC_RELAXED),
+                .key_prefix = st_atomic_load(&entry->key_prefix, __ATOMIC_RELAXED),
+                .element = st_atomic_load(&entry->element, __ATOMIC_RELAXED),
+            };
+
+            // entries are being moved.
+            if (copy.element == NULL) {
+                return ST_AGAIN;
+            }
+
+            int ret = st_table_small_cmp_key(key, prefix, &copy);
+            if (ret == 0) {
+                *elem = copy.element;
+                return ST_OK;
+            }
+
+            if (ret < 0) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+
+        return ST_NOT_FOUND;
+    }
+
+    st_rbtree_node_t *sentinel = &table->elements.sentinel;
+    st_rbtree_node_t *n = st_atomic_load(&table->elements.root, __ATOMIC_RELAXED);
+
+    for (int depth = 0; depth < ST_TABLE_OPTIMISTIC_READ_MAX_DEPTH; depth++) {
+
+        // a removed node has NULL children.
+        if (n == NULL) {
+            return ST_AGAIN;
+        }
+
+        if (n == sentinel) {
+            return ST_NOT_FOUND;
+        }
+
+        st_table_element_t *e = st_owner(n, st_table_element_t, rbnode);
+
+        int ret = st_table_cmp_key(key, prefix, e);
+        if (ret == 0) {
+            *elem = e;
+            return ST_OK;
+        }
+
+        if (ret < 0) {
+            n = st_atomic_load(&n->left, __ATOMIC_RELAXED);
+        } else {
+            n = st_atomic_load(&n->right, __ATOMIC_RELAXED);
+        }
+    }
+
+    return ST_AGAIN;
+}
+
+// lock table and begin writing before use the function.
+// overwrite value of elem in place if new value fits in the slab object of elem,
+// return 1 if it is overwritten.
+static int st_table_overwrite_value(st_table_t *table, st_table_element_t *elem,
+                                    st_str_t value) {
+
+    // table value need to be marked or swept by gc, replace the whole element.
+    if (st_types_is_table(elem->value.type) || st_types_is_table(value.type)) {
+        return 0;
+    }
+
+    // snapshots or borrow guards may be referencing elem.
+    if (st_atomic_load(&table->pin) != 0) {
+        return 0;
+    }
+
+    // ttl of elem is removed by setting without ttl.
+    if (elem->flags & ST_TABLE_ELEMENT_TTL) {
+        return 0;
+    }
+
+    // value bytes are in element or in blob.
+    uint8_t *obj = (uint8_t *)elem;
+    int64_t used = elem->value.len;
+
+    st_table_blob_t *blob = st_table_element_blob(elem);
+    if (blob != NULL) {
+        // blob shared with other elements must not be changed.
+        if (st_atomic_load(&blob->refcnt) > 1) {
+            return 0;
+        }
+
+        // blob is allocated with exactly the capacity of value.
+        obj = (uint8_t *)blob;
+        used = elem->value.capacity;
+    }
+
+    st_str_t new_value = st_str_wrap_common(elem->value.bytes, value.type, value.len);
+
+    // the slab object is at least as large as the size class of its used bytes.
+    ssize_t offset = elem->value.bytes - obj;
+    ssize_t obj_size = st_slab_obj_size(offset + used);
+    ssize_t need = offset + st_max(value.capacity, new_value.capacity);
+
+    // do not keep a large object for a much smaller value.
+    if (need > obj_size || st_slab_obj_size(need) != obj_size) {
+        return 0;
+    }
+
+    st_memcpy(new_value.bytes, value.bytes, value.len);
+    if (value.len < new_value.capacity) {
+        new_value.bytes[value.len] = 0;
+    }
+
+    elem->value = new_value;
+
+    return 1;
+}
+
+// lock table and begin writing before use the function.
+static void st_table_unlink_element(st_table_t *table, st_table_element_t *elem) {
+
+    int64_t i = st_table_array_index(table->array, &elem->key);
+    if (i >= 0) {
+        table->array->slots[i] = NULL;
+        table->array_cnt--;
+    } else {
+        st_table_sorted_delete(table, elem);
+    }
+
+    table->element_cnt--;
+    table->table_value_cnt -= st_types_is_table(elem->value.type);
+    table->used_bytes -= st_table_element_size(elem);
+
+    st_table_cache_tail_t *cache = st_table_element_cache(elem);
+    if (cache != NULL) {
+        st_list_remove(&cache->lnode);
+    }
+
+    st_table_ttl_tail_t *ttl = st_table_element_ttl(elem);
+    if (ttl != NULL) {
+        st_list_remove(&ttl->lnode);
+    }
+
+    if (table->hash_index != NULL) {
+        int64_t i = st_table_hash_index_find(table->hash_index, &elem->key, elem->key_hash);
+        st_assert(i >= 0);
+
+        st_table_hash_index_remove_slot(table->hash_index, i);
+        st_table_hash_index_shrink_if_needed(table);
+    }
+
+    if (st_table_prefix_indexed(table, &elem->key)) {
+        int ret = st_art_remove(table->prefix_index, &elem->key, NULL);
+        st_assert(ret == ST_OK);
+    }
+
+    st_table_array_shrink_if_needed(table);
+}
+
+static int st_table_remove_element(st_table_t *table, st_str_t key, st_table_element_t **removed) {
+
+    int ret;
+    st_robustrwlock_wrlock(&table->lock);
+
+    ret = st_table_get_element(table, key, removed);
+    if (ret != ST_OK) {
+        goto quit;
+    }
+
+    st_table_write_begin(table);
+    st_table_unlink_element(table, *removed);
+    st_table_write_end(table);
+
+quit:
+    st_robustrwlock_wrunlock(&table->lock);
+    return ret;
+}
+
+static int st_table_init(st_table_t *table, st_table_pool_t *pool) {
+
+    int ret = st_rbtree_init(&table->elements, st_table_cmp_element);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_robustrwlock_init(&table->lock);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_gc_head_init(&pool->gc, &table->gc_head);
+
+    table->pool = pool;
+    table->small_cnt = 0;
+    table->hash_index = NULL;
+    table->prefix_index = NULL;
+    table->array = NULL;
+    table->array_cnt = 0;
+    table->version = 0;
+    table->element_cnt = 0;
+    table->table_value_cnt = 0;
+    table->used_bytes = 0;
+    table->cache = 0;
+    table->max_element_cnt = 0;
+    table->max_bytes = 0;
+    st_list_init(&table->clock);
+    table->ttl = NULL;
+    table->shards = NULL;
+    table->shard_cnt = 0;
+    table->pin = 0;
+    table->inited = 1;
+
+    return ret;
+}
+
+static int st_table_destroy(st_table_t *table) {
+
+    if (table->element_cnt != 0) {
+        return ST_NOT_EMPTY;
+    }
+
+    int ret;
+
+    // gc may be visiting table by ttl wheel, remove it with ttl locked first.
+    if (table->ttl != NULL) {
+        st_robustlock_lock(&table->pool->ttl_lock);
+        st_list_remove(&table->ttl->lnode);
+        st_robustlock_unlock(&table->pool->ttl_lock);
+
+        ret = st_slab_obj_free(&table->pool->slab_pool, table->ttl);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        table->ttl = NULL;
+    }
+
+    ret = st_robustrwlock_destroy(&table->lock);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (table->hash_index != NULL) {
+        ret = st_table_hash_index_free(table, table->hash_index);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        table->hash_index = NULL;
+    }
+
+    if (table->prefix_index != NULL) {
+        ret = st_slab_obj_free(&table->pool->slab_pool, table->prefix_index);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        table->prefix_index = NULL;
+    }
+
+    // array part may be left empty after elements removed one by one.
+    if (table->array != NULL) {
+        ret = st_table_retire(table->pool, &table->array->retired);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        table->array = NULL;
+    }
+
+    table->pool = NULL;
+    table->version = 0;
+    table->element_cnt = 0;
+    table->inited = 0;
+
+    return ret;
+}
+
+static int st_table_run_gc_if_needed(st_table_t *table) {
+
+    st_gc_t *gc = &table->pool->gc;
+
+    if (table->pool->run_gc_periodical == 1) {
+        return ST_OK;
+    }
+
+    if (fib_hash64((uintptr_t)table) > (1UL << 63)) {
+        return ST_OK;
+    }
+
+    int ret = st_gc_run(gc);
+    if (ret == ST_NO_GC_DATA) {
+        return ST_OK;
+    }
+
+    return ret;
+}
+
+static int st_table_over_limit(st_table_t *table) {
+
+    int64_t max_element_cnt = st_atomic_load(&table->max_element_cnt, __ATOMIC_RELAXED);
+    int64_t max_bytes = st_atomic_load(&table->max_bytes, __ATOMIC_RELAXED);
+
+    if (max_element_cnt > 0
+            && st_atomic_load(&table->element_cnt, __ATOMIC_RELAXED) > max_element_cnt) {
+        return 1;
+    }
+
+    return max_bytes > 0 && st_atomic_load(&table->used_bytes, __ATOMIC_RELAXED) > max_bytes;
+}
+
+// lock gc and table, and begin writing before use the function.
+// evicted elements are linked by retired.next in *evicted, caller should free
+// them after unlocking.
+static void st_table_evict_elements(st_table_t *table, st_table_retired_t **evicted) {
+
+    st_gc_t *gc = &table->pool->gc;
+
+    // every element is passed at most once before all referenced flags are
+    // cleared, so it stops in 2 * element_cnt steps.
+    while (st_table_over_limit(table) && !st_list_empty(&table->clock)) {
+
+        st_table_cache_tail_t *cache = st_list_first_entry(&table->clock,
+                                                           st_table_cache_tail_t, lnode);
+
+        if (st_atomic_load(&cache->referenced, __ATOMIC_RELAXED)) {
+            st_atomic_store(&cache->referenced, 0, __ATOMIC_RELAXED);
+            st_list_move_tail(&cache->lnode, &table->clock);
+            continue;
+        }
+
+        st_table_element_t *e = (st_table_element_t *)((uint8_t *)cache - cache->offset);
+
+        st_table_unlink_element(table, e);
+
+        if (st_types_is_table(e->value.type)) {
+            st_table_t *t = st_table_get_table_addr_from_value(e->value);
+
+            int ret = st_gc_push_to_sweep(gc, &t->gc_head);
+            st_assert(ret == ST_OK);
+        }
+
+        e->retired.next = *evicted;
+        *evicted = &e->retired;
+    }
+}
+
+static int st_table_evict_if_needed(st_table_t *table) {
+
+    st_gc_t *gc = &table->pool->gc;
+    st_table_retired_t *evicted = NULL;
+
+    // it is only a hint without table locked, check again with table locked.
+    if (!st_atomic_load(&table->cache, __ATOMIC_RELAXED) || !st_table_over_limit(table)) {
+        return ST_OK;
+    }
+
+    st_robustlock_lock(&gc->lock);
+    st_robustrwlock_wrlock(&table->lock);
+
+    int64_t version = st_table_write_begin(table);
+
+    st_table_evict_elements(table, &evicted);
+
+    if (evicted != NULL) {
+        st_table_write_end(table);
+    } else {
+        st_table_write_cancel(table, version);
+    }
+
+    st_robustrwlock_wrunlock(&table->lock);
+    st_robustlock_unlock(&gc->lock);
+
+    int ret = ST_OK;
+
+    while (evicted != NULL) {
+        st_table_retired_t *next = evicted->next;
+
+        int free_ret = st_table_free_element(table, (st_table_element_t *)evicted);
+        if (free_ret != ST_OK) {
+            ret = free_ret;
+        }
+
+        evicted = next;
+    }
+
+    return ret;
+}
+
+// evict elements in cache mode and run gc after elements are added.
+static int st_table_after_add(st_table_t *table) {
+
+    int ret = st_table_evict_if_needed(table);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    return st_table_run_gc_if_needed(table);
+}
+
+int st_table_new(st_table_pool_t *pool, st_table_t **table) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(table != NULL, ST_ARG_INVALID);
+
+    st_table_t *t = NULL;
+    st_slab_pool_t *slab_pool = &pool->slab_pool;
+
+    int ret = st_slab_obj_alloc(slab_pool, sizeof(st_table_t), (void **)&t);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_table_init(t, pool);
+    if (ret != ST_OK) {
+        st_slab_obj_free(slab_pool, t);
+        return ret;
+    }
+
+    pool->table_cnt++;
+
+    *table = t;
+
+    return ret;
+}
+
+// free shards of a sharded table, all of them must be empty.
+static int st_table_free_shards(st_table_t *table) {
+
+    int ret;
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        if (table->shards[i]->element_cnt != 0) {
+            return ST_NOT_EMPTY;
+        }
+    }
+
+    while (table->shard_cnt > 0) {
+        ret = st_table_free(table->shards[table->shard_cnt - 1]);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        table->shard_cnt--;
+    }
+
+    ret = st_slab_obj_free(&table->pool->slab_pool, table->shards);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    table->shards = NULL;
+
+    return ST_OK;
+}
+
+static int st_table_addr_cmp(const void *a, const void *b) {
+
+    uintptr_t x = (uintptr_t)*(st_table_t **)a;
+    uintptr_t y = (uintptr_t)*(st_table_t **)b;
+
+    return x < y ? -1 : x > y;
+}
+
+int st_table_new_sharded(st_table_pool_t *pool, int64_t shard_cnt, st_table_t **table) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(shard_cnt > 1 && shard_cnt <= ST_TABLE_MAX_SHARD_CNT, ST_ARG_INVALID);
+
+    st_table_t *t = NULL;
+
+    int ret = st_table_new(pool, &t);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_slab_obj_alloc(&pool->slab_pool, sizeof(st_table_t *) * shard_cnt,
+                            (void **)&t->shards);
+    if (ret != ST_OK) {
+        st_table_free(t);
+        return ret;
+    }
+
+    for (int64_t i = 0; i < shard_cnt; i++) {
+        ret = st_table_new(pool, &t->shards[i]);
+        if (ret != ST_OK) {
+            st_table_free(t);
+            return ret;
+        }
+
+        t->shard_cnt++;
+    }
+
+    // shards are locked in the order of index, keep it the order of address
+    // in which transaction commit locks tables, so that they never deadlock.
+    qsort(t->shards, shard_cnt, sizeof(st_table_t *), st_table_addr_cmp);
+
+    *table = t;
+
+    return ST_OK;
+}
+
+static int64_t st_table_shard_index(st_table_t *table, st_str_t key) {
+
+    // hash index of shard uses low bits of the same hash, choose shard by
+    // high bits, or keys in a shard crowd into a part of its hash index.
+    uint64_t hash = st_table_hash_key(&key);
+
+    return (hash >> 32) % table->shard_cnt;
+}
+
+st_table_t *st_table_shard_of(st_table_t *table, st_str_t key) {
+
+    if (table->shards == NULL) {
+        return table;
+    }
+
+    return table->shards[st_table_shard_index(table, key)];
+}
+
+void st_table_rdlock_all(st_table_t *table, int *slots) {
+
+    if (table->shards == NULL) {
+        slots[0] = st_robustrwlock_rdlock(&table->lock);
+        return;
+    }
+
+    // shards are always locked in the order of address.
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        st_assert(i == 0 || table->shards[i - 1] < table->shards[i]);
+
+        slots[i] = st_robustrwlock_rdlock(&table->shards[i]->lock);
+    }
+}
+
+void st_table_rdunlock_all(st_table_t *table, int *slots) {
+
+    if (table->shards == NULL) {
+        st_robustrwlock_rdunlock(&table->lock, slots[0]);
+        return;
+    }
+
+    for (int64_t i = table->shard_cnt - 1; i >= 0; i--) {
+        st_robustrwlock_rdunlock(&table->shards[i]->lock, slots[i]);
+    }
+}
+
+int st_table_free(st_table_t *table) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+
+    st_table_pool_t *pool = table->pool;
+    int ret;
+
+    // before shards are freed, releasing the pin unpins shards too.
+    st_table_pin_forget(table);
+
+    if (table->shards != NULL) {
+        ret = st_table_free_shards(table);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    ret = st_table_destroy(table);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    pool->table_cnt--;
+
+    return st_slab_obj_free(&pool->slab_pool, table);
+}
+
+static int st_table_remove_one_element(st_table_t *table, st_table_element_t *e,
+                                       int removed_flag) {
+
+    if (removed_flag == ST_TABLE_PUSH_TO_GC) {
+        if (st_types_is_table(e->value.type)) {
+            st_table_t *t = st_table_get_table_addr_from_value(e->value);
+
+            int ret = st_gc_push_to_sweep(&t->pool->gc, &t->gc_head);
+            st_assert(ret == ST_OK);
+        }
+    }
+
+    return st_table_free_element(table, e);
+}
+
+static int st_table_remove_all_elements(st_table_t *table, st_rbtree_node_t *node,
+                                        int removed_flag) {
+
+    st_rbtree_node_t *sentinel = &table->elements.sentinel;
+
+    if (node == sentinel) {
+        return ST_OK;
+    }
+
+    int ret = st_table_remove_all_elements(table, node->left, removed_flag);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_table_remove_all_elements(table, node->right, removed_flag);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_table_element_t *e = st_owner(node, st_table_element_t, rbnode);
+
+    return st_table_remove_one_element(table, e, removed_flag);
+}
+
+static int st_table_remove_array_elements(st_table_t *table, st_table_array_t *array,
+                                          int removed_flag) {
+
+    if (array == NULL) {
+        return ST_OK;
+    }
+
+    for (int64_t i = 0; i < array->capacity; i++) {
+        if (array->slots[i] == NULL) {
+            continue;
+        }
+
+        int ret = st_table_remove_one_element(table, array->slots[i], removed_flag);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return st_table_retire(table->pool, &array->retired);
+}
+
+static int st_table_remove_small_elements(st_table_t *table, st_table_element_t **elements,
+                                          int64_t cnt, int removed_flag) {
+
+    for (int64_t i = 0; i < cnt; i++) {
+        int ret = st_table_remove_one_element(table, elements[i], removed_flag);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return ST_OK;
+}
+
+static void st_table_hash_index_clear(st_table_t *table) {
+
+    st_table_hash_index_t *index = table->hash_index;
+
+    if (index == NULL) {
+        return;
+    }
+
+    memset(index->slots, 0, index->capacity * sizeof(st_table_element_t *));
+    index->used = 0;
+}
+
+// lock table and begin writing before use the function.
+static int st_table_prefix_index_clear(st_table_t *table) {
+
+    if (table->prefix_index == NULL) {
+        return ST_OK;
+    }
+
+    return st_art_destroy(table->prefix_index);
+}
+
+// lock table and begin writing before use the function.
+// elements are not freed, caller should free them.
+static void st_table_reset_elements(st_table_t *table) {
+
+    table->elements.root = &table->elements.sentinel;
+    st_atomic_store(&table->small_cnt, 0);
+    st_atomic_store(&table->array, NULL);
+    table->array_cnt = 0;
+    table->element_cnt = 0;
+    table->table_value_cnt = 0;
+    table->used_bytes = 0;
+
+    st_list_init(&table->clock);
+
+    if (table->ttl != NULL) {
+        st_list_init(&table->ttl->checked);
+
+        for (int i = 0; i < ST_TABLE_TTL_SLOT_CNT; i++) {
+            st_list_init(&table->ttl->slots[i]);
+        }
+    }
+}
+
+// lock table before use the function.
+static int st_table_can_detach(st_table_t *table, int removed_flag,
+                               st_table_detached_t *detached, st_table_hash_index_t *index) {
+
+    if (detached == NULL || table->element_cnt < ST_TABLE_DETACH_MIN_CNT) {
+        return 0;
+    }
+
+    // gc table is not used any more, its children are already visited by gc.
+    if (removed_flag == ST_TABLE_NOT_PUSH_TO_GC) {
+        return 1;
+    }
+
+    // tables referenced by detached elements can not be pushed to gc after
+    // they may be freed, so only detach elements without table value.
+    if (table->table_value_cnt != 0) {
+        return 0;
+    }
+
+    // hash index must be replaced with an empty one.
+    return table->hash_index == NULL || index != NULL;
+}
+
+// lock table and begin writing before use the function.
+static int st_table_detach_elements(st_table_t *table, st_table_detached_t *detached,
+                                    st_table_hash_index_t *index) {
+
+    // only rbtree, array part and prefix index are detached.
+    if (table->small_cnt > 0) {
+        st_table_small_to_tree(table);
+    }
+
+    detached->root = table->elements.root;
+    detached->sentinel = &table->elements.sentinel;
+    detached->array = table->array;
+    detached->array_left = table->array == NULL ? 0 : table->array->capacity;
+    detached->pin = table->pin;
+    detached->prefix_nodes = NULL;
+
+    if (table->prefix_index != NULL) {
+        detached->prefix_nodes = st_art_detach(table->prefix_index);
+    }
+
+    st_table_reset_elements(table);
+
+    // gc lock is held by caller, detached elements can be linked in pool.
+    st_list_insert_last(&table->pool->detached, &detached->lnode);
+
+    st_table_hash_index_t *old_index = table->hash_index;
+    if (old_index == NULL) {
+        return ST_OK;
+    }
+
+    st_atomic_store(&table->hash_index, index);
+
+    return st_table_hash_index_free(table, old_index);
+}
+
+// lock table before use the function.
+// if table is large, elements are detached into *detached instead of being
+// freed one by one, *index is used to replace hash index. they are set to NULL
+// if they are used.
+static int st_table_clear(st_table_t *table, int removed_flag,
+                          st_table_detached_t **detached, st_table_hash_index_t **index) {
+
+    int ret;
+
+    st_table_write_begin(table);
+
+    if (st_table_can_detach(table, removed_flag, *detached, *index)) {
+        ret = st_table_detach_elements(table, *detached, *index);
+
+        *detached = NULL;
+        if (table->hash_index != NULL) {
+            *index = NULL;
+        }
+
+        st_table_write_end(table);
+
+        return ret;
+    }
+
+    ret = st_table_prefix_index_clear(table);
+    if (ret != ST_OK) {
+        st_table_write_end(table);
+        return ret;
+    }
+
+    // detach rbtree, small part and array part before freeing elements, no
+    // new lock free reader can reach them.
+    st_rbtree_node_t *root = table->elements.root;
+    st_table_array_t *array = table->array;
+
+    st_table_element_t *small[ST_TABLE_SMALL_CAPACITY];
+    int64_t small_cnt = st_max(table->small_cnt, 0);
+
+    for (int64_t i = 0; i < small_cnt; i++) {
+        small[i] = table->small[i].element;
+    }
+
+    st_table_reset_elements(table);
+
+    st_table_hash_index_clear(table);
+
+    ret = st_table_remove_all_elements(table, root, removed_flag);
+    if (ret == ST_OK) {
+        ret = st_table_remove_small_elements(table, small, small_cnt, removed_flag);
+    }
+
+    if (ret == ST_OK) {
+        ret = st_table_remove_array_elements(table, array, removed_flag);
+    }
+
+    st_table_write_end(table);
+
+    return ret;
+}
+
+// allocate what st_table_clear needs to detach elements, it is only a guess
+// without table locked, st_table_clear checks again.
+// it does not matter if it fails, then table is cleared one by one.
+static void st_table_prepare_detach(st_table_t *table, int with_index,
+                                    st_table_detached_t **detached,
+                                    st_table_hash_index_t **index) {
+
+    st_slab_pool_t *slab_pool = &table->pool->slab_pool;
+
+    *detached = NULL;
+    *index = NULL;
+
+    if (st_atomic_load(&table->element_cnt, __ATOMIC_RELAXED) < ST_TABLE_DETACH_MIN_CNT) {
+        return;
+    }
+
+    if (st_slab_obj_alloc(slab_pool, sizeof(st_table_detached_t), (void **)detached) != ST_OK) {
+        *detached = NULL;
+        return;
+    }
+
+    if (with_index && st_atomic_load(&table->hash_index, __ATOMIC_RELAXED) != NULL) {
+        if (st_table_hash_index_new(table, ST_TABLE_HASH_INDEX_MIN_CAPACITY, index) != ST_OK) {
+            *index = NULL;
+        }
+    }
+}
+
+// free what st_table_clear did not use, they are never visible to others.
+static int st_table_free_unused_detach(st_table_t *table, st_table_detached_t *detached,
+                                       st_table_hash_index_t *index) {
+
+    st_slab_pool_t *slab_pool = &table->pool->slab_pool;
+    int ret = ST_OK;
+
+    if (detached != NULL) {
+        ret = st_slab_obj_free(slab_pool, detached);
+    }
+
+    if (index != NULL) {
+        int err = st_slab_obj_free(slab_pool, index);
+        if (ret == ST_OK) {
+            ret = err;
+        }
+    }
+
+    return ret;
+}
+
+// this function is only used for gc, other one please use st_table_remove_all.
+int st_table_remove_all_for_gc(st_table_t *table) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+
+    if (table->shards != NULL) {
+        for (int64_t i = 0; i < table->shard_cnt; i++) {
+            int ret = st_table_remove_all_for_gc(table->shards[i]);
+            if (ret != ST_OK) {
+                return ret;
+            }
+        }
+
+        return ST_OK;
+    }
+
+    st_table_detached_t *detached = NULL;
+    st_table_hash_index_t *index = NULL;
+
+    // garbage table needs no hash index any more.
+    st_table_prepare_detach(table, 0, &detached, &index);
+
+    int ret;
+    st_robustrwlock_wrlock(&table->lock);
+
+    ret = st_table_clear(table, ST_TABLE_NOT_PUSH_TO_GC, &detached, &index);
+
+    st_robustrwlock_wrunlock(&table->lock);
+
+    int err = st_table_free_unused_detach(table, detached, index);
+
+    return ret != ST_OK ? ret : err;
+}
+
+int st_table_remove_all(st_table_t *table) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+
+    if (table->shards != NULL) {
+        for (int64_t i = 0; i < table->shard_cnt; i++) {
+            int ret = st_table_remove_all(table->shards[i]);
+            if (ret != ST_OK) {
+                return ret;
+            }
+        }
+
+        return ST_OK;
+    }
+
+    st_gc_t *gc = &table->pool->gc;
+
+    st_table_detached_t *detached = NULL;
+    st_table_hash_index_t *index = NULL;
+
+    st_table_prepare_detach(table, 1, &detached, &index);
+
+    int ret;
+    st_robustlock_lock(&gc->lock);
+    st_robustrwlock_wrlock(&table->lock);
+
+    ret = st_table_clear(table, ST_TABLE_PUSH_TO_GC, &detached, &index);
+
+    st_robustrwlock_wrunlock(&table->lock);
+    st_robustlock_unlock(&gc->lock);
+
+    int err = st_table_free_unused_detach(table, detached, index);
+    if (ret == ST_OK) {
+        ret = err;
+    }
+
+    if (ret == ST_OK) {
+        return st_table_run_gc_if_needed(table);
+    }
+
+    return ret;
+}
+
+// free detached elements, count of visited array slots and tree nodes is
+// added to visited_cnt.
+static int st_table_free_detached_elements(st_table_pool_t *pool, st_table_detached_t *detached,
+                                           int max_cnt, int *visited_cnt) {
+    int ret;
+
+    while (detached->array != NULL && *visited_cnt < max_cnt) {
+
+        if (detached->array_left == 0) {
+            ret = st_table_retire(pool, &detached->array->retired);
+            if (ret != ST_OK) {
+                return ret;
+            }
+
+            detached->array = NULL;
+            break;
+        }
+
+        st_table_element_t *e = detached->array->slots[--detached->array_left];
+        (*visited_cnt)++;
+
+        if (e != NULL) {
+            ret = st_table_retire_pinned(pool, detached->pin, e);
+            if (ret != ST_OK) {
+                return ret;
+            }
+        }
+    }
+
+    // no rebalancing is needed for tree to be freed: rotate right until root
+    // has no left child, then free root and go on with its right child.
+    // every node is rotated to right spine at most once.
+    while (detached->root != detached->sentinel && *visited_cnt < max_cnt) {
+
+        st_rbtree_node_t *n = detached->root;
+        (*visited_cnt)++;
+
+        if (n->left != detached->sentinel) {
+            st_rbtree_node_t *left = n->left;
+
+            n->left = left->right;
+            left->right = n;
+            detached->root = left;
+
+            continue;
+        }
+
+        detached->root = n->right;
+
+        st_table_element_t *e = st_owner(n, st_table_element_t, rbnode);
+
+        ret = st_table_retire_pinned(pool, detached->pin, e);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    // prefix index is only visited with table locked, nodes are freed at once.
+    return st_art_free_detached(&pool->slab_pool, &detached->prefix_nodes, max_cnt, visited_cnt);
+}
+
+int st_table_free_detached(st_table_pool_t *pool, int max_cnt, int *visited_cnt) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(visited_cnt != NULL, ST_ARG_INVALID);
+
+    int ret;
+
+    while (*visited_cnt < max_cnt) {
+
+        if (st_list_empty(&pool->detached)) {
+            return ST_EMPTY;
+        }
+
+        st_table_detached_t *detached = st_list_first_entry(&pool->detached,
+                                                            st_table_detached_t, lnode);
+
+        ret = st_table_free_detached_elements(pool, detached, max_cnt, visited_cnt);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        if (detached->array != NULL || detached->root != detached->sentinel
+                || detached->prefix_nodes != NULL) {
+            break;
+        }
+
+        st_list_remove(&detached->lnode);
+
+        ret = st_slab_obj_free(&pool->slab_pool, detached);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return st_list_empty(&pool->detached) ? ST_EMPTY : ST_OK;
+}
+
+// lock gc and table, and begin writing before use the function.
+// elements without cache tail are replaced with copies having it, so that
+// they are linked in clock list in table order. replaced elements are linked
+// by retired.next in *replaced, caller should free them after unlocking.
+// elements already replaced are kept if it fails to allocate a copy.
+static int st_table_add_cache_tails(st_table_t *table, st_table_retired_t **replaced) {
+
+    st_table_element_t *elem = st_table_first_element(table);
+
+    while (elem != NULL) {
+        if (st_table_element_cache(elem) != NULL) {
+            elem = st_table_next_element(table, elem);
+            continue;
+        }
+
+        st_table_element_t *copy = NULL;
+        st_table_element_t **slot = NULL;
+
+        // the copy takes another reference of blob of elem.
+        st_table_blob_t *blob = st_table_element_blob(elem);
+        if (blob != NULL) {
+            st_atomic_incr(&blob->refcnt, 1);
+        }
+
+        st_table_ttl_tail_t *ttl = st_table_element_ttl(elem);
+        int64_t expire_at = ttl != NULL ? ttl->expire_at : 0;
+
+        int ret = st_table_new_element_with_blob(table, elem->key, elem->value, blob,
+                                                 expire_at, &copy);
+        if (ret != ST_OK) {
+            if (blob != NULL) {
+                (void)st_table_blob_release(table->pool, blob);
+            }
+            return ret;
+        }
+
+        int64_t i = st_table_array_index(table->array, &elem->key);
+        if (i >= 0) {
+            slot = &table->array->slots[i];
+        }
+
+        ret = st_table_replace_element(table, elem, copy, slot);
+        if (ret != ST_OK) {
+            copy->retired.next = *replaced;
+            *replaced = &copy->retired;
+            return ret;
+        }
+
+        if (st_types_is_table(copy->value.type)) {
+            st_table_t *t = st_table_get_table_addr_from_value(copy->value);
+
+            ret = st_gc_push_to_mark(&table->pool->gc, &t->gc_head);
+            st_assert(ret == ST_OK);
+        }
+
+        elem->retired.next = *replaced;
+        *replaced = &elem->retired;
+
+        elem = st_table_next_element(table, copy);
+    }
+
+    return ST_OK;
+}
+
+int st_table_set_cache_limit(st_table_t *table, int64_t max_element_cnt, int64_t max_bytes) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(max_element_cnt >= 0, ST_ARG_INVALID);
+    st_must(max_bytes >= 0, ST_ARG_INVALID);
+
+    // every shard takes an equal part of the limits.
+    if (table->shards != NULL) {
+        int64_t n = table->shard_cnt;
+
+        for (int64_t i = 0; i < n; i++) {
+            int ret = st_table_set_cache_limit(table->shards[i],
+                                               (max_element_cnt + n - 1) / n,
+                                               (max_bytes + n - 1) / n);
+            if (ret != ST_OK) {
+                return ret;
+            }
+        }
+
+        return ST_OK;
+    }
+
+    st_gc_t *gc = &table->pool->gc;
+    st_table_retired_t *replaced = NULL;
+    int ret = ST_OK;
+
+    // the copy of element referencing a table is pushed to gc to mark, gc
+    // lock has to be taken before table lock.
+    st_robustlock_lock(&gc->lock);
+    st_robustrwlock_wrlock(&table->lock);
+
+    if (!table->cache) {
+        // elements allocated from now on have cache tail.
+        st_atomic_store(&table->cache, 1, __ATOMIC_RELAXED);
+
+        int64_t version = st_table_write_begin(table);
+
+        ret = st_table_add_cache_tails(table, &replaced);
+
+        if (replaced != NULL) {
+            st_table_write_end(table);
+        } else {
+            st_table_write_cancel(table, version);
+        }
+
+        if (ret != ST_OK) {
+            st_atomic_store(&table->cache, 0, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (ret == ST_OK) {
+        st_atomic_store(&table->max_element_cnt, max_element_cnt, __ATOMIC_RELAXED);
+        st_atomic_store(&table->max_bytes, max_bytes, __ATOMIC_RELAXED);
+    }
+
+    st_robustrwlock_wrunlock(&table->lock);
+    st_robustlock_unlock(&gc->lock);
+
+    while (replaced != NULL) {
+        st_table_retired_t *next = replaced->next;
+
+        int free_ret = st_table_free_element(table, (st_table_element_t *)replaced);
+        if (free_ret != ST_OK) {
+            ret = free_ret;
+        }
+
+        replaced = next;
+    }
+
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    return st_table_evict_if_needed(table);
+}
+
+// lock gc, ttl and table, and begin writing before use the function.
+// expired elements are linked by retired.next in *expired, caller should free
+// them after unlocking.
+static void st_table_expire_elements(st_table_t *table, int64_t now, int max_cnt,
+                                     int *visited_cnt, st_table_retired_t **expired) {
+
+    st_table_ttl_t *ttl = table->ttl;
+
+    int64_t now_slot = now / ST_TABLE_TTL_SLOT_USEC;
+
+    // every slot is processed only once in a round of the wheel.
+    if (ttl->next_slot < now_slot - ST_TABLE_TTL_SLOT_CNT) {
+        st_list_join(&ttl->slots[ttl->next_slot % ST_TABLE_TTL_SLOT_CNT], &ttl->checked);
+        ttl->next_slot = now_slot - ST_TABLE_TTL_SLOT_CNT;
+    }
+
+    // elements in current slot may not expire yet, it is processed after it
+    // passed.
+    while (ttl->next_slot < now_slot) {
+
+        st_list_t *slot = &ttl->slots[ttl->next_slot % ST_TABLE_TTL_SLOT_CNT];
+
+        while (!st_list_empty(slot)) {
+            // the slot is processed from where it stops next time.
+            if (*visited_cnt >= max_cnt) {
+                return;
+            }
+
+            (*visited_cnt)++;
+
+            st_table_ttl_tail_t *tail = st_list_first_entry(slot, st_table_ttl_tail_t, lnode);
+
+            // it expires in a later round of the wheel.
+            if (tail->expire_at > now) {
+                st_list_move_tail(&tail->lnode, &ttl->checked);
+                continue;
+            }
+
+            // ttl tail is always the first one of kv_data.
+            st_table_element_t *e = st_owner(tail, st_table_element_t, kv_data);
+
+            st_table_unlink_element(table, e);
+
+            e->retired.next = *expired;
+            *expired = &e->retired;
+        }
+
+        st_list_join(slot, &ttl->checked);
+        ttl->next_slot++;
+    }
+}
+
+int st_table_expire(st_table_pool_t *pool, int max_cnt, int *visited_cnt) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(visited_cnt != NULL, ST_ARG_INVALID);
+
+    st_table_ttl_t *first = NULL;
+    int64_t now = 0;
+
+    int ret = st_time_in_usec(&now);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_robustlock_lock(&pool->ttl_lock);
+
+    // tables are processed in turn, the one not finished is processed first
+    // next time.
+    while (*visited_cnt < max_cnt && !st_list_empty(&pool->ttl_tables)) {
+
+        st_table_ttl_t *ttl = st_list_first_entry(&pool->ttl_tables, st_table_ttl_t, lnode);
+        if (ttl == first) {
+            break;
+        }
+
+        if (first == NULL) {
+            first = ttl;
+        }
+
+        st_table_t *table = ttl->table;
+        st_table_retired_t *expired = NULL;
+
+        st_robustrwlock_wrlock(&table->lock);
+
+        int64_t version = st_table_write_begin(table);
+
+        st_table_expire_elements(table, now, max_cnt, visited_cnt, &expired);
+
+        if (expired != NULL) {
+            st_table_write_end(table);
+        } else {
+            st_table_write_cancel(table, version);
+        }
+
+        st_robustrwlock_wrunlock(&table->lock);
+
+        while (expired != NULL) {
+            st_table_retired_t *next = expired->next;
+
+            int free_ret = st_table_free_element(table, (st_table_element_t *)expired);
+            if (free_ret != ST_OK) {
+                ret = free_ret;
+            }
+
+            expired = next;
+        }
+
+        if (ttl->next_slot < now / ST_TABLE_TTL_SLOT_USEC) {
+            break;
+        }
+
+        st_list_move_tail(&ttl->lnode, &pool->ttl_tables);
+    }
+
+    st_robustlock_unlock(&pool->ttl_lock);
+
+    return ret;
+}
+
+int st_table_enable_hash_index(st_table_t *table) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+
+    if (table->shards != NULL) {
+        int64_t existed = 0;
+
+        for (int64_t i = 0; i < table->shard_cnt; i++) {
+            int ret = st_table_enable_hash_index(table->shards[i]);
+            if (ret == ST_EXISTED) {
+                existed++;
+            } else if (ret != ST_OK) {
+                return ret;
+            }
+        }
+
+        return existed == table->shard_cnt ? ST_EXISTED : ST_OK;
+    }
+
+    st_table_hash_index_t *index = NULL;
+
+    int ret;
+    st_robustrwlock_wrlock(&table->lock);
+
+    if (table->hash_index != NULL) {
+        ret = ST_EXISTED;
+        goto quit;
+    }
+
+    int64_t capacity = ST_TABLE_HASH_INDEX_MIN_CAPACITY;
+    while (table->element_cnt * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+
+    ret = st_table_hash_index_new(table, capacity, &index);
+    if (ret != ST_OK) {
+        goto quit;
+    }
+
+    // index both elements in rbtree and in array part.
+    st_table_element_t *e = st_table_first_element(table);
+    while (e != NULL) {
+        st_table_hash_index_insert(index, e);
+        e = st_table_next_element(table, e);
+    }
+
+    st_atomic_store(&table->hash_index, index);
+
+quit:
+    st_robustrwlock_wrunlock(&table->lock);
+    return ret;
+}
+
+int st_table_enable_prefix_index(st_table_t *table) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+
+    if (table->shards != NULL) {
+        int64_t existed = 0;
+
+        for (int64_t i = 0; i < table->shard_cnt; i++) {
+            int ret = st_table_enable_prefix_index(table->shards[i]);
+            if (ret == ST_EXISTED) {
+                existed++;
+            } else if (ret != ST_OK) {
+                return ret;
+            }
+        }
+
+        return existed == table->shard_cnt ? ST_EXISTED : ST_OK;
+    }
+
+    st_slab_pool_t *slab_pool = &table->pool->slab_pool;
+    st_art_t *index = NULL;
+
+    int ret;
+    st_robustrwlock_wrlock(&table->lock);
+
+    if (table->prefix_index != NULL) {
+        ret = ST_EXISTED;
+        goto quit;
+    }
+
+    ret = st_slab_obj_alloc(slab_pool, sizeof(st_art_t), (void **)&index);
+    if (ret != ST_OK) {
+        goto quit;
+    }
+
+    st_art_init(index, slab_pool, st_table_element_key);
+
+    // string keys are never in array part.
+    st_table_element_t *e = st_table_first_element(table);
+    while (e != NULL) {
+        if (e->key.type == ST_TYPES_STRING) {
+            ret = st_art_insert(index, e);
+            if (ret != ST_OK) {
+                (void)st_art_destroy(index);
+                (void)st_slab_obj_free(slab_pool, index);
+                goto quit;
+            }
+        }
+
+        e = st_table_next_element(table, e);
+    }
+
+    table->prefix_index = index;
+
+quit:
+    st_robustrwlock_wrunlock(&table->lock);
+    return ret;
+}
+
+// add elem to table, or replace the element with the same key.
+static int st_table_set_element(st_table_t *table, st_table_element_t *elem) {
+
+    st_table_t *t = NULL;
+    st_table_element_t *existed_elem = NULL;
+
+    st_gc_t *gc = &table->pool->gc;
+
+    st_robustlock_lock(&gc->lock);
+
+    int ret = st_table_add_element(table, elem, 1, &existed_elem);
+    if (ret != ST_OK && ret != ST_EXISTED) {
+        st_table_free_element(table, elem);
+        st_robustlock_unlock(&gc->lock);
+        return ret;
+    }
+
+    if (existed_elem != NULL) {
+        if (st_types_is_table(existed_elem->value.type)) {
+            t = st_table_get_table_addr_from_value(existed_elem->value);
+
+            ret = st_gc_push_to_sweep(gc, &t->gc_head);
+            st_assert(ret == ST_OK);
+        }
+    }
+
+    if (st_types_is_table(elem->value.type)) {
+        t = st_table_get_table_addr_from_value(elem->value);
+
+        ret = st_gc_push_to_mark(gc, &t->gc_head);
+        st_assert(ret == ST_OK);
+    }
+
+    st_robustlock_unlock(&gc->lock);
+
+    if (existed_elem != NULL) {
+        ret = st_table_free_element(table, existed_elem);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return st_table_after_add(table);
+}
+// allocate ttl wheel of table if it is not allocated.
+static int st_table_ttl_init(st_table_t *table) {
+
+    st_table_pool_t *pool = table->pool;
+    st_table_ttl_t *ttl = NULL;
+    int64_t now = 0;
+
+    // ttl wheel is never freed before table is freed.
+    if (st_atomic_load(&table->ttl, __ATOMIC_RELAXED) != NULL) {
+        return ST_OK;
+    }
+
+    int ret = st_time_in_usec(&now);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_slab_obj_alloc(&pool->slab_pool, sizeof(st_table_ttl_t), (void **)&ttl);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_robustlock_lock(&pool->ttl_lock);
+    st_robustrwlock_wrlock(&table->lock);
+
+    if (table->ttl == NULL) {
+        ttl->table = table;
+        ttl->next_slot = now / ST_TABLE_TTL_SLOT_USEC;
+        st_list_init(&ttl->checked);
+
+        for (int i = 0; i < ST_TABLE_TTL_SLOT_CNT; i++) {
+            st_list_init(&ttl->slots[i]);
+        }
+
+        st_list_insert_last(&pool->ttl_tables, &ttl->lnode);
+        st_atomic_store(&table->ttl, ttl, __ATOMIC_RELAXED);
+
+        ttl = NULL;
+    }
+
+    st_robustrwlock_wrunlock(&table->lock);
+    st_robustlock_unlock(&pool->ttl_lock);
+
+    if (ttl != NULL) {
+        return st_slab_obj_free(&pool->slab_pool, ttl);
+    }
+
+    return ST_OK;
+}
+
+int st_table_set_key_value(st_table_t *table, st_str_t key, st_str_t value) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    st_table_element_t *elem = NULL;
+    st_table_element_t *existed_elem = NULL;
+
+    // table value is marked by gc, gc lock has to be taken before table lock.
+    if (st_types_is_table(value.type)) {
+        int ret = st_table_new_element(table, key, value, &elem);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        return st_table_set_element(table, elem);
+    }
+
+    st_robustrwlock_wrlock(&table->lock);
+
+    int ret = st_table_find_element(table, key, &existed_elem);
+    if (ret != ST_OK && ret != ST_NOT_FOUND) {
+        st_robustrwlock_wrunlock(&table->lock);
+        return ret;
+    }
+
+    // overwriting value in place saves allocating and freeing element and
+    // replacing rbtree node. replacing table value needs gc lock, it is rare,
+    // it is set with gc lock below.
+    if (ret == ST_OK && !st_types_is_table(existed_elem->value.type)) {
+        int64_t version = st_table_write_begin(table);
+
+        if (st_table_overwrite_value(table, existed_elem, value)) {
+            st_table_write_end(table);
+            st_robustrwlock_wrunlock(&table->lock);
+
+            return st_table_run_gc_if_needed(table);
+        }
+
+        st_table_write_cancel(table, version);
+    }
+
+    st_robustrwlock_wrunlock(&table->lock);
+
+    // element is allocated only if value can not be overwritten, and it is
+    // allocated with table unlocked, so that writers do not wait for slab
+    // lock, intern lock or copying value.
+    ret = st_table_new_element(table, key, value, &elem);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_robustrwlock_wrlock(&table->lock);
+
+    // key may be set or removed by others while table is unlocked.
+    existed_elem = NULL;
+
+    ret = st_table_find_element(table, key, &existed_elem);
+    if (ret != ST_OK && ret != ST_NOT_FOUND) {
+        st_robustrwlock_wrunlock(&table->lock);
+        (void)st_table_free_element(table, elem);
+        return ret;
+    }
+
+    if (ret == ST_OK && st_types_is_table(existed_elem->value.type)) {
+        st_robustrwlock_wrunlock(&table->lock);
+        return st_table_set_element(table, elem);
+    }
+
+    int modified = 0;
+    int64_t version = st_table_write_begin(table);
+
+    if (existed_elem != NULL) {
+        st_table_element_t **slot = NULL;
+
+        int64_t i = st_table_array_index(table->array, &key);
+        if (i >= 0) {
+            slot = &table->array->slots[i];
+        }
+
+        ret = st_table_replace_element(table, existed_elem, elem, slot);
+        modified = ret == ST_OK;
+    } else {
+        ret = st_table_insert_element(table, elem, 1, &existed_elem, &modified);
+    }
+
+    if (modified) {
+        st_table_write_end(table);
+    } else {
+        st_table_write_cancel(table, version);
+    }
+
+    st_robustrwlock_wrunlock(&table->lock);
+
+    if (ret != ST_OK && ret != ST_EXISTED) {
+        (void)st_table_free_element(table, elem);
+        return ret;
+    }
+
+    if (existed_elem != NULL) {
+        ret = st_table_free_element(table, existed_elem);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return st_table_after_add(table);
+}
+
+int st_table_set_key_value_ex(st_table_t *table, st_str_t key, st_str_t value,
+                              int64_t ttl_usec) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+    st_must(!st_types_is_table(value.type), ST_ARG_INVALID);
+    st_must(ttl_usec > 0, ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    st_table_element_t *elem = NULL;
+    int64_t now = 0;
+
+    int ret = st_table_ttl_init(table);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_time_in_usec(&now);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_table_new_element_ex(table, key, value, now + ttl_usec, &elem);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    return st_table_set_element(table, elem);
+}
+
+// keys are grouped by shard in their order, so that every shard is locked
+// once, and a later value of the same key is still set later.
+static int st_table_set_many_sharded(st_table_t *table, st_str_t *keys, st_str_t *values,
+                                     int64_t cnt) {
+
+    int64_t starts[ST_TABLE_MAX_SHARD_CNT + 1] = {0};
+    int64_t ends[ST_TABLE_MAX_SHARD_CNT] = {0};
+    int ret = ST_OK;
+
+    int8_t *indexes = st_malloc(cnt * sizeof(*indexes));
+    if (indexes == NULL) {
+        return ST_OUT_OF_MEMORY;
+    }
+
+    st_str_t *grouped = st_malloc(cnt * 2 * sizeof(*grouped));
+    if (grouped == NULL) {
+        st_free(indexes);
+        return ST_OUT_OF_MEMORY;
+    }
+
+    st_str_t *grouped_keys = grouped;
+    st_str_t *grouped_values = grouped + cnt;
+
+    for (int64_t i = 0; i < cnt; i++) {
+        indexes[i] = st_table_shard_index(table, keys[i]);
+        starts[indexes[i] + 1]++;
+    }
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        starts[i + 1] += starts[i];
+        ends[i] = starts[i];
+    }
+
+    for (int64_t i = 0; i < cnt; i++) {
+        int64_t j = ends[indexes[i]]++;
+
+        grouped_keys[j] = keys[i];
+        grouped_values[j] = values[i];
+    }
+
+    for (int64_t i = 0; i < table->shard_cnt; i++) {
+        if (ends[i] == starts[i]) {
+            continue;
+        }
+
+        ret = st_table_set_many(table->shards[i], &grouped_keys[starts[i]],
+                                &grouped_values[starts[i]], ends[i] - starts[i]);
+        if (ret != ST_OK) {
+            break;
+        }
+    }
+
+    st_free(grouped);
+    st_free(indexes);
+
+    return ret;
+}
+
+int st_table_set_many(st_table_t *table, st_str_t *keys, st_str_t *values, int64_t cnt) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(keys != NULL, ST_ARG_INVALID);
+    st_must(values != NULL, ST_ARG_INVALID);
+    st_must(cnt > 0, ST_ARG_INVALID);
+
+    for (int64_t i = 0; i < cnt; i++) {
+        st_must(keys[i].bytes != NULL && keys[i].len > 0, ST_ARG_INVALID);
+        st_must(values[i].bytes != NULL && values[i].len > 0, ST_ARG_INVALID);
+    }
+
+    if (table->shards != NULL) {
+        return st_table_set_many_sharded(table, keys, values, cnt);
+    }
+
+    st_gc_t *gc = &table->pool->gc;
+    int64_t allocated = 0;
+    int64_t applied = 0;
+    int modified = 0;
+    int ret;
+
+    st_table_element_t **elems = st_malloc(cnt * sizeof(st_table_element_t *));
+    if (elems == NULL) {
+        return ST_OUT_OF_MEMORY;
+    }
+
+    // allocate all elements before locking.
+    for (allocated = 0; allocated < cnt; allocated++) {
+        ret = st_table_new_element(table, keys[allocated], values[allocated], &elems[allocated]);
+        if (ret != ST_OK) {
+            goto free_new;
+        }
+    }
+
+    st_robustlock_lock(&gc->lock);
+    st_robustrwlock_wrlock(&table->lock);
+
+    int64_t version = st_table_write_begin(table);
+
+    for (applied = 0; applied < cnt; applied++) {
+        st_table_element_t *existed_elem = NULL;
+
+        ret = st_table_insert_element(table, elems[applied], 1, &existed_elem, &modified);
+        if (ret != ST_OK && ret != ST_EXISTED) {
+            break;
+        }
+
+        // keep the replaced element to free it later.
+        elems[applied] = existed_elem;
+    }
+
+    if (modified) {
+        st_table_write_end(table);
+    } else {
+        st_table_write_cancel(table, version);
+    }
+
+    st_robustrwlock_wrunlock(&table->lock);
+
+    for (int64_t i = 0; i < applied; i++) {
+        st_table_t *t = NULL;
+
+        if (elems[i] != NULL && st_types_is_table(elems[i]->value.type)) {
+            t = st_table_get_table_addr_from_value(elems[i]->value);
+
+            int gc_ret = st_gc_push_to_sweep(gc, &t->gc_head);
+            st_assert(gc_ret == ST_OK);
+        }
+
+        if (st_types_is_table(values[i].type)) {
+            t = st_table_get_table_addr_from_value(values[i]);
+
+            int gc_ret = st_gc_push_to_mark(gc, &t->gc_head);
+            st_assert(gc_ret == ST_OK);
+        }
+    }
+
+    st_robustlock_unlock(&gc->lock);
+
+    // replaced elements, and new elements not applied if failed.
+    int free_ret = ST_OK;
+
+    for (int64_t i = 0; i < cnt; i++) {
+        if (elems[i] != NULL) {
+            int r = st_table_free_element(table, elems[i]);
+            if (r != ST_OK) {
+                free_ret = r;
+            }
+        }
+    }
+
+    st_free(elems);
+
+    if (applied < cnt) {
+        return ret;
+    }
+
+    if (free_ret != ST_OK) {
+        return free_ret;
+    }
+
+    return st_table_after_add(table);
+
+free_new:
+    for (int64_t i = 0; i < allocated; i++) {
+        st_table_free_element(table, elems[i]);
+    }
+
+    st_free(elems);
+
+    return ret;
+}
+
+int st_table_txn_init(st_table_pool_t *pool, st_table_txn_t *txn) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(txn != NULL, ST_ARG_INVALID);
+
+    txn->pool = pool;
+    txn->ops = NULL;
+    txn->cnt = 0;
+    txn->capacity = 0;
+
+    return ST_OK;
+}
+
+static int st_table_txn_add_op(st_table_txn_t *txn, st_table_txn_op_t *op) {
+
+    if (txn->cnt == txn->capacity) {
+        int64_t capacity = st_max(txn->capacity * 2, 8);
+
+        st_table_txn_op_t *ops = st_malloc(sizeof(*ops) * capacity);
+        if (ops == NULL) {
+            return ST_OUT_OF_MEMORY;
+        }
+
+        if (txn->ops != NULL) {
+            st_memcpy(ops, txn->ops, sizeof(*ops) * txn->cnt);
+            st_free(txn->ops);
+        }
+
+        txn->ops = ops;
+        txn->capacity = capacity;
+    }
+
+    txn->ops[txn->cnt++] = *op;
+
+    return ST_OK;
+}
+
+int st_table_txn_set(st_table_txn_t *txn, st_table_t *table, st_str_t key, st_str_t value) {
+
+    st_must(txn != NULL, ST_ARG_INVALID);
+    st_must(txn->pool != NULL, ST_UNINITED);
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(table->pool == txn->pool, ST_ARG_INVALID);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+
+    st_table_txn_op_t op = {
+        .table = st_table_shard_of(table, key),
+        .elem = NULL,
+        .key = st_str_null,
+        .replaced = NULL,
+        .skipped = 0,
+    };
+
+    // key and value are copied now, caller need not keep them until commit.
+    int ret = st_table_new_element(op.table, key, value, &op.elem);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_table_txn_add_op(txn, &op);
+    if (ret != ST_OK) {
+        st_table_free_element(op.table, op.elem);
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+int st_table_txn_remove(st_table_txn_t *txn, st_table_t *table, st_str_t key) {
+
+    st_must(txn != NULL, ST_ARG_INVALID);
+    st_must(txn->pool != NULL, ST_UNINITED);
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(table->pool == txn->pool, ST_ARG_INVALID);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+
+    st_table_txn_op_t op = {
+        .table = st_table_shard_of(table, key),
+        .elem = NULL,
+        .key = st_str_null,
+        .replaced = NULL,
+        .skipped = 0,
+    };
+
+    int ret = st_str_copy(&op.key, &key);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_table_txn_add_op(txn, &op);
+    if (ret != ST_OK) {
+        st_str_destroy(&op.key);
+        return ret;
+    }
+
+    return ST_OK;
+}
+
+static int st_table_txn_lock_cmp(const void *a, const void *b) {
+
+    uintptr_t x = (uintptr_t)((st_table_txn_lock_t *)a)->table;
+    uintptr_t y = (uintptr_t)((st_table_txn_lock_t *)b)->table;
+
+    return x < y ? -1 : x > y;
+}
+
+static st_str_t *st_table_txn_op_key(st_table_txn_op_t *op) {
+    return op->elem != NULL ? &op->elem->key : &op->key;
+}
+
+// order mutations by table, key and then the order they are added.
+static int st_table_txn_op_cmp(const void *a, const void *b) {
+
+    st_table_txn_op_t *x = *(st_table_txn_op_t **)a;
+    st_table_txn_op_t *y = *(st_table_txn_op_t **)b;
+
+    if (x->table != y->table) {
+        return (uintptr_t)x->table < (uintptr_t)y->table ? -1 : 1;
+    }
+
+    int ret = st_str_cmp(st_table_txn_op_key(x), st_table_txn_op_key(y));
+    if (ret != 0) {
+        return ret;
+    }
+
+    return x < y ? -1 : x > y;
+}
+
+// mark mutations followed by a later one of the same key as skipped, so that
+// mutations left can be applied in any order.
+static int st_table_txn_skip_overwritten(st_table_txn_t *txn) {
+
+    st_table_txn_op_t **sorted = st_malloc(sizeof(*sorted) * txn->cnt);
+    if (sorted == NULL) {
+        return ST_OUT_OF_MEMORY;
+    }
+
+    for (int64_t i = 0; i < txn->cnt; i++) {
+        sorted[i] = &txn->ops[i];
+    }
+
+    qsort(sorted, txn->cnt, sizeof(*sorted), st_table_txn_op_cmp);
+
+    for (int64_t i = 0; i + 1 < txn->cnt; i++) {
+        st_table_txn_op_t *op = sorted[i];
+        st_table_txn_op_t *next = sorted[i + 1];
+
+        op->skipped = op->table == next->table
+                      && st_str_cmp(st_table_txn_op_key(op), st_table_txn_op_key(next)) == 0;
+    }
+
+    st_free(sorted);
+
+    return ST_OK;
+}
+
+// lock table and begin writing before use the function.
+static int st_table_txn_apply(st_table_txn_op_t *op, st_table_txn_lock_t *lock) {
+
+    if (op->elem != NULL) {
+        int ret = st_table_insert_element(op->table, op->elem, 1, &op->replaced,
+                                          &lock->modified);
+        return ret == ST_EXISTED ? ST_OK : ret;
+    }
+
+    if (st_table_get_element(op->table, op->key, &op->replaced) != ST_OK) {
+        op->replaced = NULL;
+        return ST_OK;
+    }
+
+    st_table_unlink_element(op->table, op->replaced);
+    lock->modified = 1;
+
+    return ST_OK;
+}
+
+// lock table and begin writing before use the function.
+// undo an applied setting, it never fails, since nothing is allocated.
+static void st_table_txn_undo(st_table_txn_op_t *op) {
+
+    st_table_t *table = op->table;
+    st_table_element_t **slot = NULL;
+
+    if (op->replaced == NULL) {
+        st_table_unlink_element(table, op->elem);
+        return;
+    }
+
+    int64_t i = st_table_array_index(table->array, &op->elem->key);
+    if (i >= 0) {
+        slot = &table->array->slots[i];
+    }
+
+    // rbtree only takes an unlinked node as replacement, lock free readers
+    // seeing NULL children retry.
+    op->replaced->rbnode = (st_rbtree_node_t)st_rbtree_node_empty;
+
+    int ret = st_table_replace_element(table, op->elem, op->replaced, slot);
+    st_assert(ret == ST_OK);
+
+    op->replaced = NULL;
+}
+
+int st_table_txn_commit(st_table_txn_t *txn) {
+
+    st_must(txn != NULL, ST_ARG_INVALID);
+    st_must(txn->pool != NULL, ST_UNINITED);
+
+    if (txn->cnt == 0) {
+        return ST_OK;
+    }
+
+    st_gc_t *gc = &txn->pool->gc;
+    int64_t lock_cnt = 0;
+    int64_t applied = 0;
+    int ret = ST_OK;
+
+    ret = st_table_txn_skip_overwritten(txn);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_table_txn_lock_t *locks = st_malloc(sizeof(*locks) * txn->cnt);
+    if (locks == NULL) {
+        return ST_OUT_OF_MEMORY;
+    }
+
+    // distinct tables in the order of address, they are always locked in it.
+    for (int64_t i = 0; i < txn->cnt; i++) {
+        locks[i] = (st_table_txn_lock_t){.table = txn->ops[i].table, .modified = 0};
+    }
+
+    qsort(locks, txn->cnt, sizeof(*locks), st_table_txn_lock_cmp);
+
+    for (int64_t i = 0; i < txn->cnt; i++) {
+        if (lock_cnt == 0 || locks[lock_cnt - 1].table != locks[i].table) {
+            locks[lock_cnt++] = locks[i];
+        }
+    }
+
+    st_robustlock_lock(&gc->lock);
+
+    // all tables are being modified before any of them is, lock free readers
+    // never see a part of the mutations.
+    for (int64_t i = 0; i < lock_cnt; i++) {
+        st_robustrwlock_wrlock(&locks[i].table->lock);
+        locks[i].version = st_table_write_begin(locks[i].table);
+    }
+
+    // setting may fail to allocate index nodes, while removing never fails.
+    // all settings are applied first, and undone in reverse order if any of
+    // them fails.
+    for (int remove = 0; remove <= 1 && ret == ST_OK; remove++) {
+        for (int64_t i = 0; i < txn->cnt; i++) {
+            st_table_txn_op_t *op = &txn->ops[i];
+            st_table_txn_lock_t key = {.table = op->table};
+
+            if (op->skipped || (op->elem == NULL) != remove) {
+                continue;
+            }
+
+            st_table_txn_lock_t *lock = bsearch(&key, locks, lock_cnt, sizeof(*locks),
+                                                st_table_txn_lock_cmp);
+
+            ret = st_table_txn_apply(op, lock);
+            if (ret != ST_OK) {
+                applied = i;
+                break;
+            }
+        }
+    }
+
+    if (ret != ST_OK) {
+        for (int64_t i = applied - 1; i >= 0; i--) {
+            st_table_txn_op_t *op = &txn->ops[i];
+
+            if (!op->skipped && op->elem != NULL) {
+                st_table_txn_undo(op);
+            }
+        }
+    }
+
+    for (int64_t i = lock_cnt - 1; i >= 0; i--) {
+        if (locks[i].modified) {
+            st_table_write_end(locks[i].table);
+        } else {
+            st_table_write_cancel(locks[i].table, locks[i].version);
+        }
+
+        st_robustrwlock_wrunlock(&locks[i].table->lock);
+    }
+
+    for (int64_t i = 0; i < txn->cnt && ret == ST_OK; i++) {
+        st_table_txn_op_t *op = &txn->ops[i];
+        st_table_t *t = NULL;
+
+        // table set by a skipped mutation is replaced at once.
+        st_table_element_t *dropped = op->skipped ? op->elem : op->replaced;
+
+        if (dropped != NULL && st_types_is_table(dropped->value.type)) {
+            t = st_table_get_table_addr_from_value(dropped->value);
+
+            int gc_ret = st_gc_push_to_sweep(gc, &t->gc_head);
+            st_assert(gc_ret == ST_OK);
+        }
+
+        if (!op->skipped && op->elem != NULL && st_types_is_table(op->elem->value.type)) {
+            t = st_table_get_table_addr_from_value(op->elem->value);
+
+            int gc_ret = st_gc_push_to_mark(gc, &t->gc_head);
+            st_assert(gc_ret == ST_OK);
+        }
+    }
+
+    st_robustlock_unlock(&gc->lock);
+
+    // replaced and removed elements and elements of skipped mutations, or all
+    // new elements if failed.
+    int free_ret = ST_OK;
+
+    for (int64_t i = 0; i < txn->cnt; i++) {
+        st_table_txn_op_t *op = &txn->ops[i];
+        st_table_element_t *elem = op->elem;
+
+        if (ret == ST_OK && !op->skipped) {
+            elem = op->replaced;
+        }
+
+        if (elem != NULL) {
+            int r = st_table_free_element(op->table, elem);
+            if (r != ST_OK) {
+                free_ret = r;
+            }
+        }
+
+        st_str_destroy(&op->key);
+    }
+
+    txn->cnt = 0;
+
+    if (ret == ST_OK) {
+        ret = free_ret;
+    }
+
+    for (int64_t i = 0; i < lock_cnt && ret == ST_OK; i++) {
+        ret = st_table_after_add(locks[i].table);
+    }
+
+    st_free(locks);
+
+    return ret;
+}
+
+int st_table_txn_destroy(st_table_txn_t *txn) {
+
+    st_must(txn != NULL, ST_ARG_INVALID);
+    st_must(txn->pool != NULL, ST_UNINITED);
+
+    int ret = ST_OK;
+
+    for (int64_t i = 0; i < txn->cnt; i++) {
+        st_table_txn_op_t *op = &txn->ops[i];
+
+        if (op->elem != NULL) {
+            int r = st_table_free_element(op->table, op->elem);
+            if (r != ST_OK) {
+                ret = r;
+            }
+        }
+
+        st_str_destroy(&op->key);
+    }
+
+    st_free(txn->ops);
+
+    txn->pool = NULL;
+    txn->ops = NULL;
+    txn->cnt = 0;
+    txn->capacity = 0;
+
+    return ret;
+}
+
+static int st_table_value_equal(st_str_t *a, st_str_t *b) {
+
+    if (a->type != b->type || a->len != b->len) {
+        return 0;
+    }
+
+    return st_memcmp(a->bytes, b->bytes, a->len) == 0;
+}
+
+// set value of key only if version of table is the version if it is not
+// negative, and value of key is expected if expected is not NULL.
+static int st_table_set_if(st_table_t *table, st_str_t key, st_str_t value,
+                           st_str_t *expected, int64_t version) {
+
+    st_table_t *t = NULL;
+    st_table_element_t *elem = NULL;
+    st_table_element_t *existed_elem = NULL;
+
+    st_gc_t *gc = &table->pool->gc;
+    int modified = 0;
+
+    int ret = st_table_new_element(table, key, value, &elem);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_robustlock_lock(&gc->lock);
+    st_robustrwlock_wrlock(&table->lock);
+
+    if (version >= 0 && table->version != version) {
+        ret = ST_TABLE_MODIFIED;
+        goto unlock;
+    }
+
+    if (expected != NULL) {
+        ret = st_table_get_element(table, key, &existed_elem);
+
+        if (expected->bytes == NULL) {
+            ret = ret == ST_NOT_FOUND ? ST_OK : ST_NOT_EQUAL;
+        } else if (ret == ST_NOT_FOUND
+                   || !st_table_value_equal(&existed_elem->value, expected)) {
+            ret = ST_NOT_EQUAL;
+        }
+
+        existed_elem = NULL;
+
+        if (ret != ST_OK) {
+            goto unlock;
+        }
+    }
+
+    int64_t old_version = st_table_write_begin(table);
+
+    ret = st_table_insert_element(table, elem, 1, &existed_elem, &modified);
+
+    if (modified) {
+        st_table_write_end(table);
+    } else {
+        st_table_write_cancel(table, old_version);
+    }
+
+    if (ret == ST_EXISTED) {
+        ret = ST_OK;
+    }
+
+unlock:
+    st_robustrwlock_wrunlock(&table->lock);
+
+    if (ret != ST_OK) {
+        st_robustlock_unlock(&gc->lock);
+        st_table_free_element(table, elem);
+        return ret;
+    }
+
+    if (existed_elem != NULL && st_types_is_table(existed_elem->value.type)) {
+        t = st_table_get_table_addr_from_value(existed_elem->value);
+
+        ret = st_gc_push_to_sweep(gc, &t->gc_head);
+        st_assert(ret == ST_OK);
+    }
+
+    if (st_types_is_table(value.type)) {
+        t = st_table_get_table_addr_from_value(value);
+
+        ret = st_gc_push_to_mark(gc, &t->gc_head);
+        st_assert(ret == ST_OK);
+    }
+
+    st_robustlock_unlock(&gc->lock);
+
+    if (existed_elem != NULL) {
+        ret = st_table_free_element(table, existed_elem);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return st_table_after_add(table);
+}
+
+int st_table_cas(st_table_t *table, st_str_t key, st_str_t expected, st_str_t value) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+    st_must(expected.bytes == NULL || expected.len > 0, ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    return st_table_set_if(table, key, value, &expected, -1);
+}
+
+int st_table_set_if_version(st_table_t *table, st_str_t key, st_str_t value,
+                            int64_t version) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+    st_must(version >= 0, ST_ARG_INVALID);
+    st_must(table->shards == NULL, ST_UNSUPPORTED);
+
+    return st_table_set_if(table, key, value, NULL, version);
+}
+
+int64_t st_table_get_version(st_table_t *table) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(table->shards == NULL, ST_UNSUPPORTED);
+
+    return st_atomic_load(&table->version, __ATOMIC_ACQUIRE);
+}
+
+int st_table_add_key_value(st_table_t *table, st_str_t key, st_str_t value) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    st_table_element_t *elem = NULL;
+
+    // expired element is replaced, it never has table value.
+    st_table_element_t *expired_elem = NULL;
+
+    int ret = st_table_new_element(table, key, value, &elem);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (st_types_is_table(value.type)) {
+
+        st_table_t *t = st_table_get_table_addr_from_value(value);
+        st_gc_t *gc = &table->pool->gc;
+
+        st_robustlock_lock(&gc->lock);
+
+        ret = st_table_add_element(table, elem, 0, &expired_elem);
+        if (ret != ST_OK) {
+            st_robustlock_unlock(&gc->lock);
+            goto quit;
+        }
+
+        ret = st_gc_push_to_mark(gc, &t->gc_head);
+        st_assert(ret == ST_OK);
+
+        st_robustlock_unlock(&gc->lock);
+
+    } else {
+        ret = st_table_add_element(table, elem, 0, &expired_elem);
+        if (ret != ST_OK) {
+            goto quit;
+        }
+    }
+
+    if (expired_elem != NULL) {
+        ret = st_table_free_element(table, expired_elem);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return st_table_after_add(table);
+
+quit:
+    st_table_free_element(table, elem);
+    return ret;
+}
+
+static ssize_t st_table_number_size(st_types_t type) {
+
+    switch (type) {
+    case ST_TYPES_INTEGER:
+        return sizeof(int);
+    case ST_TYPES_U64:
+        return sizeof(uint64_t);
+    case ST_TYPES_NUMBER:
+        return sizeof(double);
+    default:
+        return 0;
+    }
+}
+
+// result = value + delta, all of them are numbers of the type.
+// integer overflow is an error, u64 wraps around.
+static int st_table_number_add(st_types_t type, uint8_t *value, uint8_t *delta,
+                               uint8_t *result) {
+
+    switch (type) {
+    case ST_TYPES_INTEGER: {
+        int a, b, r;
+        st_memcpy(&a, value, sizeof(a));
+        st_memcpy(&b, delta, sizeof(b));
+
+        if (__builtin_add_overflow(a, b, &r)) {
+            return ST_NUM_OVERFLOW;
+        }
+
+        st_memcpy(result, &r, sizeof(r));
+        return ST_OK;
+    }
+    case ST_TYPES_U64: {
+        uint64_t a, b, r;
+        st_memcpy(&a, value, sizeof(a));
+        st_memcpy(&b, delta, sizeof(b));
+
+        r = a + b;
+
+        st_memcpy(result, &r, sizeof(r));
+        return ST_OK;
+    }
+    case ST_TYPES_NUMBER: {
+        double a, b, r;
+        st_memcpy(&a, value, sizeof(a));
+        st_memcpy(&b, delta, sizeof(b));
+
+        r = a + b;
+
+        st_memcpy(result, &r, sizeof(r));
+        return ST_OK;
+    }
+    default:
+        return ST_ARG_INVALID;
+    }
+}
+
+// add delta to value of key in place with table locked.
+// if some snapshot exists, value is not modified and ST_AGAIN is returned with
+// current value in old_value and the result in new_value, caller should
+// replace the element.
+static int st_table_incr_existed(st_table_t *table, st_str_t key, st_str_t delta,
+                                 uint8_t *old_value, uint8_t *new_value) {
+
+    st_table_element_t *elem = NULL;
+
+    st_robustrwlock_wrlock(&table->lock);
+
+    int ret = st_table_get_element(table, key, &elem);
+    if (ret != ST_OK) {
+        goto quit;
+    }
+
+    if (elem->value.type != delta.type || elem->value.len != delta.len) {
+        ret = ST_STATE_INVALID;
+        goto quit;
+    }
+
+    ret = st_table_number_add(delta.type, elem->value.bytes, delta.bytes, new_value);
+    if (ret != ST_OK) {
+        goto quit;
+    }
+
+    if (st_atomic_load(&table->pin) != 0) {
+        st_memcpy(old_value, elem->value.bytes, delta.len);
+        ret = ST_AGAIN;
+        goto quit;
+    }
+
+    st_table_write_begin(table);
+    st_memcpy(elem->value.bytes, new_value, delta.len);
+    st_table_write_end(table);
+
+quit:
+    st_robustrwlock_wrunlock(&table->lock);
+    return ret;
+}
+
+int st_table_incr(st_table_t *table, st_str_t key, st_str_t delta, void *new_value) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
     st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
-    st_must(value.bytes != NULL && value.len > 0, ST_ARG_INVALID);
+    st_must(delta.bytes != NULL, ST_ARG_INVALID);
+    st_must(delta.len > 0 && delta.len == st_table_number_size(delta.type), ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    uint8_t old_value[sizeof(uint64_t)];
+    uint8_t result[sizeof(uint64_t)];
+
+    while (1) {
+        int ret = st_table_incr_existed(table, key, delta, old_value, result);
+
+        if (ret == ST_AGAIN) {
+            // replace the element, if value is changed by others before
+            // that, increase it again.
+            st_str_t expected = st_str_wrap_common(old_value, delta.type, delta.len);
+            st_str_t value = st_str_wrap_common(result, delta.type, delta.len);
+
+            ret = st_table_cas(table, key, expected, value);
+            if (ret == ST_NOT_EQUAL) {
+                continue;
+            }
+
+        } else if (ret == ST_NOT_FOUND) {
+            // key is added with delta as initial value, if another process
+            // added the key at the same time, increase it again.
+            ret = st_table_add_key_value(table, key, delta);
+            if (ret == ST_EXISTED) {
+                continue;
+            }
+
+            st_memcpy(result, delta.bytes, delta.len);
+        }
+
+        if (ret == ST_OK && new_value != NULL) {
+            st_memcpy(new_value, result, delta.len);
+        }
+
+        return ret;
+    }
+}
+
+int st_table_remove_key(st_table_t *table, st_str_t key) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    st_table_element_t *removed = NULL;
+    st_gc_t *gc = &table->pool->gc;
+
+    int ret;
+    st_robustlock_lock(&gc->lock);
+
+    ret = st_table_remove_element(table, key, &removed);
+    if (ret != ST_OK) {
+        st_robustlock_unlock(&gc->lock);
+        return ret;
+    }
+
+    if (st_types_is_table(removed->value.type)) {
+        st_table_t *t = st_table_get_table_addr_from_value(removed->value);
+
+        ret = st_gc_push_to_sweep(gc, &t->gc_head);
+        st_assert(ret == ST_OK);
+    }
+
+    st_robustlock_unlock(&gc->lock);
+
+    ret = st_table_free_element(table, removed);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    return st_table_run_gc_if_needed(table);
+}
+
+int st_table_copy_value(st_table_t *dst, st_str_t dst_key, st_table_t *src, st_str_t src_key) {
+
+    st_must(dst != NULL, ST_ARG_INVALID);
+    st_must(dst->inited, ST_UNINITED);
+    st_must(dst_key.bytes != NULL && dst_key.len > 0, ST_ARG_INVALID);
+    st_must(src != NULL, ST_ARG_INVALID);
+    st_must(src->inited, ST_UNINITED);
+    st_must(src_key.bytes != NULL && src_key.len > 0, ST_ARG_INVALID);
+    st_must(dst->pool == src->pool, ST_ARG_INVALID);
+
+    src = st_table_shard_of(src, src_key);
+    dst = st_table_shard_of(dst, dst_key);
+
+    st_table_element_t *elem = NULL;
+    st_table_blob_t *blob = NULL;
+    st_str_t value = st_str_null;
+
+    // take a reference of blob or copy value, so that src need not be locked
+    // together with dst.
+    int slot = st_robustrwlock_rdlock(&src->lock);
+
+    int ret = st_table_get_element(src, src_key, &elem);
+    if (ret == ST_OK) {
+        if (st_types_is_table(elem->value.type)) {
+            ret = ST_UNSUPPORTED;
+        } else if (elem->flags & ST_TABLE_ELEMENT_BLOB) {
+            blob = st_table_element_blob(elem);
+            st_atomic_incr(&blob->refcnt, 1);
+
+            value = elem->value;
+        } else {
+            ret = st_str_copy(&value, &elem->value);
+        }
+    }
+
+    st_robustrwlock_rdunlock(&src->lock, slot);
+
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (blob != NULL) {
+        ret = st_table_new_element_with_blob(dst, dst_key, value, blob, 0, &elem);
+        if (ret != ST_OK) {
+            (void)st_table_blob_release(dst->pool, blob);
+            return ret;
+        }
+
+        return st_table_set_element(dst, elem);
+    }
+
+    ret = st_table_new_element(dst, dst_key, value, &elem);
+    st_str_destroy(&value);
+
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    return st_table_set_element(dst, elem);
+}
+
+// lock table before use the function
+int st_table_get_value(st_table_t *table, st_str_t key, st_str_t *value) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value != NULL, ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    st_table_element_t *elem;
+
+    int ret = st_table_get_element(table, key, &elem);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    st_table_touch_element(table, elem);
+
+    *value = elem->value;
+
+    return ret;
+}
+
+// copy value into buf of size bytes, value.bytes is set to buf. if buf is not
+// enough, return ST_BUF_NOT_ENOUGH and value.capacity is set to size needed.
+static int st_table_get_value_copy_once(st_table_t *table, st_str_t *key, st_str_t *value,
+                                        uint8_t *buf, int64_t size) {
+
+    st_table_element_t *elem = NULL;
+
+    int64_t version = st_atomic_load(&table->version, __ATOMIC_ACQUIRE);
+    if (version % 2 != 0) {
+        return ST_AGAIN;
+    }
+
+    int ret = st_table_search_optimistic(table, key, &elem);
+    if (ret == ST_OK) {
+        // element key is never changed after it is added to table, but value
+        // may be overwritten in place, copy from a snapshot so that a torn
+        // value never makes it read out of the element.
+        st_str_t snapshot = elem->value;
+
+        if (st_table_element_expired(elem)) {
+            ret = ST_NOT_FOUND;
+        } else if (st_types_is_table(snapshot.type)) {
+            ret = ST_AGAIN;
+        } else if (snapshot.capacity > size) {
+            *value = snapshot;
+            ret = ST_BUF_NOT_ENOUGH;
+        } else {
+            st_memcpy(buf, snapshot.bytes, snapshot.capacity);
+
+            *value = snapshot;
+            value->bytes = buf;
+
+            st_table_touch_element(table, elem);
+        }
+    }
+
+    // order reading table before validating version.
+    st_atomic_fence(__ATOMIC_ACQUIRE);
+
+    if (st_atomic_load(&table->version, __ATOMIC_RELAXED) != version) {
+        return ST_AGAIN;
+    }
+
+    return ret;
+}
+
+int st_table_get_value_copy(st_table_t *table, st_str_t key, st_str_t *value) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(value != NULL, ST_ARG_INVALID);
+
+    table = st_table_shard_of(table, key);
+
+    st_table_pool_t *pool = table->pool;
+
+    // value is copied into a buffer on stack in read section, it is copied to
+    // memory allocated after leaving, nothing blocks in read section.
+    uint8_t stack_buf[ST_TABLE_BLOB_MIN_LEN];
+    uint8_t *buf = stack_buf;
+    int64_t size = sizeof(stack_buf);
+
+    st_str_t copied = st_str_null;
+    int ret = ST_AGAIN;
+
+    for (int i = 0; i < ST_TABLE_OPTIMISTIC_READ_TRIES; i++) {
+        int slot = st_table_reader_enter(pool);
+        if (slot < 0) {
+            ret = ST_AGAIN;
+            break;
+        }
+
+        ret = st_table_get_value_copy_once(table, &key, &copied, buf, size);
+
+        st_table_reader_leave(pool, slot);
+
+        if (ret == ST_BUF_NOT_ENOUGH) {
+            if (buf != stack_buf) {
+                st_free(buf);
+            }
+
+            size = copied.capacity;
+
+            buf = st_malloc(size);
+            if (buf == NULL) {
+                return ST_OUT_OF_MEMORY;
+            }
+
+            ret = ST_AGAIN;
+            continue;
+        }
+
+        if (ret != ST_AGAIN) {
+            break;
+        }
+    }
+
+    if (ret != ST_OK) {
+        if (buf != stack_buf) {
+            st_free(buf);
+        }
+
+        return ret;
+    }
+
+    if (buf == stack_buf) {
+        buf = st_malloc(copied.capacity);
+        if (buf == NULL) {
+            return ST_OUT_OF_MEMORY;
+        }
+
+        st_memcpy(buf, stack_buf, copied.capacity);
+    }
+
+    copied.bytes = buf;
+    copied.bytes_owned = 1;
+
+    *value = copied;
+
+    return ST_OK;
+}
+
+// lock table before use the function
+int
+st_table_iter_init(st_table_t *table,
+                   st_table_iter_t *iter,
+                   st_str_t *init_key,
+                   int expected_side)
+{
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(iter != NULL, ST_ARG_INVALID);
+
+    iter->table_version = st_table_merged_version(table);
+    iter->prefixed = 0;
+
+    if (init_key == NULL) {
+        iter->element = st_table_merged_first(table);
+    }
+    else {
+        st_must(init_key->bytes != NULL, ST_ARG_INVALID);
+
+        iter->element = st_table_merged_search(table, init_key, expected_side);
+    }
+
+    return ST_OK;
+}
+
+// lock table before use the function
+int st_table_iter_init_prefix(st_table_t *table, st_table_iter_t *iter, st_str_t *prefix) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(iter != NULL, ST_ARG_INVALID);
+    st_must(prefix != NULL, ST_ARG_INVALID);
+    st_must(prefix->type == ST_TYPES_STRING, ST_ARG_INVALID);
+
+    iter->table_version = st_table_merged_version(table);
+    iter->prefixed = 1;
+    iter->prefix = *prefix;
+    iter->element = st_table_prefix_first(table, prefix);
+
+    return ST_OK;
+}
+
+// you can lock whole iterate, to avoid table change in iterate runtime.
+// or you must lock st_table_iter_next, that not guarantee iterate table correctness.
+int st_table_iter_next(st_table_t *table, st_table_iter_t *iter, st_str_t *key,
+                       st_str_t *value) {
+
+    st_must(table != NULL, ST_ARG_INVALID);
+    st_must(table->inited, ST_UNINITED);
+    st_must(iter != NULL, ST_ARG_INVALID);
+    st_must(key != NULL, ST_ARG_INVALID);
+    st_must(value != NULL, ST_ARG_INVALID);
 
-    st_table_element_t *elem = NULL;
+    st_table_element_t *elem = iter->element;
 
-    int ret = st_table_new_element(table, key, value, &elem);
-    if (ret != ST_OK) {
-        return ret;
+    if (iter->table_version != st_table_merged_version(table)) {
+        return ST_TABLE_MODIFIED;
     }
 
-    if (st_types_is_table(value.type)) {
+    while (elem != NULL && st_table_element_expired(elem)) {
+        elem = st_table_merged_next(table, elem);
+    }
 
-        st_table_t *t = st_table_get_table_addr_from_value(value);
-        st_gc_t *gc = &table->pool->gc;
+    // keys with the same prefix are adjacent in key order.
+    if (elem != NULL && iter->prefixed && !st_table_key_has_prefix(&elem->key, &iter->prefix)) {
+        elem = NULL;
+    }
 
-        st_robustlock_lock(&gc->lock);
+    if (elem == NULL) {
+        iter->element = NULL;
+        return ST_ITER_FINISH;
+    }
 
-        ret = st_table_add_element(table, elem, 0, NULL);
-        if (ret != ST_OK) {
-            st_robustlock_unlock(&gc->lock);
-            goto quit;
-        }
+    *key = elem->key;
+    *value = elem->value;
 
-        ret = st_gc_push_to_mark(gc, &t->gc_head);
-        st_assert(ret == ST_OK);
+    iter->element = st_table_merged_next(table, elem);
 
-        st_robustlock_unlock(&gc->lock);
+    return ST_OK;
+}
 
-    } else {
-        ret = st_table_add_element(table, elem, 0, NULL);
-        if (ret != ST_OK) {
-            goto quit;
+// collect elements of table into snapshot, table is unlocked after every
+// ST_TABLE_SNAPSHOT_BATCH elements unless locked is set.
+// return ST_TABLE_MODIFIED if table is modified while it is unlocked.
+static int st_table_snapshot_collect(st_table_t *table, st_table_snapshot_t *snapshot,
+                                     int locked) {
+
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_rdlock_all(table, slots);
+
+    int64_t version = st_table_merged_version(table);
+
+    // element count does not change unless table is modified.
+    int64_t element_cnt = st_table_merged_cnt(table);
+
+    st_table_element_t **elements = st_malloc(sizeof(*elements) * st_max(element_cnt, 1));
+    if (elements == NULL) {
+        st_table_rdunlock_all(table, slots);
+        return ST_OUT_OF_MEMORY;
+    }
+
+    int64_t cnt = 0;
+    int64_t batch = 0;
+    st_table_element_t *elem = st_table_merged_first(table);
+
+    while (elem != NULL) {
+
+        if (!locked && batch == ST_TABLE_SNAPSHOT_BATCH) {
+            st_table_rdunlock_all(table, slots);
+            st_table_rdlock_all(table, slots);
+
+            // elem is still in table if table is not modified.
+            if (st_table_merged_version(table) != version) {
+                st_table_rdunlock_all(table, slots);
+                st_free(elements);
+                return ST_TABLE_MODIFIED;
+            }
+
+            batch = 0;
+        }
+
+        if (!st_table_element_expired(elem)) {
+            elements[cnt++] = elem;
         }
+
+        elem = st_table_merged_next(table, elem);
+        batch++;
     }
 
-    return st_table_run_gc_if_needed(table);
+    st_table_rdunlock_all(table, slots);
 
-quit:
-    st_table_free_element(table, elem);
-    return ret;
+    snapshot->elements = elements;
+    snapshot->cnt = cnt;
+    snapshot->next = 0;
+
+    return ST_OK;
 }
 
-int st_table_remove_key(st_table_t *table, st_str_t key) {
+int st_table_snapshot_init(st_table_t *table, st_table_snapshot_t *snapshot) {
 
     st_must(table != NULL, ST_ARG_INVALID);
     st_must(table->inited, ST_UNINITED);
-    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
-
-    st_table_element_t *removed = NULL;
-    st_gc_t *gc = &table->pool->gc;
+    st_must(snapshot != NULL, ST_ARG_INVALID);
 
-    int ret;
-    st_robustlock_lock(&gc->lock);
+    st_table_pool_t *pool = table->pool;
+    int pin = 0;
 
-    ret = st_table_remove_element(table, key, &removed);
+    // writers must see the pin before they can modify any element collected.
+    int ret = st_table_pin(table, &pin);
     if (ret != ST_OK) {
-        st_robustlock_unlock(&gc->lock);
         return ret;
     }
 
-    if (st_types_is_table(removed->value.type)) {
-        st_table_t *t = st_table_get_table_addr_from_value(removed->value);
+    ret = ST_TABLE_MODIFIED;
 
-        ret = st_gc_push_to_sweep(gc, &t->gc_head);
-        st_assert(ret == ST_OK);
+    for (int i = 1; ret == ST_TABLE_MODIFIED; i++) {
+        ret = st_table_snapshot_collect(table, snapshot, i >= ST_TABLE_SNAPSHOT_TRIES);
     }
 
-    st_robustlock_unlock(&gc->lock);
-
-    ret = st_table_free_element(table, removed);
     if (ret != ST_OK) {
+        (void)st_table_unpin(pool, pin);
         return ret;
     }
 
-    return st_table_run_gc_if_needed(table);
+    snapshot->pool = pool;
+    snapshot->pin = pin;
+
+    return ST_OK;
 }
 
-// lock table before use the function
-int st_table_get_value(st_table_t *table, st_str_t key, st_str_t *value) {
+int st_table_snapshot_next(st_table_snapshot_t *snapshot, st_str_t *key, st_str_t *value) {
 
-    st_must(table != NULL, ST_ARG_INVALID);
-    st_must(table->inited, ST_UNINITED);
-    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
+    st_must(snapshot != NULL, ST_ARG_INVALID);
+    st_must(snapshot->elements != NULL, ST_UNINITED);
+    st_must(key != NULL, ST_ARG_INVALID);
     st_must(value != NULL, ST_ARG_INVALID);
 
-    st_table_element_t *elem;
+    if (snapshot->next == snapshot->cnt) {
+        return ST_ITER_FINISH;
+    }
 
-    int ret = st_table_get_element(table, key, &elem);
+    st_table_element_t *elem = snapshot->elements[snapshot->next++];
+
+    *key = elem->key;
+    *value = elem->value;
+
+    return ST_OK;
+}
+
+int st_table_snapshot_destroy(st_table_snapshot_t *snapshot) {
+
+    st_must(snapshot != NULL, ST_ARG_INVALID);
+    st_must(snapshot->elements != NULL, ST_UNINITED);
+
+    st_free(snapshot->elements);
+
+    snapshot->elements = NULL;
+    snapshot->cnt = 0;
+    snapshot->next = 0;
+
+    return st_table_unpin(snapshot->pool, snapshot->pin);
+}
+
+int st_table_borrow_begin(st_table_pool_t *pool, st_table_borrow_t *borrow) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(borrow != NULL, ST_ARG_INVALID);
+
+    borrow->pool = pool;
+    borrow->pin_cnt = 0;
+
+    return ST_OK;
+}
+
+// pin table at the first borrowing from it. a shard pinned with its sharded
+// table has the same pin.
+static int st_table_borrow_pin(st_table_borrow_t *borrow, st_table_t *table) {
+
+    int pin = st_atomic_load(&table->pin);
+
+    for (int i = 0; i < borrow->pin_cnt && pin != 0; i++) {
+        if (borrow->pins[i] == pin) {
+            return ST_OK;
+        }
+    }
+
+    // a guard holds distinct pins, pinning fails before it runs out of room.
+    int ret = st_table_pin(table, &pin);
     if (ret != ST_OK) {
         return ret;
     }
 
-    *value = elem->value;
+    st_assert(borrow->pin_cnt < ST_TABLE_PIN_CNT);
+    borrow->pins[borrow->pin_cnt++] = pin;
 
-    return ret;
+    // writers must see the pin before they can modify any element in place,
+    // order it before reading table version.
+    st_atomic_fence(ST_ATOMIC_STRONGEST);
+
+    return ST_OK;
 }
 
-// lock table before use the function
-int
-st_table_iter_init(st_table_t *table,
-                   st_table_iter_t *iter,
-                   st_str_t *init_key,
-                   int expected_side)
-{
+// a writer that started before the pin may still be overwriting in place,
+// the value is only returned if table version shows no writer ran.
+static int st_table_borrow_value_once(st_table_t *table, st_str_t *key, st_str_t *value) {
 
-    st_must(table != NULL, ST_ARG_INVALID);
-    st_must(table->inited, ST_UNINITED);
-    st_must(iter != NULL, ST_ARG_INVALID);
+    st_table_element_t *elem = NULL;
+    st_str_t borrowed = st_str_null;
 
-    iter->table_version = table->version;
+    int64_t version = st_atomic_load(&table->version, __ATOMIC_ACQUIRE);
+    if (version % 2 != 0) {
+        return ST_AGAIN;
+    }
 
-    st_rbtree_node_t *n = NULL;
+    int ret = st_table_search_optimistic(table, key, &elem);
+    if (ret == ST_OK) {
+        borrowed = elem->value;
 
-    if (init_key == NULL) {
-        n = st_rbtree_left_most(&table->elements);
+        if (st_table_element_expired(elem)) {
+            ret = ST_NOT_FOUND;
+        }
     }
-    else {
-        st_must(init_key->bytes != NULL, ST_ARG_INVALID);
 
-        st_table_element_t target = { .key = *init_key };
-        n = st_rbtree_search(&table->elements, &target.rbnode, expected_side);
+    // order reading table before validating version.
+    st_atomic_fence(__ATOMIC_ACQUIRE);
+
+    if (st_atomic_load(&table->version, __ATOMIC_RELAXED) != version) {
+        return ST_AGAIN;
     }
 
-    if (n == NULL) {
-        iter->element = NULL;
-    } else {
-        iter->element = st_owner(n, st_table_element_t, rbnode);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    if (st_types_is_table(borrowed.type)) {
+        return ST_UNSUPPORTED;
     }
 
+    st_table_touch_element(table, elem);
+
+    *value = borrowed;
+
     return ST_OK;
 }
 
-// you can lock whole iterate, to avoid table change in iterate runtime.
-// or you must lock st_table_iter_next, that not guarantee iterate table correctness.
-int st_table_iter_next(st_table_t *table, st_table_iter_t *iter, st_str_t *key,
-                       st_str_t *value) {
+int st_table_borrow_value(st_table_borrow_t *borrow, st_table_t *table, st_str_t key,
+                          st_str_t *value) {
 
+    st_must(borrow != NULL, ST_ARG_INVALID);
     st_must(table != NULL, ST_ARG_INVALID);
     st_must(table->inited, ST_UNINITED);
-    st_must(iter != NULL, ST_ARG_INVALID);
-    st_must(key != NULL, ST_ARG_INVALID);
+    st_must(table->pool == borrow->pool, ST_ARG_INVALID);
+    st_must(key.bytes != NULL && key.len > 0, ST_ARG_INVALID);
     st_must(value != NULL, ST_ARG_INVALID);
 
-    st_table_element_t *elem = iter->element;
+    st_table_pool_t *pool = table->pool;
 
-    if (iter->table_version != table->version) {
-        return ST_TABLE_MODIFIED;
+    int ret = st_table_borrow_pin(borrow, table);
+    if (ret != ST_OK) {
+        return ret;
     }
 
-    if (elem == NULL) {
-        return ST_ITER_FINISH;
+    table = st_table_shard_of(table, key);
+
+    ret = ST_AGAIN;
+
+    for (int i = 0; i < ST_TABLE_OPTIMISTIC_READ_TRIES && ret == ST_AGAIN; i++) {
+        int slot = st_table_reader_enter(pool);
+        if (slot < 0) {
+            break;
+        }
+
+        ret = st_table_borrow_value_once(table, &key, value);
+
+        st_table_reader_leave(pool, slot);
     }
 
-    *key = elem->key;
-    *value = elem->value;
+    if (ret != ST_AGAIN) {
+        return ret;
+    }
 
-    st_rbtree_node_t *n = st_rbtree_get_next(&table->elements, &elem->rbnode);
-    if (n == NULL) {
-        iter->element = NULL;
-    } else {
-        iter->element = st_owner(n, st_table_element_t, rbnode);
+    // writers keep conflicting, wait for them with lock.
+    st_table_element_t *elem = NULL;
+
+    int slot = st_robustrwlock_rdlock(&table->lock);
+
+    ret = st_table_get_element(table, key, &elem);
+    if (ret == ST_OK) {
+        if (st_types_is_table(elem->value.type)) {
+            ret = ST_UNSUPPORTED;
+        } else {
+            st_table_touch_element(table, elem);
+            *value = elem->value;
+        }
     }
 
-    return ST_OK;
+    st_robustrwlock_rdunlock(&table->lock, slot);
+
+    return ret;
+}
+
+int st_table_borrow_end(st_table_borrow_t *borrow) {
+
+    st_must(borrow != NULL, ST_ARG_INVALID);
+    st_must(borrow->pool != NULL, ST_ARG_INVALID);
+
+    int ret = ST_OK;
+
+    for (int i = 0; i < borrow->pin_cnt; i++) {
+        int err = st_table_unpin(borrow->pool, borrow->pins[i]);
+        if (err != ST_OK) {
+            ret = err;
+        }
+    }
+
+    borrow->pool = NULL;
+    borrow->pin_cnt = 0;
+
+    return ret;
+}
+
+// elements detached from cleared tables and expired elements are freed by gc
+// before each step, they share the budget with sweeping.
+static int st_table_gc_pre_step(st_gc_t *gc, void *data) {
+
+    st_table_pool_t *pool = data;
+
+    int ret = st_table_free_detached(pool, gc->max_free_cnt, &gc->curr_free_cnt);
+    if (ret != ST_EMPTY) {
+        return ret;
+    }
+
+    ret = st_table_expire(pool, gc->max_free_cnt, &gc->curr_free_cnt);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    return ST_EMPTY;
 }
 
 int st_table_pool_init(st_table_pool_t *pool, int run_gc_periodical) {
 
     st_must(pool != NULL, ST_ARG_INVALID);
 
-    int ret = st_gc_init(&pool->gc);
+    int ret = st_gc_init(&pool->gc, st_table_gc_pre_step, pool);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_table_reclaim_init(&pool->reclaim);
+    if (ret != ST_OK) {
+        st_gc_destroy(&pool->gc);
+        return ret;
+    }
+
+    st_list_init(&pool->detached);
+
+    ret = st_robustlock_init(&pool->ttl_lock);
+    if (ret != ST_OK) {
+        st_table_reclaim_destroy(pool);
+        st_gc_destroy(&pool->gc);
+        return ret;
+    }
+
+    st_list_init(&pool->ttl_tables);
+
+    ret = st_robustlock_init(&pool->pin_lock);
+    if (ret != ST_OK) {
+        st_robustlock_destroy(&pool->ttl_lock);
+        st_table_reclaim_destroy(pool);
+        st_gc_destroy(&pool->gc);
+        return ret;
+    }
+
+    for (int i = 0; i < ST_TABLE_PIN_CNT; i++) {
+        st_table_pin_t *p = &pool->pins[i];
+
+        p->table = NULL;
+        memset(p->holders, 0, sizeof(p->holders));
+        p->holder_cnt = 0;
+        p->deferred = NULL;
+    }
+
+    ret = st_robustlock_init(&pool->intern.lock);
     if (ret != ST_OK) {
+        st_robustlock_destroy(&pool->pin_lock);
+        st_robustlock_destroy(&pool->ttl_lock);
+        st_table_reclaim_destroy(pool);
+        st_gc_destroy(&pool->gc);
         return ret;
     }
 
+    pool->intern.max_key_len = 0;
+    pool->intern.buckets = NULL;
+    pool->intern.capacity = 0;
+    pool->intern.cnt = 0;
+
+    pool->blob_min_len = 0;
     pool->table_cnt = 0;
     pool->run_gc_periodical = run_gc_periodical;
 
@@ -560,7 +5325,66 @@ int st_table_pool_destroy(st_table_pool_t *pool) {
         return ret;
     }
 
+    // elements kept by pins of dead processes not cleaned.
+    for (int i = 0; i < ST_TABLE_PIN_CNT; i++) {
+        ret = st_table_retire_element_list(pool, st_table_pin_free(pool, i + 1));
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    ret = st_robustlock_destroy(&pool->pin_lock);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_table_reclaim_destroy(pool);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    ret = st_robustlock_destroy(&pool->ttl_lock);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    // keys are released with their elements, all of them are retired now.
+    if (pool->intern.buckets != NULL) {
+        ret = st_slab_obj_free(&pool->slab_pool, pool->intern.buckets);
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        pool->intern.buckets = NULL;
+        pool->intern.capacity = 0;
+    }
+
+    ret = st_robustlock_destroy(&pool->intern.lock);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
     pool->table_cnt = 0;
 
     return ret;
 }
+
+int st_table_pool_set_intern(st_table_pool_t *pool, int64_t max_key_len) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(max_key_len >= 0 && max_key_len <= ST_TABLE_INTERN_MAX_KEY_LEN, ST_ARG_INVALID);
+
+    st_atomic_store(&pool->intern.max_key_len, max_key_len, __ATOMIC_RELAXED);
+
+    return ST_OK;
+}
+
+int st_table_pool_set_blob(st_table_pool_t *pool, int64_t min_len) {
+
+    st_must(pool != NULL, ST_ARG_INVALID);
+    st_must(min_len == 0 || min_len >= ST_TABLE_BLOB_MIN_LEN, ST_ARG_INVALID);
+
+    st_atomic_store(&pool->blob_min_len, min_len, __ATOMIC_RELAXED);
+
+    return ST_OK;
+}
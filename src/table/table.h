@@ -1,9 +1,12 @@
 #ifndef _TABLE_H_INCLUDED_
 #define _TABLE_H_INCLUDED_
 
+#include <endian.h>
+#include <limits.h>
 #include <stdint.h>
 #include <string.h>
 #include <time.h>
+#include <sys/types.h>
 
 #include "inc/inc.h"
 
@@ -15,46 +18,464 @@
 #include "str/str.h"
 #include "gc/gc.h"
 #include "hash/fibonacci.h"
+#include "art/art.h"
 
 typedef struct st_table_element_s st_table_element_t;
 typedef struct st_table_iter_s st_table_iter_t;
+typedef struct st_table_hash_index_s st_table_hash_index_t;
+typedef struct st_table_array_s st_table_array_t;
+typedef struct st_table_small_entry_s st_table_small_entry_t;
+typedef struct st_table_retired_s st_table_retired_t;
+typedef struct st_table_reader_slot_s st_table_reader_slot_t;
+typedef struct st_table_reclaim_s st_table_reclaim_t;
+typedef struct st_table_detached_s st_table_detached_t;
+typedef struct st_table_pin_s st_table_pin_t;
+typedef struct st_table_snapshot_s st_table_snapshot_t;
+typedef struct st_table_ttl_s st_table_ttl_t;
+typedef struct st_table_cache_tail_s st_table_cache_tail_t;
+typedef struct st_table_ttl_tail_s st_table_ttl_tail_t;
 
 typedef struct st_table_s st_table_t;
+typedef struct st_table_intern_key_s st_table_intern_key_t;
+typedef struct st_table_intern_s st_table_intern_t;
+typedef struct st_table_blob_s st_table_blob_t;
+typedef struct st_table_borrow_s st_table_borrow_t;
+typedef struct st_table_txn_op_s st_table_txn_op_t;
+typedef struct st_table_txn_lock_s st_table_txn_lock_t;
+typedef struct st_table_txn_s st_table_txn_t;
 typedef struct st_table_pool_s st_table_pool_t;
 
 #define ST_TABLE_NOT_PUSH_TO_GC 0
 #define ST_TABLE_PUSH_TO_GC 1
 
+// hash index capacity is always power of 2, and it is grown when load
+// factor exceeds 3/4, shrunk when load factor is below 1/8.
+#define ST_TABLE_HASH_INDEX_MIN_CAPACITY 16
+
+// array part capacity is always power of 2, it is doubled when an integer key
+// just after the array part is added and at least half of array part is used,
+// it is halved when less than 1/4 of it is used.
+#define ST_TABLE_ARRAY_MIN_CAPACITY 4
+
+// elements are moved from small part to rbtree when it is full. it is
+// embedded in table and sized to fit in the slab chunk of st_table_t, which
+// is otherwise wasted.
+#define ST_TABLE_SMALL_CAPACITY 8
+
+// string keys not longer than this can be interned, see st_table_pool_set_intern.
+#define ST_TABLE_INTERN_MAX_KEY_LEN 64
+
+// intern dictionary capacity is always power of 2, it is doubled when there
+// are more interned keys than buckets.
+#define ST_TABLE_INTERN_MIN_CAPACITY 64
+
+// values shorter than this are never stored in blob, see st_table_pool_set_blob.
+#define ST_TABLE_BLOB_MIN_LEN 256
+
+// table with at least so many elements is cleared by detaching all elements
+// at once, detached elements are freed later by gc step by step.
+#define ST_TABLE_DETACH_MIN_CNT 1024
+
+// elements with ttl are linked in a hashed timing wheel of so many slots, each
+// slot covers ST_TABLE_TTL_SLOT_USEC.
+#define ST_TABLE_TTL_SLOT_CNT 32
+#define ST_TABLE_TTL_SLOT_USEC (1000 * 1000)
+
+// a sharded table has at most so many shards.
+#define ST_TABLE_MAX_SHARD_CNT 64
+
+// lock free reader gives up and asks caller to lock table after so many
+// conflicts with writers.
+#define ST_TABLE_OPTIMISTIC_READ_TRIES 3
+
+// a valid rbtree of 2^63 elements is not deeper than this.
+#define ST_TABLE_OPTIMISTIC_READ_MAX_DEPTH 128
+
+// at most so many tables in pool can be pinned by snapshots and borrow guards
+// at the same time.
+#define ST_TABLE_PIN_CNT 64
+
+// snapshot collects so many elements each time it holds table lock, and it
+// holds the lock till the end after so many tries found table modified.
+#define ST_TABLE_SNAPSHOT_BATCH 256
+#define ST_TABLE_SNAPSHOT_TRIES 3
+
 struct st_table_iter_s {
     st_table_element_t *element;
     int64_t table_version;
+
+    // iterating stops at the first key not starting with prefix if prefixed
+    // is set, bytes of prefix must stay valid during iterating.
+    int prefixed;
+    st_str_t prefix;
+};
+
+// removed elements and hash index are not freed at once, because lock free
+// readers may still be visiting them, they are linked in reclaim lists until
+// all readers those could see them left.
+struct st_table_retired_s {
+    st_table_retired_t *next;
+};
+
+// lock free readers of a process register in a slot of their own, so that
+// readers of different processes do not write to one cache line. a process
+// not getting a slot reads with table locked, so that every reader in read
+// section is in a slot st_table_reader_clean can clean after it dies.
+#define ST_TABLE_READER_SLOT_CNT 64
+
+struct st_table_reader_slot_s {
+    // pid of the process owning slot, 0 if it is free.
+    pid_t pid;
+
+    // count of readers entered in even and odd epoch.
+    int64_t readers[2];
+} __attribute__((aligned(64)));
+
+// epoch based reclamation.
+//
+// a reader registers itself in readers[epoch % 2] of the slot of its process
+// before visiting table and unregisters after. object retired in epoch e is
+// freed after epoch advanced to e + 2, epoch advances only when readers
+// entered in previous epoch left.
+//
+// if a process dies between st_table_reader_enter and st_table_reader_leave,
+// epoch stops advancing until st_table_reader_clean is called with its pid,
+// so only do bounded work without any blocking call in read section.
+struct st_table_reclaim_s {
+    int64_t epoch;
+
+    st_table_retired_t *retired[3];
+
+    pthread_mutex_t lock;
+
+    // slots before it have been owned by some process.
+    int64_t slot_cnt;
+
+    st_table_reader_slot_t slots[ST_TABLE_READER_SLOT_CNT];
 };
 
 struct st_table_element_s {
+    // must be the first member, the address is used to free element.
+    //
+    // key_prefix is cached from key so that most comparisons need not touch
+    // key bytes, it is the first 8 bytes of key in big endian for string key.
+    // it shares space with retired, which is only set after element is
+    // removed from table, and a lock free reader seeing a removed element
+    // fails version validation whatever prefix it compares.
+    union {
+        st_table_retired_t retired;
+        uint64_t key_prefix;
+    };
+
     // used for table rbtree
     st_rbtree_node_t rbnode;
 
     st_str_t key;
     st_str_t value;
 
-    /* space to store key and value */
+    // low 32 bits of key hash, used by hash index, which never has 2^32 slots.
+    uint32_t key_hash;
+
+    // ST_TABLE_ELEMENT_* flags, they are not changed after element is created.
+    uint32_t flags;
+
+    /* space to store tails, key and value, key bytes are not here if key is interned */
     uint8_t kv_data[0];
 };
 
+// value bytes are in a st_table_blob_t instead of kv_data.
+#define ST_TABLE_ELEMENT_BLOB 0x01
+
+// kv_data has a st_table_cache_tail_t, after ttl tail if element has both.
+#define ST_TABLE_ELEMENT_CACHE 0x02
+
+// kv_data starts with a st_table_ttl_tail_t.
+#define ST_TABLE_ELEMENT_TTL 0x04
+
+// bookkeeping of cache mode, only elements of cache tables have it, so that
+// elements of other tables do not pay for it.
+struct st_table_cache_tail_s {
+    // elements are linked in clock list in the order they are added.
+    st_list_t lnode;
+
+    // set when element is added or its value is read, and cleared when the
+    // clock hand passes it.
+    int referenced;
+
+    // offset of the tail in element, to get element from clock list.
+    uint32_t offset;
+};
+
+// only elements set with ttl have it, element without it never expires.
+struct st_table_ttl_tail_s {
+    // expire time in usec, element is treated as removed once expired, and
+    // removed by gc later.
+    int64_t expire_at;
+
+    // linked in ttl wheel of table.
+    st_list_t lnode;
+};
+
+// open addressing(linear probing) hash index of table elements.
+// it is only used for exact match lookup, ordered operations still use rbtree.
+struct st_table_hash_index_s {
+    // must be the first member, the address is used to free index.
+    st_table_retired_t retired;
+
+    int64_t capacity;
+    int64_t used;
+
+    st_table_element_t *slots[0];
+};
+
+// array part of table, like lua table, elements with ST_TYPES_INTEGER key in
+// range [1, capacity] are stored here instead of in rbtree.
+// element with key k is in slots[k - 1].
+struct st_table_array_s {
+    // must be the first member, the address is used to free array.
+    st_table_retired_t retired;
+
+    int64_t capacity;
+
+    st_table_element_t *slots[0];
+};
+
+struct st_table_small_entry_s {
+    // copied from element, so that most comparisons need not touch element.
+    int64_t key_type;
+    uint64_t key_prefix;
+
+    st_table_element_t *element;
+};
+
+// key bytes shared by all elements with an equal interned key in pool.
+struct st_table_intern_key_s {
+    // must be the first member, it is retired instead of freed at once when
+    // the last element is removed, lock free readers may still read key bytes.
+    st_table_retired_t retired;
+
+    st_table_intern_key_t *next;
+
+    uint64_t hash;
+    int64_t refcnt;
+    int64_t len;
+
+    // key bytes terminated with 0.
+    uint8_t bytes[0];
+};
+
+// chained hash table of interned keys, all of it is protected by lock.
+struct st_table_intern_s {
+    // string keys not longer than it are interned, 0 if interning is disabled.
+    int64_t max_key_len;
+
+    // allocated when the first key is interned, NULL before that.
+    st_table_intern_key_t **buckets;
+    int64_t capacity;
+    int64_t cnt;
+
+    pthread_mutex_t lock;
+};
+
+// value bytes stored out of element, it is shared by elements whose value is
+// copied by st_table_copy_value, in any table of pool.
+struct st_table_blob_s {
+    // must be the first member, it is retired when the last element is removed.
+    st_table_retired_t retired;
+
+    int64_t refcnt;
+
+    uint8_t bytes[0];
+};
+
+// elements detached from a cleared table, no table references them any more.
+// they are linked in pool and freed by gc in bounded steps.
+struct st_table_detached_s {
+    st_list_t lnode;
+
+    // rbtree of detached elements, its leaves still point to the sentinel of
+    // the cleared table, the sentinel is only compared and never accessed.
+    st_rbtree_node_t *root;
+    st_rbtree_node_t *sentinel;
+
+    // array part, elements in slots[0, array_left) are not freed yet.
+    st_table_array_t *array;
+    int64_t array_left;
+
+    // nodes of prefix index not freed yet, see st_art_detach. the index of
+    // the cleared table is left empty.
+    void *prefix_nodes;
+
+    // pin of the cleared table when it is cleared, see st_table_s.pin.
+    int pin;
+};
+
+// hashed timing wheel of elements with ttl, element expiring in slot time t,
+// which is expire_at / ST_TABLE_TTL_SLOT_USEC, is in slots[t % ST_TABLE_TTL_SLOT_CNT].
+struct st_table_ttl_s {
+    // linked in ttl_tables of pool.
+    st_list_t lnode;
+
+    st_table_t *table;
+
+    // slots before slot time next_slot are processed.
+    int64_t next_slot;
+
+    // elements of slot next_slot checked in this round but not expired yet,
+    // they are put back to the slot after all elements of it are checked, so
+    // that a slot processed in several gc steps does not check them again.
+    st_list_t checked;
+
+    st_list_t slots[ST_TABLE_TTL_SLOT_CNT];
+};
+
+// a pinned table replaces elements instead of modifying them in place, and
+// elements removed from it are kept in deferred instead of being retired,
+// until the last holder releases the pin. so elements seen by holders stay
+// unchanged without holding back freeing in other tables.
+struct st_table_pin_s {
+    // the pinned table, NULL if pin is free or the table has been freed.
+    st_table_t *table;
+
+    // count of holders in each process, indexed by reader slot of process,
+    // so that holders of a dead process are released by st_table_reader_clean.
+    int32_t holders[ST_TABLE_READER_SLOT_CNT];
+    int64_t holder_cnt;
+
+    st_table_retired_t *deferred;
+};
+
+// consistent view of a table, it is local to the process taking it.
+// elements in snapshot are never modified or freed until it is destroyed.
+struct st_table_snapshot_s {
+    st_table_pool_t *pool;
+
+    // pin of the table, shards are pinned with it.
+    int pin;
+
+    // elements in table order, allocated by st_malloc.
+    st_table_element_t **elements;
+    int64_t cnt;
+    int64_t next;
+};
+
+// read guard of values borrowed from tables of a pool, bytes of borrowed
+// values are read in place, they are never modified or freed until the guard
+// is released. like a snapshot, it pins every table it borrows from, other
+// tables are not affected.
+struct st_table_borrow_s {
+    st_table_pool_t *pool;
+
+    // pins taken at the first borrowing from each table.
+    int pins[ST_TABLE_PIN_CNT];
+    int pin_cnt;
+};
+
+// a mutation buffered in transaction.
+struct st_table_txn_op_s {
+    // the shard holding key if table is sharded.
+    st_table_t *table;
+
+    // new element to set, it is NULL to remove key.
+    st_table_element_t *elem;
+
+    // copy of key to remove, allocated by st_malloc.
+    st_str_t key;
+
+    // element replaced or removed by the mutation, set when it is applied.
+    st_table_element_t *replaced;
+
+    // set if a later mutation of the same key is in transaction, only the
+    // last mutation of a key is applied.
+    int skipped;
+};
+
+// a table locked by committing transaction.
+struct st_table_txn_lock_s {
+    st_table_t *table;
+    int64_t version;
+    int modified;
+};
+
+// mutations of tables in one pool applied at once, nobody sees some of them
+// applied but not the others. elements to set are allocated when a mutation
+// is added, and nothing is locked until commit.
+struct st_table_txn_s {
+    st_table_pool_t *pool;
+
+    // allocated by st_malloc, mutations are applied in the order they are added.
+    st_table_txn_op_t *ops;
+    int64_t cnt;
+    int64_t capacity;
+};
+
 struct st_table_s {
     // used for gc
     st_gc_head_t gc_head;
 
     st_table_pool_t *pool;
 
-    // all table elements are stored in rbtree
+    // table elements those are not in array part are stored in rbtree. nodes
+    // are embedded in elements and never move, lock free readers, detaching
+    // on clear and the prefix index rely on it, so it is not a B+tree.
     st_rbtree_t elements;
 
+    // small part, elements not in array part of a small table are kept in a
+    // sorted array instead of rbtree, a lookup is a binary search over a few
+    // cache lines and touches only the element it ends at. table switches to
+    // rbtree once small part is full, and switches back after rbtree becomes
+    // empty. small_cnt is -1 if rbtree is used.
+    int64_t small_cnt;
+    st_table_small_entry_t small[ST_TABLE_SMALL_CAPACITY];
+
+    // array part of elements with dense integer keys, NULL if it is empty.
+    st_table_array_t *array;
+    int64_t array_cnt;
+
+    // optional hash index of elements, NULL if it is not enabled.
+    st_table_hash_index_t *hash_index;
+
+    // optional adaptive radix tree of elements with string key, NULL if it is
+    // not enabled.
+    st_art_t *prefix_index;
+
     int64_t element_cnt;
+
+    // count of elements whose value is a table.
+    int64_t table_value_cnt;
+
+    // slab bytes used by elements.
+    int64_t used_bytes;
+
+    // cache mode, elements are evicted if element_cnt or used_bytes exceeds
+    // the limit after adding, 0 means no limit.
+    int cache;
+    int64_t max_element_cnt;
+    int64_t max_bytes;
+
+    // clock list of elements having cache tail, the first one is at clock hand.
+    st_list_t clock;
+
+    // allocated when the first element with ttl is set, NULL before that.
+    st_table_ttl_t *ttl;
+
+    // shards of a sharded table, keys are distributed to them by hash, and
+    // each of them is a table with its own lock. a sharded table itself has
+    // no element. NULL if table is not sharded.
+    st_table_t **shards;
+    int64_t shard_cnt;
+
+    // version is odd while table is being modified, lock free readers use it
+    // as a sequence lock.
     int64_t version;
 
-    // the lock protect elements rbtree
-    pthread_mutex_t lock;
+    // the lock protect elements rbtree, readers use st_robustrwlock_rdlock,
+    // modifications use st_robustrwlock_wrlock.
+    st_robustrwlock_t lock;
+
+    // index + 1 of the pin in pins of pool while table is pinned, 0 if not.
+    // shards of a sharded table are pinned together with it.
+    int pin;
 
     int inited;
 };
@@ -64,6 +485,26 @@ struct st_table_pool_s {
 
     st_gc_t gc;
 
+    st_table_reclaim_t reclaim;
+
+    // list of st_table_detached_t, protected by gc lock.
+    st_list_t detached;
+
+    // pins of tables, pin_lock is locked after all other locks but intern.
+    pthread_mutex_t pin_lock;
+    st_table_pin_t pins[ST_TABLE_PIN_CNT];
+
+    // ttl wheels of tables, it is locked after gc lock and before table lock.
+    st_list_t ttl_tables;
+    pthread_mutex_t ttl_lock;
+
+    // dictionary of keys shared by elements of all tables in pool, it is
+    // locked after all other locks of pool and tables.
+    st_table_intern_t intern;
+
+    // values not shorter than it are stored in blobs, 0 if it is disabled.
+    int64_t blob_min_len;
+
     int run_gc_periodical;
 
     // current tables cnt
@@ -78,25 +519,180 @@ int st_table_new(st_table_pool_t *pool, st_table_t **table);
 
 int st_table_free(st_table_t *table);
 
+// create a table whose keys are split into shard_cnt shards, writers to
+// different shards do not block each other. all st_table_* functions work on
+// it as on a normal table, except st_table_get_version and
+// st_table_set_if_version, which return ST_UNSUPPORTED.
+//
+// cache limits are divided equally among shards, and set_many locks every
+// shard once for the keys in it.
+int st_table_new_sharded(st_table_pool_t *pool, int64_t shard_cnt, st_table_t **table);
+
+// return the shard holding key in a sharded table, or table itself if it is
+// not sharded. lock it instead of table before st_table_get_value.
+st_table_t *st_table_shard_of(st_table_t *table, st_str_t key);
+
+// read lock table, or all shards of a sharded table in order, for iterating
+// it. slots must have room for ST_TABLE_MAX_SHARD_CNT reader slots.
+void st_table_rdlock_all(st_table_t *table, int *slots);
+
+void st_table_rdunlock_all(st_table_t *table, int *slots);
+
 // this function is only used for gc, other one please use st_table_clear.
 int st_table_remove_all_for_gc(st_table_t *table);
 
+// remove all elements, if table has at least ST_TABLE_DETACH_MIN_CNT elements
+// and none of them is a table, elements and nodes of prefix index are
+// detached in O(1) and freed by gc.
 int st_table_remove_all(st_table_t *table);
 
+// free elements detached from cleared tables, until the count of visited
+// elements, tree nodes and prefix index nodes reaches max_cnt.
+// return ST_EMPTY if all detached elements are freed.
+// it is only used for gc, lock gc before use the function.
+int st_table_free_detached(st_table_pool_t *pool, int max_cnt, int *visited_cnt);
+
+// enable cache mode of table, or change limits of it. in cache mode, if adding
+// makes element count exceed max_element_cnt or slab bytes used by elements
+// exceed max_bytes, cold elements are evicted with CLOCK algorithm: elements
+// not read since the clock hand passed them last time are evicted first.
+// 0 means no limit, cache mode can not be disabled once enabled.
+//
+// tables referenced by evicted elements are pushed to gc, bytes of elements in
+// them are not counted in max_bytes of this table.
+//
+// elements existed before cache mode is enabled are copied with cache
+// bookkeeping, cache mode is not enabled if it fails to allocate the copies.
+int st_table_set_cache_limit(st_table_t *table, int64_t max_element_cnt, int64_t max_bytes);
+
+// set key value which expires after ttl_usec. expired element is treated as
+// not in table by all operations and is removed by gc step by step, but it is
+// counted in element_cnt of table until it is removed.
+// set the key again by other functions removes ttl of it.
+//
+// table value can not have ttl.
+int st_table_set_key_value_ex(st_table_t *table, st_str_t key, st_str_t value,
+                              int64_t ttl_usec);
+
+// remove expired elements of tables in pool, until the count of visited
+// elements reaches max_cnt.
+// it is only used for gc, lock gc before use the function.
+int st_table_expire(st_table_pool_t *pool, int max_cnt, int *visited_cnt);
+
+// build a hash index for all elements in table, after that exact match
+// lookup in st_table_get_value is O(1). the index is kept in sync by all
+// table modifications and is freed with the table.
+int st_table_enable_hash_index(st_table_t *table);
+
+// build a prefix index(adaptive radix tree) for elements with string key,
+// after that locked lookup of string key is O(key length), and
+// st_table_iter_init_prefix finds the first key with a prefix without
+// comparing whole keys. the index is kept in sync by all table modifications
+// and is freed with the table.
+int st_table_enable_prefix_index(st_table_t *table);
+
 int st_table_add_key_value(st_table_t *table, st_str_t key, st_str_t value);
 
 int st_table_set_key_value(st_table_t *table, st_str_t key, st_str_t value);
 
+// set cnt keys and values with table locked only once, elements are allocated
+// before locking and replaced elements are freed after unlocking.
+// if a later key is the same as a former one, the later value is set.
+//
+// it is not atomic: if it fails in the middle, keys before the failed one
+// are set. keys of a sharded table are grouped by shard in their order, and
+// set shard by shard, so keys in shards before the failed one are set.
+int st_table_set_many(st_table_t *table, st_str_t *keys, st_str_t *values, int64_t cnt);
+
+// transaction, it is used like:
+//
+//     st_table_txn_init(pool, &txn);
+//     st_table_txn_set(&txn, t1, key1, value1);
+//     st_table_txn_remove(&txn, t2, key2);
+//     ret = st_table_txn_commit(&txn);
+//     st_table_txn_destroy(&txn);
+//
+// commit locks gc and then all tables in the order of their addresses, so
+// that transactions never deadlock with each other or with other writers.
+// removing an absent key does nothing.
+//
+// commit is atomic: keys to set are applied before keys to remove, only
+// setting may fail, and sets applied are undone if any of them fails, so
+// that either all mutations are applied or none is.
+int st_table_txn_init(st_table_pool_t *pool, st_table_txn_t *txn);
+
+int st_table_txn_set(st_table_txn_t *txn, st_table_t *table, st_str_t key, st_str_t value);
+
+int st_table_txn_remove(st_table_txn_t *txn, st_table_t *table, st_str_t key);
+
+// mutations are consumed by commit, txn can be used for more after it.
+int st_table_txn_commit(st_table_txn_t *txn);
+
+// discard mutations not committed and free txn.
+int st_table_txn_destroy(st_table_txn_t *txn);
+
+// set value of key only if current value of key is the same as expected,
+// value type and bytes are compared. if expected.bytes is NULL, key must not be
+// in table.
+// return ST_NOT_EQUAL if current value is not expected.
+int st_table_cas(st_table_t *table, st_str_t key, st_str_t expected, st_str_t value);
+
+// set value of key only if table is not modified since st_table_get_version
+// returned the version, any change to any key of table modifies the version.
+// return ST_TABLE_MODIFIED if table version is not the version.
+int st_table_set_if_version(st_table_t *table, st_str_t key, st_str_t value,
+                            int64_t version);
+
+// return current version of table, or error if it is less than 0.
+int64_t st_table_get_version(st_table_t *table);
+
+// add delta to the value of key in place and store the result in new_value if
+// it is not NULL. delta type must be ST_TYPES_INTEGER, ST_TYPES_U64 or
+// ST_TYPES_NUMBER, and new_value must point to a number of the same type.
+// if key is not in table, it is added with delta as value.
+//
+// return ST_STATE_INVALID if existed value is not of the same type as delta,
+// ST_NUM_OVERFLOW if ST_TYPES_INTEGER value overflows, ST_TYPES_U64 value
+// wraps around.
+int st_table_incr(st_table_t *table, st_str_t key, st_str_t delta, void *new_value);
+
 int st_table_remove_key(st_table_t *table, st_str_t key);
 
+// set value of src_key in src to dst_key in dst, both tables must be in the
+// same pool. value in blob is shared by both elements instead of copied.
+// return ST_UNSUPPORTED if value is a table.
+int st_table_copy_value(st_table_t *dst, st_str_t dst_key, st_table_t *src, st_str_t src_key);
+
 // you can find value in table.
 // the function is no locked, because user will copy or do other thing in his code
-// so lock the table first.
+// so lock the table first, or the shard of key by st_table_shard_of.
 int st_table_get_value(st_table_t *table, st_str_t key, st_str_t *value);
 
+// copy value of the key without locking table, value.bytes is allocated by
+// st_malloc and caller should free it.
+//
+// return ST_AGAIN if it conflicts with writers too many times, the process has
+// no reader slot, or the value is a table which must be referenced by caller
+// with table locked, caller should lock table and use st_table_get_value
+// instead.
+int st_table_get_value_copy(st_table_t *table, st_str_t key, st_str_t *value);
+
+// mark the beginning of a lock free read section, objects visible in read
+// section will not be freed until st_table_reader_leave is called.
+// return value must be passed to st_table_reader_leave.
+// return ST_AGAIN if all reader slots are owned by other processes, then read
+// with table locked.
+int st_table_reader_enter(st_table_pool_t *pool);
+
+void st_table_reader_leave(st_table_pool_t *pool, int slot);
+
+// clear the reader slot and release pins held by a dead process, so that
+// objects it could see are freed. pid must not be a live process reading pool.
+int st_table_reader_clean(st_table_pool_t *pool, pid_t pid);
+
 // you can find next value in table, it will be used for iterating table.
 // the function is no locked, because user will copy or do other thing in his code
-// so lock the table first.
+// so lock the table first by st_table_rdlock_all.
 //
 // if init_key is NULL then iterating from left-most in rbtree.
 int st_table_iter_init(st_table_t *table,
@@ -104,13 +700,64 @@ int st_table_iter_init(st_table_t *table,
                        st_str_t *init_key,
                        int expected_side);
 
+// iterate string keys starting with prefix in key order, it works without
+// prefix index too, but then the first key is searched in rbtree.
+// lock table first by st_table_rdlock_all.
+int st_table_iter_init_prefix(st_table_t *table, st_table_iter_t *iter, st_str_t *prefix);
+
 // you can lock whole iterate, to avoid table change in iterate runtime.
 // or you must lock st_table_iter_next, that not guarantee iterate table correctness.
 int st_table_iter_next(st_table_t *table, st_table_iter_t *iter, st_str_t *key,
                        st_str_t *value);
 
+// take a snapshot of table, then it is iterated by st_table_snapshot_next
+// without any lock. table is pinned by snapshot, and element addresses are
+// collected in batches with table read locked, writers go on between
+// batches. collecting starts over if table is modified, and the last try
+// holds the lock till the end.
+//
+// elements removed or replaced after the snapshot is taken are not freed
+// until it is destroyed, that holds only for the table. if the process dies
+// with a snapshot, the pin is released by st_table_reader_clean with its pid.
+// return ST_AGAIN if too many tables are pinned, or the process has no reader
+// slot.
+//
+// table value got from snapshot is only the address of the table when snapshot
+// is taken, lock the table holding it before visiting it.
+int st_table_snapshot_init(st_table_t *table, st_table_snapshot_t *snapshot);
+
+// return ST_ITER_FINISH if all elements in snapshot are iterated.
+int st_table_snapshot_next(st_table_snapshot_t *snapshot, st_str_t *key, st_str_t *value);
+
+int st_table_snapshot_destroy(st_table_snapshot_t *snapshot);
+
+int st_table_borrow_begin(st_table_pool_t *pool, st_table_borrow_t *borrow);
+
+// get value without copying, table need not be locked. value bytes point
+// into shared memory and stay valid until st_table_borrow_end.
+// table is pinned by the guard at the first borrowing from it, if the process
+// dies with the guard, the pin is released by st_table_reader_clean with its
+// pid. return ST_AGAIN if too many tables are pinned, or the process has no
+// reader slot.
+// return ST_UNSUPPORTED if value is a table, use st_table_get_value for it.
+int st_table_borrow_value(st_table_borrow_t *borrow, st_table_t *table, st_str_t key,
+                          st_str_t *value);
+
+int st_table_borrow_end(st_table_borrow_t *borrow);
+
 int st_table_pool_init(st_table_pool_t *pool, int run_gc_periodical);
 
 int st_table_pool_destroy(st_table_pool_t *pool);
 
+// intern string keys not longer than max_key_len of elements added from now
+// on, elements with equal keys in all tables of pool share one copy of key
+// bytes, and equal interned keys are compared by address. 0 disables it,
+// keys interned before are kept until their elements are removed.
+int st_table_pool_set_intern(st_table_pool_t *pool, int64_t max_key_len);
+
+// store values not shorter than min_len of elements added from now on in
+// separate blobs, so that st_table_copy_value shares them instead of copying.
+// min_len is 0 to disable it or at least ST_TABLE_BLOB_MIN_LEN.
+int st_table_pool_set_blob(st_table_pool_t *pool, int64_t min_len);
+
 #endif /* _TABLE_H_INCLUDED_ */
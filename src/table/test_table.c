@@ -47,12 +47,20 @@ static ssize_t get_alloc_cnt_in_slab(st_table_pool_t *pool, uint64_t size) {
     return pool->slab_pool.groups[idx].stat.current.alloc.cnt;
 }
 
+// tables may be in the same slab chunk size as elements, count them by pool.
 static ssize_t remain_table_cnt(st_table_pool_t *pool) {
-    return get_alloc_cnt_in_slab(pool, sizeof(st_table_t));
+    return pool->table_cnt;
 }
 
 static ssize_t remain_element_cnt(st_table_pool_t *pool, uint64_t element_size) {
-    return get_alloc_cnt_in_slab(pool, element_size);
+
+    ssize_t cnt = get_alloc_cnt_in_slab(pool, element_size);
+
+    if (_slab_size_to_index(element_size) == _slab_size_to_index(sizeof(st_table_t))) {
+        cnt -= remain_table_cnt(pool);
+    }
+
+    return cnt;
 }
 
 static st_table_pool_t *alloc_table_pool(int* shm_fd) {
@@ -338,6 +346,108 @@ st_test(table, remove_all) {
     free_table_pool(table_pool, shm_fd);
 }
 
+st_test(table, remove_all_detach) {
+
+    st_table_t *t;
+    st_table_t *sub;
+    st_str_t key;
+    st_str_t value;
+    st_str_t found;
+    int value_buf[40] = {0};
+    int shm_fd;
+    int ret;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+    int cnt = ST_TABLE_DETACH_MIN_CNT * 2;
+
+    st_table_new(table_pool, &t);
+
+    // half of keys are in array part, the other half are in rbtree.
+    for (int i = 1; i <= cnt; i++) {
+        if (i <= cnt / 2) {
+            key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        } else {
+            key = (st_str_t)st_str_wrap(&i, sizeof(i));
+        }
+
+        value_buf[0] = i;
+        value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    st_ut_eq(ST_OK, st_table_enable_hash_index(t), "");
+    st_ut_eq(ST_OK, st_table_enable_prefix_index(t), "");
+    st_ut_eq(cnt / 2, t->array_cnt, "");
+    st_ut_eq(cnt, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+
+    // nodes of prefix index are detached with elements.
+    st_table_detached_t *detached = st_list_first_entry(&table_pool->detached,
+                                                        st_table_detached_t, lnode);
+    st_ut_ne(NULL, detached->prefix_nodes, "");
+    st_ut_eq(1, st_art_is_empty(t->prefix_index), "");
+
+    // elements are detached, but not freed yet.
+    st_ut_eq(0, t->element_cnt, "");
+    st_ut_eq(0, t->array_cnt, "");
+    st_ut_eq(0, t->hash_index->used, "");
+    st_ut_eq(1, st_rbtree_is_empty(&t->elements), "");
+    st_ut_eq(cnt, remain_element_cnt(table_pool, element_size), "");
+
+    for (int i = 1; i <= cnt; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+
+        key = (st_str_t)st_str_wrap(&i, sizeof(i));
+        st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+    }
+
+    // table is still usable while elements are freed by gc.
+    int k = 1;
+    key = (st_str_t)st_str_wrap(&k, sizeof(k));
+    value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+
+    // each gc step frees no more than max_free_cnt elements.
+    int steps = 0;
+    do {
+        ret = st_gc_run(&table_pool->gc);
+        st_ut_true(ret == ST_OK || ret == ST_NO_GC_DATA, "");
+        steps++;
+    } while (ret != ST_NO_GC_DATA);
+
+    st_ut_gt(steps, cnt / table_pool->gc.max_free_cnt, "");
+    st_ut_eq(1, remain_element_cnt(table_pool, element_size), "");
+    st_ut_eq(1, st_list_empty(&table_pool->detached), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    // table with table value is cleared at once.
+    st_table_new(table_pool, &sub);
+
+    for (int i = 1; i <= cnt; i++) {
+        key = (st_str_t)st_str_wrap(&i, sizeof(i));
+        value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    key = (st_str_t)st_str_wrap_common("sub", ST_TYPES_STRING, 3);
+    value = (st_str_t)st_str_wrap_common(&sub, ST_TYPES_TABLE, sizeof(sub));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(0, t->element_cnt, "");
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+    st_ut_eq(1, st_list_empty(&table_pool->detached), "");
+
+    st_table_free(t);
+    free_table_pool(table_pool, shm_fd);
+}
+
 st_test(table, remove_key) {
 
     st_table_t *t;
@@ -386,239 +496,2320 @@ st_test(table, remove_key) {
     free_table_pool(table_pool, shm_fd);
 }
 
-st_test(table, iter_next_key_value) {
+st_test(table, hash_index) {
 
-    int i;
     st_table_t *t;
+    st_str_t found;
     int value_buf[40] = {0};
     int shm_fd;
 
     st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
-    st_list_t all = ST_LIST_INIT(all);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
 
     st_table_new(table_pool, &t);
 
-    for (i = 0; i < 100; i++) {
+    for (int i = 0; i < 50; i++) {
         st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
 
         value_buf[0] = i;
         st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
 
-        st_table_add_key_value(t, key, value);
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
     }
 
-    st_str_t k;
-    st_str_t v1;
-    st_str_t v2;
-    st_table_iter_t iter;
-
-    int sides[] = { ST_SIDE_LEFT_EQ, ST_SIDE_RIGHT_EQ };
-    for (int cnt = 0; cnt < st_nelts(sides); cnt++) {
-        int null_index     = -1;
-        int boundary_index = 100;
-        int boundary_value = 99;
-
-        if (sides[cnt] == ST_SIDE_RIGHT_EQ) {
-            null_index     = 100;
-            boundary_index = -1;
-            boundary_value = 0;
-        }
+    st_ut_eq(ST_OK, st_table_enable_hash_index(t), "");
+    st_ut_eq(ST_EXISTED, st_table_enable_hash_index(t), "");
+    st_ut_eq(50, t->hash_index->used, "");
+    st_ut_eq(128, t->hash_index->capacity, "");
 
-        for (int i = -1; i < 101; i++) {
-            st_str_t init_key = st_str_wrap_common(&i,
-                                                   ST_TYPES_INTEGER,
-                                                   sizeof(i));
+    for (int i = 50; i < 1000; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
 
-            int ret = st_table_iter_init(t, &iter, &init_key, sides[cnt]);
-            st_ut_eq(ST_OK, ret, "failed to init iterator with init_key");
-            if (i == null_index) {
-                st_ut_eq(NULL, iter.element, "init_key le failed");
-            }
-            else {
-                int value = *(int *)(iter.element->value.bytes);
+        value_buf[0] = i;
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
 
-                if (i == boundary_index) {
-                    st_ut_eq(boundary_value, value, "failed to init iter");
-                }
-                else {
-                    st_ut_eq(i, value, "failed to init iter");
-                }
-            }
-        }
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+        st_ut_eq(ST_EXISTED, st_table_add_key_value(t, key, value), "");
     }
 
-    st_table_iter_init(t, &iter, NULL, 0);
-
-    for (i = 0; i < 100; i++) {
-        st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &k, &v1), "");
+    st_ut_eq(1000, t->hash_index->used, "");
+    st_ut_eq(2048, t->hash_index->capacity, "");
 
+    for (int i = 0; i < 1000; i++) {
         st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
-        st_ut_eq(ST_OK, st_table_get_value(t, key, &v2), "");
-
-        st_ut_eq(0, st_str_cmp(&k, &key), "");
-        st_ut_eq(0, st_str_cmp(&v1, &v2), "");
-    }
-
-    st_ut_eq(ST_ITER_FINISH, st_table_iter_next(t, &iter, &k, &v1), "");
-
-    st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
-    value_buf[0] = 100;
-    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
-    st_ut_eq(0, st_table_add_key_value(t, key, value), "");
-
-    st_ut_eq(ST_TABLE_MODIFIED, st_table_iter_next(t, &iter, &k, &v1), "");
-
-    st_table_remove_all(t);
-    st_table_free(t);
-    free_table_pool(table_pool, shm_fd);
-}
-
-void add_sub_table(st_table_t *table, char *name, st_table_t *sub) {
 
-    char key_buf[11] = {0};
-    int value_buf[40] = {0};
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i, *(int *)found.bytes, "");
 
-    memcpy(key_buf, name, strlen(name));
-    st_str_t key = st_str_wrap(key_buf, strlen(key_buf));
+        value_buf[0] = i + 1000;
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
 
-    memcpy(value_buf, &sub, (size_t)sizeof(sub));
-    st_str_t value = st_str_wrap_common(value_buf, ST_TYPES_TABLE, sizeof(value_buf));
+        st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i + 1000, *(int *)found.bytes, "");
+    }
 
-    st_assert(st_table_add_key_value(table, key, value) == ST_OK);
-}
+    st_ut_eq(1000, remain_element_cnt(table_pool, element_size), "");
 
-st_test(table, add_remove_table) {
+    // string keys and integer keys with the same bytes are different keys.
+    int k = 1;
+    st_str_t skey = st_str_wrap(&k, sizeof(k));
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, skey, &found), "");
 
-    st_table_t *root, *table, *t;
-    char key_buf[11] = {0};
-    int value_buf[40] = {0};
-    int shm_fd;
+    for (int i = 0; i < 1000; i += 2) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
 
-    int element_size = sizeof(st_table_element_t) + sizeof(key_buf) + sizeof(value_buf);
-    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+        st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+        st_ut_eq(ST_NOT_FOUND, st_table_remove_key(t, key), "");
+    }
 
-    st_table_new(table_pool, &root);
-    st_ut_eq(st_gc_add_root(&table_pool->gc, &root->gc_head), ST_OK, "");
+    st_ut_eq(500, t->hash_index->used, "");
+    st_ut_eq(500, t->element_cnt, "");
 
-    st_table_new(table_pool, &table);
-    add_sub_table(root, "test_table", table);
+    for (int i = 0; i < 1000; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
 
-    st_ut_eq(2, remain_table_cnt(table_pool), "");
-    st_ut_eq(1, remain_element_cnt(table_pool, element_size), "");
+        if (i % 2 == 0) {
+            st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+        } else {
+            st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+            st_ut_eq(i + 1000, *(int *)found.bytes, "");
+        }
+    }
 
-    for (int i = 0; i < 100; i++) {
-        sprintf(key_buf, "%010d", i);
-        st_table_new(table_pool, &t);
-        add_sub_table(table, key_buf, t);
+    // index is shrunk after most of elements removed.
+    for (int i = 1; i < 1000; i += 2) {
+        if (i % 100 == 1) {
+            continue;
+        }
 
-        st_ut_eq(i + 3, remain_table_cnt(table_pool), "");
-        st_ut_eq(i + 2, remain_element_cnt(table_pool, element_size), "");
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
     }
 
-    for (int i = 0; i < 100; i++) {
-        sprintf(key_buf, "%010d", i);
-        st_str_t key = st_str_wrap(key_buf, strlen(key_buf));
-        st_ut_eq(ST_OK, st_table_remove_key(table, key), "");
+    st_ut_eq(10, t->hash_index->used, "");
+    st_ut_eq(64, t->hash_index->capacity, "");
 
-        run_gc_one_round(&table_pool->gc);
-        run_gc_one_round(&table_pool->gc);
+    for (int i = 1; i < 1000; i += 100) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
 
-        st_ut_eq(101 - i, remain_table_cnt(table_pool), "");
-        st_ut_eq(100 - i, remain_element_cnt(table_pool, element_size), "");
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i + 1000, *(int *)found.bytes, "");
     }
 
-    st_ut_eq(ST_OK, st_table_remove_all(root), "");
-    run_gc_one_round(&table_pool->gc);
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(0, t->hash_index->used, "");
 
-    st_ut_eq(ST_OK, st_gc_remove_root(&table_pool->gc, &root->gc_head, 0), "");
-    st_ut_eq(ST_OK, st_table_free(root), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
 
     st_ut_eq(0, remain_table_cnt(table_pool), "");
     st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+    st_ut_eq(0, get_alloc_cnt_in_slab(table_pool, sizeof(st_table_hash_index_t) + 64 * 8), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_enable_hash_index(NULL), "");
 
     free_table_pool(table_pool, shm_fd);
 }
 
-int block_all_children(int sem_id) {
-    union semun sem_args;
-    sem_args.val = 0;
+static void add_path_keys(st_table_t *t, const char *dir, int from, int to, int v) {
 
-    int ret = semctl(sem_id, 0, SETVAL, sem_args);
-    if (ret == -1) {
-        return ST_ERR;
-    }
+    char buf[64];
 
-    return ST_OK;
-}
+    for (int i = from; i < to; i++) {
+        snprintf(buf, sizeof(buf), "%s%04d", dir, i);
 
-int wakeup_all_children(int sem_id, int children_cnt) {
-    struct sembuf sem = {.sem_num = 0, .sem_op = children_cnt, .sem_flg = SEM_UNDO};
+        st_str_t key = st_str_wrap(buf, strlen(buf));
+        st_str_t value = st_str_wrap_common(&v, ST_TYPES_INTEGER, sizeof(v));
 
-    int ret = semop(sem_id, &sem, 1);
-    if (ret == -1) {
-        return ST_ERR;
+        st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
     }
-
-    return ST_OK;
 }
 
-int wait_sem(int sem_id) {
-    struct sembuf sem = {.sem_num = 0, .sem_op = -1, .sem_flg = SEM_UNDO};
+// iterate keys with prefix, check they are in order, return the count.
+static int64_t count_prefix(st_table_t *t, const char *prefix) {
 
-    int ret = semop(sem_id, &sem, 1);
-    if (ret == -1) {
-        return ST_ERR;
-    }
+    st_table_iter_t iter;
+    st_str_t k;
+    st_str_t v;
+    st_str_t last = st_str_null;
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+    int64_t cnt = 0;
 
-    return ST_OK;
-}
+    st_str_t p = st_str_wrap(prefix, strlen(prefix));
 
-static int run_processes(int sem_id, process_f func, void *arg, int *pids,
-                         int process_cnt) {
+    st_table_rdlock_all(t, slots);
 
-    int child;
+    st_ut_eq(ST_OK, st_table_iter_init_prefix(t, &iter, &p), "");
 
-    int ret = block_all_children(sem_id);
-    if (ret == ST_ERR) {
-        return ret;
+    while (st_table_iter_next(t, &iter, &k, &v) == ST_OK) {
+        st_ut_eq(ST_TYPES_STRING, k.type, "");
+        st_ut_eq(0, memcmp(k.bytes, prefix, strlen(prefix)), "");
+
+        if (cnt > 0) {
+            st_ut_eq(1, st_str_cmp(&k, &last), "keys not in order");
+        }
+
+        last = k;
+        cnt++;
     }
 
-    for (int i = 0; i < process_cnt; i++) {
+    st_table_rdunlock_all(t, slots);
 
-        child = fork();
+    return cnt;
+}
 
-        if (child == 0) {
+st_test(table, prefix_index) {
 
-            set_process_to_cpu(i);
+    st_table_t *t;
+    st_str_t found;
+    int shm_fd;
 
-            ret = wait_sem(sem_id);
-            if (ret == ST_ERR) {
-                exit(ret);
-            }
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
 
-            ret = func(i, arg);
-            exit(ret);
-        }
+    st_table_new(table_pool, &t);
 
-        pids[i] = child;
+    // integer keys are not in prefix index.
+    for (int i = 1; i <= 10; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, key), "");
     }
 
-    sleep(2);
-
-    ret = wakeup_all_children(sem_id, process_cnt);
-    if (ret != ST_OK) {
-        return ret;
+    add_path_keys(t, "/bucket/foo/", 0, 600, 0);
+    add_path_keys(t, "/bucket/bar/", 0, 100, 0);
+
+    // iterating with prefix works without prefix index too.
+    st_ut_eq(600, count_prefix(t, "/bucket/foo/"), "");
+
+    st_ut_eq(ST_OK, st_table_enable_prefix_index(t), "");
+    st_ut_eq(ST_EXISTED, st_table_enable_prefix_index(t), "");
+    st_ut_eq(700, t->prefix_index->cnt, "");
+
+    add_path_keys(t, "/bucket/foo/", 600, 1200, 0);
+    add_path_keys(t, "/bucket/foo", 0, 1, 0);
+
+    st_ut_eq(1301, t->prefix_index->cnt, "");
+
+    struct {
+        const char *prefix;
+        int64_t cnt;
+    } cases[] = {
+        {"/bucket/foo/", 1200},
+        {"/bucket/foo", 1201},
+        {"/bucket/foo/00", 100},
+        {"/bucket/foo/1199", 1},
+        {"/bucket/bar/", 100},
+        {"/bucket/", 1301},
+        {"", 1301},
+        {"/bucket/baz", 0},
+        {"/bucket/foo/1200", 0},
+    };
+
+    for (int i = 0; i < st_nelts(cases); i++) {
+        st_ut_eq(cases[i].cnt, count_prefix(t, cases[i].prefix), "%s", cases[i].prefix);
     }
 
-    return wait_children(pids, process_cnt);
-}
+    // replaced element is replaced in index too.
+    add_path_keys(t, "/bucket/foo/", 0, 10, 1);
 
-static int new_tables(int process_id, st_table_t *root) {
+    st_str_t key = st_str_const("/bucket/foo/0005");
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(1, *(int *)found.bytes, "");
 
-    int ret;
-    st_table_t *t;
-    char key_buf[11] = {0};
-    st_table_pool_t *table_pool = root->pool;
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+    st_ut_eq(1300, t->prefix_index->cnt, "");
+    st_ut_eq(99, count_prefix(t, "/bucket/foo/00"), "");
+
+    st_str_t prefix = st_str_wrap_common(&cases[0].cnt, ST_TYPES_INTEGER, sizeof(int));
+    st_table_iter_t iter;
+    st_ut_eq(ST_ARG_INVALID, st_table_iter_init_prefix(t, &iter, &prefix), "");
+
+    // large table is cleared by detaching, its prefix index is emptied.
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(0, t->prefix_index->cnt, "");
+    st_ut_eq(0, count_prefix(t, ""), "");
+
+    add_path_keys(t, "/bucket/foo/", 0, 10, 0);
+    st_ut_eq(10, count_prefix(t, "/bucket/"), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    // every shard has its own index, keys of all shards are iterated in order.
+    st_ut_eq(ST_OK, st_table_new_sharded(table_pool, 4, &t), "");
+    st_ut_eq(ST_OK, st_table_enable_prefix_index(t), "");
+
+    add_path_keys(t, "/bucket/foo/", 0, 300, 0);
+    add_path_keys(t, "/bucket/bar/", 0, 100, 0);
+
+    st_ut_eq(300, count_prefix(t, "/bucket/foo/"), "");
+    st_ut_eq(100, count_prefix(t, "/bucket/bar/0"), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_table_cnt(table_pool), "");
+    st_ut_eq(0, get_alloc_cnt_in_slab(table_pool, sizeof(st_art_t)), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_enable_prefix_index(NULL), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, intern) {
+
+    st_table_t *t1;
+    st_table_t *t2;
+    st_table_iter_t iter;
+    st_str_t k1, k2, v;
+    int shm_fd;
+    char value[256] = {0};
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    st_ut_eq(ST_ARG_INVALID, st_table_pool_set_intern(NULL, 8), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_pool_set_intern(table_pool, -1), "");
+    st_ut_eq(ST_ARG_INVALID,
+             st_table_pool_set_intern(table_pool, ST_TABLE_INTERN_MAX_KEY_LEN + 1), "");
+
+    st_table_new(table_pool, &t1);
+    st_table_new(table_pool, &t2);
+
+    st_str_t key = st_str_const("status");
+    // element with the value just fits in 256 slab class without key bytes.
+    st_str_t val = st_str_wrap(value, 256 - sizeof(st_table_element_t) - 4);
+    st_str_t int_key = st_str_wrap_common(&shm_fd, ST_TYPES_INTEGER, sizeof(shm_fd));
+
+    // key added before interning is enabled is stored in element.
+    st_ut_eq(ST_OK, st_table_add_key_value(t1, key, val), "");
+    int64_t plain_bytes = t1->used_bytes;
+
+    st_ut_eq(ST_OK, st_table_pool_set_intern(table_pool, 8), "");
+
+    st_ut_eq(ST_OK, st_table_add_key_value(t2, key, val), "");
+    st_ut_eq(1, table_pool->intern.cnt, "");
+
+    // element is in a smaller slab class without key bytes, with this value.
+    st_ut_gt(plain_bytes, t2->used_bytes, "");
+
+    // value overwritten in place keeps key in element, a new element does not.
+    st_ut_eq(ST_OK, st_table_set_key_value(t1, key, val), "");
+    st_ut_eq(plain_bytes, t1->used_bytes, "");
+
+    st_ut_eq(ST_OK, st_table_remove_key(t1, key), "");
+    st_ut_eq(ST_OK, st_table_add_key_value(t1, key, val), "");
+    st_ut_eq(1, table_pool->intern.cnt, "");
+
+    st_table_iter_init(t1, &iter, NULL, 0);
+    st_ut_eq(ST_OK, st_table_iter_next(t1, &iter, &k1, &v), "");
+    st_table_iter_init(t2, &iter, NULL, 0);
+    st_ut_eq(ST_OK, st_table_iter_next(t2, &iter, &k2, &v), "");
+
+    // elements of different tables share key bytes.
+    st_ut_eq(k1.bytes, k2.bytes, "");
+    st_ut_eq(0, st_str_cmp(&key, &k1), "");
+    st_ut_eq(0, k1.bytes[k1.len], "");
+
+    // longer or non-string keys are not interned.
+    st_str_t long_key = st_str_const("content-type");
+    st_ut_eq(ST_OK, st_table_add_key_value(t1, long_key, val), "");
+    st_ut_eq(ST_OK, st_table_add_key_value(t1, int_key, val), "");
+    st_ut_eq(1, table_pool->intern.cnt, "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t1, long_key, &v), "");
+    st_ut_eq(ST_OK, st_table_get_value(t1, int_key, &v), "");
+
+    // interned key is removed with its last element.
+    st_ut_eq(ST_OK, st_table_remove_key(t1, key), "");
+    st_ut_eq(1, table_pool->intern.cnt, "");
+    st_ut_eq(ST_OK, st_table_get_value(t2, key, &v), "");
+
+    st_ut_eq(ST_OK, st_table_remove_key(t2, key), "");
+    st_ut_eq(0, table_pool->intern.cnt, "");
+
+    // dictionary grows, interned keys are released by clearing by detaching.
+    for (int i = 0; i < 3000; i++) {
+        char buf[16];
+        int n = snprintf(buf, sizeof(buf), "k%d", i % 1500);
+
+        st_table_t *t = i < 1500 ? t1 : t2;
+        st_str_t k = st_str_wrap(buf, n);
+
+        st_ut_eq(ST_OK, st_table_set_key_value(t, k, val), "");
+    }
+
+    st_ut_eq(1500, table_pool->intern.cnt, "");
+    st_ut_eq(2048, table_pool->intern.capacity, "");
+
+    st_ut_eq(ST_OK, st_table_pool_set_intern(table_pool, 0), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t1), "");
+    st_ut_eq(ST_OK, st_table_remove_all(t2), "");
+
+    int visited_cnt = 0;
+    while (st_table_free_detached(table_pool, 1024, &visited_cnt) != ST_EMPTY) {
+        visited_cnt = 0;
+    }
+
+    st_ut_eq(0, table_pool->intern.cnt, "");
+
+    st_ut_eq(ST_OK, st_table_free(t1), "");
+    st_ut_eq(ST_OK, st_table_free(t2), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, blob) {
+
+    st_table_t *t1;
+    st_table_t *t2;
+    st_table_t *sub;
+    st_str_t v1, v2;
+    int shm_fd;
+    char buf[4096];
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    st_ut_eq(ST_ARG_INVALID, st_table_pool_set_blob(NULL, 1024), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_pool_set_blob(table_pool, -1), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_pool_set_blob(table_pool, ST_TABLE_BLOB_MIN_LEN - 1), "");
+    st_ut_eq(ST_OK, st_table_pool_set_blob(table_pool, 1024), "");
+
+    st_table_new(table_pool, &t1);
+    st_table_new(table_pool, &t2);
+
+    st_str_t a = st_str_const("a");
+    st_str_t b = st_str_const("b");
+    st_str_t value = st_str_wrap(buf, sizeof(buf));
+
+    memset(buf, 'a', sizeof(buf));
+    st_ut_eq(ST_OK, st_table_add_key_value(t1, a, value), "");
+
+    // blob is shared instead of copied.
+    st_ut_eq(ST_OK, st_table_copy_value(t2, b, t1, a), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t1, a, &v1), "");
+    st_ut_eq(ST_OK, st_table_get_value(t2, b, &v2), "");
+    st_ut_eq(v1.bytes, v2.bytes, "");
+    st_ut_eq(0, st_str_cmp(&value, &v2), "");
+
+    // shared blob is never overwritten in place.
+    memset(buf, 'b', sizeof(buf));
+    st_ut_eq(ST_OK, st_table_set_key_value(t1, a, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t1, a, &v1), "");
+    st_ut_eq(ST_OK, st_table_get_value(t2, b, &v2), "");
+    st_ut_ne(v1.bytes, v2.bytes, "");
+    st_ut_eq(0, st_str_cmp(&value, &v1), "");
+    st_ut_eq('a', v2.bytes[0], "");
+
+    // blob not shared is.
+    memset(buf, 'c', sizeof(buf));
+    st_ut_eq(ST_OK, st_table_set_key_value(t1, a, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t1, a, &v2), "");
+    st_ut_eq(v1.bytes, v2.bytes, "");
+    st_ut_eq(0, st_str_cmp(&value, &v2), "");
+
+    // short value is in element, it is copied.
+    st_str_t small = st_str_wrap(buf, 100);
+    st_ut_eq(ST_OK, st_table_set_key_value(t1, b, small), "");
+    st_ut_eq(ST_OK, st_table_copy_value(t2, a, t1, b), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t1, b, &v1), "");
+    st_ut_eq(ST_OK, st_table_get_value(t2, a, &v2), "");
+    st_ut_ne(v1.bytes, v2.bytes, "");
+    st_ut_eq(0, st_str_cmp(&small, &v2), "");
+
+    st_str_t c = st_str_const("c");
+    st_ut_eq(ST_NOT_FOUND, st_table_copy_value(t2, c, t1, c), "");
+
+    st_table_new(table_pool, &sub);
+    st_str_t tvalue = st_str_wrap_common(&sub, ST_TYPES_TABLE, sizeof(sub));
+    st_ut_eq(ST_OK, st_table_add_key_value(t1, c, tvalue), "");
+    st_ut_eq(ST_UNSUPPORTED, st_table_copy_value(t2, c, t1, c), "");
+    st_ut_eq(ST_OK, st_table_remove_key(t1, c), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_copy_value(NULL, c, t1, c), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_copy_value(t2, c, NULL, c), "");
+
+    // blob is freed with the last element using it, the first blob of a is
+    // still used by b of t2.
+    st_ut_eq(ST_OK, st_table_copy_value(t2, c, t1, a), "");
+    st_ut_eq(ST_OK, st_table_remove_all(t1), "");
+    st_ut_eq(2, get_alloc_cnt_in_slab(table_pool, sizeof(buf) + sizeof(st_table_blob_t)), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t2), "");
+    st_ut_eq(0, get_alloc_cnt_in_slab(table_pool, sizeof(buf) + sizeof(st_table_blob_t)), "");
+    st_ut_eq(0, t2->used_bytes, "");
+
+    st_ut_eq(ST_OK, st_table_free(t1), "");
+    st_ut_eq(ST_OK, st_table_free(t2), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, small_part) {
+
+    st_table_t *t;
+    st_table_iter_t iter;
+    st_str_t found;
+    st_str_t k;
+    st_str_t v;
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    st_table_new(table_pool, &t);
+    st_ut_eq(0, t->small_cnt, "");
+
+    // keys 0, 10, 20 ... added in a shuffled order, 1 is in array part.
+    int keys[] = {30, 0, 70, 20, 50, 10, 60, 40, 1};
+
+    for (int i = 0; i < st_nelts(keys); i++) {
+        st_str_t key = st_str_wrap_common(&keys[i], ST_TYPES_INTEGER, sizeof(int));
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, key), "");
+    }
+
+    st_ut_eq(ST_TABLE_SMALL_CAPACITY, t->small_cnt, "");
+    st_ut_eq(1, st_rbtree_is_empty(&t->elements), "");
+
+    for (int i = 1; i < t->small_cnt; i++) {
+        st_ut_lt(0, st_str_cmp(&t->small[i].element->key, &t->small[i - 1].element->key), "");
+    }
+
+    struct {
+        int key;
+        int side;
+        int expected;
+    } cases[] = {
+        {20, ST_SIDE_EQ, 20},
+        {25, ST_SIDE_EQ, -2},
+        {25, ST_SIDE_LEFT, 20},
+        {20, ST_SIDE_LEFT, 10},
+        {20, ST_SIDE_LEFT_EQ, 20},
+        {25, ST_SIDE_RIGHT, 30},
+        {20, ST_SIDE_RIGHT, 30},
+        {20, ST_SIDE_RIGHT_EQ, 20},
+        {-5, ST_SIDE_RIGHT_EQ, 0},
+        {0, ST_SIDE_RIGHT, 1},
+        {1, ST_SIDE_RIGHT, 10},
+        {-5, ST_SIDE_LEFT, -2},
+        {75, ST_SIDE_RIGHT, -2},
+        {75, ST_SIDE_LEFT, 70},
+    };
+
+    for (int i = 0; i < st_nelts(cases); i++) {
+        st_str_t key = st_str_wrap_common(&cases[i].key, ST_TYPES_INTEGER, sizeof(int));
+
+        st_ut_eq(ST_OK, st_table_iter_init(t, &iter, &key, cases[i].side), "");
+
+        int ret = st_table_iter_next(t, &iter, &k, &v);
+
+        if (cases[i].expected == -2) {
+            st_ut_eq(ST_ITER_FINISH, ret, "case %d", i);
+        } else {
+            st_ut_eq(ST_OK, ret, "case %d", i);
+            st_ut_eq(cases[i].expected, *(int *)k.bytes, "case %d", i);
+        }
+    }
+
+    // the element is replaced in small part.
+    int k50 = 50;
+    int v50 = 500;
+    st_str_t key = st_str_wrap_common(&k50, ST_TYPES_INTEGER, sizeof(int));
+    st_str_t value = st_str_wrap_common(&v50, ST_TYPES_INTEGER, sizeof(int));
+
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+    st_ut_eq(ST_OK, st_table_get_value_copy(t, key, &found), "");
+    st_ut_eq(500, *(int *)found.bytes, "");
+    st_str_destroy(&found);
+
+    // small part is full, elements are moved to rbtree.
+    int k80 = 80;
+    key = (st_str_t)st_str_wrap_common(&k80, ST_TYPES_INTEGER, sizeof(int));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, key), "");
+
+    st_ut_eq(-1, t->small_cnt, "");
+    st_ut_eq(0, st_rbtree_is_empty(&t->elements), "");
+
+    for (int i = 0; i < st_nelts(keys); i++) {
+        key = (st_str_t)st_str_wrap_common(&keys[i], ST_TYPES_INTEGER, sizeof(int));
+
+        st_ut_eq(ST_OK, st_table_get_value_copy(t, key, &found), "");
+        st_str_destroy(&found);
+    }
+
+    st_table_iter_init(t, &iter, NULL, 0);
+
+    st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &k, &v), "");
+    st_ut_eq(0, *(int *)k.bytes, "");
+
+    for (int i = 1; i <= 80; i += i == 1 ? 9 : 10) {
+        st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &k, &v), "");
+        st_ut_eq(i, *(int *)k.bytes, "");
+    }
+
+    st_ut_eq(ST_ITER_FINISH, st_table_iter_next(t, &iter, &k, &v), "");
+
+    // small part is used again after rbtree becomes empty.
+    for (int i = 0; i <= 80; i += 10) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(int));
+        st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    }
+
+    st_ut_eq(0, t->small_cnt, "");
+    st_ut_eq(1, st_rbtree_is_empty(&t->elements), "");
+    st_ut_eq(1, t->element_cnt, "");
+
+    key = (st_str_t)st_str_wrap_common(&k80, ST_TYPES_INTEGER, sizeof(int));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, key), "");
+    st_ut_eq(1, t->small_cnt, "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(0, t->small_cnt, "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_table_cnt(table_pool), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, array_part) {
+
+    st_table_t *t;
+    st_str_t found;
+    st_str_t key;
+    st_str_t value;
+    st_table_iter_t iter;
+    int value_buf[40] = {0};
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    st_table_new(table_pool, &t);
+
+    for (int i = 1; i <= 100; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        value_buf[0] = i;
+        value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+        st_ut_eq(ST_EXISTED, st_table_add_key_value(t, key, value), "");
+    }
+
+    st_ut_eq(100, t->array_cnt, "");
+    st_ut_eq(128, t->array->capacity, "");
+    st_ut_eq(1, st_rbtree_is_empty(&t->elements), "");
+
+    // keys not in [1, capacity] are stored in rbtree.
+    int others[] = {-1, 0, 1000};
+    for (int i = 0; i < 3; i++) {
+        key = (st_str_t)st_str_wrap_common(&others[i], ST_TYPES_INTEGER, sizeof(int));
+        value_buf[0] = others[i];
+        value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    int skey = 1;
+    key = (st_str_t)st_str_wrap(&skey, sizeof(skey));
+    value_buf[0] = -100;
+    value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+
+    st_ut_eq(100, t->array_cnt, "");
+    st_ut_eq(104, t->element_cnt, "");
+    st_ut_eq(104, remain_element_cnt(table_pool, element_size), "");
+
+    for (int i = -1; i <= 100; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i, *(int *)found.bytes, "");
+    }
+
+    // elements in array part and rbtree are iterated in order.
+    int expected[104] = {-100, -1, 0};
+    for (int i = 1; i <= 100; i++) {
+        expected[i + 2] = i;
+    }
+    expected[103] = 1000;
+
+    st_ut_eq(ST_OK, st_table_iter_init(t, &iter, NULL, 0), "");
+
+    for (int i = 0; i < 104; i++) {
+        st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &key, &found), "");
+        st_ut_eq(expected[i], *(int *)found.bytes, "");
+    }
+
+    st_ut_eq(ST_ITER_FINISH, st_table_iter_next(t, &iter, &key, &found), "");
+
+    struct {
+        int key;
+        int side;
+        int expected;
+    } cases[] = {
+        {50,   ST_SIDE_EQ,       50},
+        {50,   ST_SIDE_RIGHT,    51},
+        {50,   ST_SIDE_LEFT,     49},
+        {1,    ST_SIDE_LEFT,     0},
+        {0,    ST_SIDE_RIGHT,    1},
+        {100,  ST_SIDE_RIGHT,    1000},
+        {500,  ST_SIDE_LEFT_EQ,  100},
+        {500,  ST_SIDE_RIGHT_EQ, 1000},
+        {1000, ST_SIDE_LEFT,     100},
+    };
+
+    for (int i = 0; i < st_nelts(cases); i++) {
+        st_str_t init_key = st_str_wrap_common(&cases[i].key, ST_TYPES_INTEGER, sizeof(int));
+
+        st_ut_eq(ST_OK, st_table_iter_init(t, &iter, &init_key, cases[i].side), "");
+        st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &key, &found), "");
+        st_ut_eq(cases[i].expected, *(int *)found.bytes, "case %d", i);
+    }
+
+    // replace value in array part.
+    int k = 10;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    value_buf[0] = 10000;
+    value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(10000, *(int *)found.bytes, "");
+    st_ut_eq(104, remain_element_cnt(table_pool, element_size), "");
+
+    // array part is shrunk and elements are moved to rbtree.
+    for (int i = 1; i <= 90; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+        st_ut_eq(ST_NOT_FOUND, st_table_remove_key(t, key), "");
+    }
+
+    st_ut_eq(NULL, t->array, "");
+    st_ut_eq(0, t->array_cnt, "");
+    st_ut_eq(14, t->element_cnt, "");
+
+    for (int i = 91; i <= 100; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i, *(int *)found.bytes, "");
+    }
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+
+    // keys added in descending order are moved to array part at last.
+    for (int i = 100; i >= 1; i--) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        value_buf[0] = i;
+        value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    st_ut_eq(100, t->array_cnt, "");
+    st_ut_eq(128, t->array->capacity, "");
+    st_ut_eq(1, st_rbtree_is_empty(&t->elements), "");
+
+    st_ut_eq(ST_OK, st_table_enable_hash_index(t), "");
+    st_ut_eq(100, t->hash_index->used, "");
+
+    for (int i = 1; i <= 100; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i, *(int *)found.bytes, "");
+    }
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(NULL, t->array, "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, set_many) {
+
+    st_table_t *t;
+    st_str_t found;
+    st_str_t key;
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    int key_buf[10];
+    int value_buf[10][40] = {{0}};
+    st_str_t keys[10];
+    st_str_t values[10];
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf[0]);
+
+    st_table_new(table_pool, &t);
+
+    for (int i = 0; i < 10; i++) {
+        key_buf[i] = i + 1;
+        value_buf[i][0] = i + 1;
+
+        keys[i] = (st_str_t)st_str_wrap_common(&key_buf[i], ST_TYPES_INTEGER, sizeof(int));
+        values[i] = (st_str_t)st_str_wrap(value_buf[i], sizeof(value_buf[i]));
+    }
+
+    st_ut_eq(ST_OK, st_table_set_many(t, keys, values, 10), "");
+    st_ut_eq(10, t->element_cnt, "");
+    st_ut_eq(10, t->array_cnt, "");
+    st_ut_eq(10, remain_element_cnt(table_pool, element_size), "");
+
+    for (int i = 1; i <= 10; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i, *(int *)found.bytes, "");
+    }
+
+    // replace existed keys, and the later one of duplicated keys wins.
+    for (int i = 0; i < 10; i++) {
+        key_buf[i] = i % 2 == 0 ? 5 : 100 + i;
+        value_buf[i][0] = 1000 + i;
+    }
+
+    st_ut_eq(ST_OK, st_table_set_many(t, keys, values, 10), "");
+    st_ut_eq(15, t->element_cnt, "");
+    st_ut_eq(15, remain_element_cnt(table_pool, element_size), "");
+
+    int k = 5;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(1008, *(int *)found.bytes, "");
+
+    k = 109;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(1009, *(int *)found.bytes, "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_set_many(t, keys, values, 0), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_set_many(t, NULL, values, 1), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_set_many(t, keys, NULL, 1), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_set_many(NULL, keys, values, 1), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, txn) {
+
+    st_table_t *t1;
+    st_table_t *t2;
+    st_table_t *t3;
+    st_table_t *sub;
+    st_table_txn_t txn;
+    st_str_t found;
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    int value_buf[40] = {0};
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    int k = 0;
+    st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+    st_table_new(table_pool, &t1);
+    st_table_new(table_pool, &t2);
+    st_table_new_sharded(table_pool, 4, &t3);
+
+    for (k = 1; k <= 3; k++) {
+        value_buf[0] = k;
+        st_ut_eq(ST_OK, st_table_add_key_value(t1, key, value), "");
+    }
+
+    int64_t version = t1->version;
+
+    st_ut_eq(ST_OK, st_table_txn_init(table_pool, &txn), "");
+
+    // key and value are copied when mutation is added. keys are out of array
+    // part, so that only elements are in their slab class.
+    for (k = 101; k <= 120; k++) {
+        value_buf[0] = k * 10;
+
+        st_ut_eq(ST_OK, st_table_txn_set(&txn, k % 2 ? t2 : t3, key, value), "");
+    }
+
+    k = 1;
+    st_ut_eq(ST_OK, st_table_txn_remove(&txn, t1, key), "");
+
+    // the later mutation of the same key wins.
+    k = 2;
+    value_buf[0] = 1;
+    st_ut_eq(ST_OK, st_table_txn_set(&txn, t1, key, value), "");
+    value_buf[0] = 2;
+    st_ut_eq(ST_OK, st_table_txn_set(&txn, t1, key, value), "");
+
+    k = 3;
+    st_ut_eq(ST_OK, st_table_txn_set(&txn, t1, key, value), "");
+    st_ut_eq(ST_OK, st_table_txn_remove(&txn, t1, key), "");
+
+    // sets are applied before removes, the order of a key is still kept.
+    k = 4;
+    value_buf[0] = 4;
+    st_ut_eq(ST_OK, st_table_txn_remove(&txn, t1, key), "");
+    st_ut_eq(ST_OK, st_table_txn_set(&txn, t1, key, value), "");
+
+    // removing absent key does nothing.
+    k = 100;
+    st_ut_eq(ST_OK, st_table_txn_remove(&txn, t2, key), "");
+
+    // nothing is applied before commit.
+    st_ut_eq(0, t2->element_cnt, "");
+    st_ut_eq(version, t1->version, "");
+
+    st_ut_eq(28, txn.cnt, "");
+    st_ut_eq(ST_OK, st_table_txn_commit(&txn), "");
+    st_ut_eq(0, txn.cnt, "");
+
+    // one version change for all mutations of a table.
+    st_ut_eq(version + 2, t1->version, "");
+    st_ut_eq(2, t1->element_cnt, "");
+    st_ut_eq(10, t2->element_cnt, "");
+
+    for (k = 101; k <= 120; k++) {
+        st_table_t *t = st_table_shard_of(k % 2 ? t2 : t3, key);
+
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(k * 10, *(int *)found.bytes, "");
+    }
+
+    k = 1;
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value(t1, key, &found), "");
+    k = 2;
+    st_ut_eq(ST_OK, st_table_get_value(t1, key, &found), "");
+    st_ut_eq(2, *(int *)found.bytes, "");
+    k = 3;
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value(t1, key, &found), "");
+    k = 4;
+    st_ut_eq(ST_OK, st_table_get_value(t1, key, &found), "");
+    st_ut_eq(4, *(int *)found.bytes, "");
+
+    st_ut_eq(22, remain_element_cnt(table_pool, element_size), "");
+
+    // committing again applies nothing, table value is set in transaction.
+    st_ut_eq(ST_OK, st_table_txn_commit(&txn), "");
+
+    st_table_new(table_pool, &sub);
+    st_str_t tvalue = st_str_wrap_common(&sub, ST_TYPES_TABLE, sizeof(sub));
+
+    k = 1;
+    st_ut_eq(ST_OK, st_table_txn_set(&txn, t1, key, tvalue), "");
+    st_ut_eq(ST_OK, st_table_txn_commit(&txn), "");
+    st_ut_eq(1, t1->table_value_cnt, "");
+
+    st_ut_eq(ST_OK, st_table_txn_remove(&txn, t1, key), "");
+    st_ut_eq(ST_OK, st_table_txn_commit(&txn), "");
+    st_ut_eq(0, t1->table_value_cnt, "");
+
+    // mutations not committed are discarded.
+    for (k = 1; k <= 10; k++) {
+        st_ut_eq(ST_OK, st_table_txn_set(&txn, t1, key, value), "");
+    }
+
+    st_ut_eq(32, remain_element_cnt(table_pool, element_size), "");
+    st_ut_eq(ST_OK, st_table_txn_destroy(&txn), "");
+    st_ut_eq(22, remain_element_cnt(table_pool, element_size), "");
+    st_ut_eq(2, t1->element_cnt, "");
+
+    st_ut_eq(ST_UNINITED, st_table_txn_set(&txn, t1, key, value), "");
+    st_ut_eq(ST_UNINITED, st_table_txn_commit(&txn), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_txn_init(NULL, &txn), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_txn_init(table_pool, NULL), "");
+
+    st_ut_eq(ST_OK, st_table_txn_init(table_pool, &txn), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_txn_set(&txn, NULL, key, value), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_txn_remove(&txn, t1, (st_str_t)st_str_null), "");
+    st_ut_eq(ST_OK, st_table_txn_destroy(&txn), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t1), "");
+    st_ut_eq(ST_OK, st_table_remove_all(t2), "");
+    st_ut_eq(ST_OK, st_table_remove_all(t3), "");
+    st_ut_eq(ST_OK, st_table_free(t1), "");
+    st_ut_eq(ST_OK, st_table_free(t2), "");
+    st_ut_eq(ST_OK, st_table_free(t3), "");
+
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, set_value_in_place) {
+
+    st_table_t *t;
+    st_str_t found;
+    st_str_t copied = st_str_null;
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    char *k = "counter";
+    st_str_t key = st_str_wrap(k, strlen(k));
+
+    int value_buf[40] = {0};
+    int element_size = sizeof(st_table_element_t) + strlen(k) + sizeof(value_buf);
+
+    st_table_new(table_pool, &t);
+
+    value_buf[0] = 1;
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    uint8_t *bytes = found.bytes;
+    int64_t version = t->version;
+
+    // value of the same size is overwritten in place.
+    for (int i = 2; i < 10; i++) {
+        value_buf[0] = i;
+        st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(bytes, found.bytes, "value must be overwritten in place");
+        st_ut_eq(i, *(int *)found.bytes, "");
+
+        st_ut_eq(ST_OK, st_table_get_value_copy(t, key, &copied), "");
+        st_ut_eq(i, *(int *)copied.bytes, "");
+        st_str_destroy(&copied);
+    }
+
+    st_ut_eq(version + 16, t->version, "");
+    st_ut_eq(1, t->element_cnt, "");
+    st_ut_eq(1, remain_element_cnt(table_pool, element_size), "");
+
+    // smaller value in the same size class is overwritten in place too.
+    value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf) - 16);
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(bytes, found.bytes, "value must be overwritten in place");
+    st_ut_eq(sizeof(value_buf) - 16, found.len, "");
+
+    // value does not fit, a new element replaces the old one.
+    int large_buf[200] = {0};
+    large_buf[0] = 100;
+    value = (st_str_t)st_str_wrap(large_buf, sizeof(large_buf));
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_ne(bytes, found.bytes, "");
+    st_ut_eq(100, *(int *)found.bytes, "");
+    st_ut_eq(sizeof(large_buf), found.len, "");
+
+    // much smaller value is not kept in large element.
+    bytes = found.bytes;
+    value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_ne(bytes, found.bytes, "");
+    st_ut_eq(sizeof(value_buf), found.len, "");
+
+    st_ut_eq(1, t->element_cnt, "");
+    st_ut_eq(1, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, incr) {
+
+    st_table_t *t;
+    st_str_t found;
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    st_table_new(table_pool, &t);
+
+    char *k = "counter";
+    st_str_t key = st_str_wrap(k, strlen(k));
+
+    // key is added with delta as initial value.
+    int delta = 5;
+    int new_value = 0;
+    st_str_t d = st_str_wrap_common(&delta, ST_TYPES_INTEGER, sizeof(delta));
+
+    st_ut_eq(ST_OK, st_table_incr(t, key, d, &new_value), "");
+    st_ut_eq(5, new_value, "");
+    st_ut_eq(1, t->element_cnt, "");
+
+    delta = -7;
+    st_ut_eq(ST_OK, st_table_incr(t, key, d, &new_value), "");
+    st_ut_eq(-2, new_value, "");
+
+    st_ut_eq(ST_OK, st_table_incr(t, key, d, NULL), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(ST_TYPES_INTEGER, found.type, "");
+    st_ut_eq(-9, *(int *)found.bytes, "");
+
+    // value is not changed if it overflows.
+    delta = INT_MIN;
+    st_ut_eq(ST_NUM_OVERFLOW, st_table_incr(t, key, d, &new_value), "");
+    st_ut_eq(-2, new_value, "");
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(-9, *(int *)found.bytes, "");
+
+    // value type must be the same as delta.
+    double number_delta = 1.5;
+    double number_value = 0;
+    st_str_t nd = st_str_wrap_common(&number_delta, ST_TYPES_NUMBER, sizeof(number_delta));
+    st_ut_eq(ST_STATE_INVALID, st_table_incr(t, key, nd, &number_value), "");
+
+    char *nk = "number";
+    key = (st_str_t)st_str_wrap(nk, strlen(nk));
+    st_ut_eq(ST_OK, st_table_incr(t, key, nd, &number_value), "");
+    st_ut_eq(ST_OK, st_table_incr(t, key, nd, &number_value), "");
+    st_ut_eq(1, number_value == 3.0, "");
+
+    // u64 wraps around.
+    uint64_t u64_delta = 1;
+    uint64_t u64_value = 0;
+    st_str_t ud = st_str_wrap_common(&u64_delta, ST_TYPES_U64, sizeof(u64_delta));
+
+    char *uk = "u64";
+    key = (st_str_t)st_str_wrap(uk, strlen(uk));
+    st_ut_eq(ST_OK, st_table_incr(t, key, ud, &u64_value), "");
+
+    u64_delta = UINT64_MAX;
+    st_ut_eq(ST_OK, st_table_incr(t, key, ud, &u64_value), "");
+    st_ut_eq(0, u64_value, "");
+
+    st_ut_eq(3, t->element_cnt, "");
+
+    // delta must be a number.
+    st_str_t sd = st_str_wrap(nk, strlen(nk));
+    st_ut_eq(ST_ARG_INVALID, st_table_incr(t, key, sd, NULL), "");
+
+    st_str_t bad_len = st_str_wrap_common(&u64_delta, ST_TYPES_INTEGER, sizeof(u64_delta));
+    st_ut_eq(ST_ARG_INVALID, st_table_incr(t, key, bad_len, NULL), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_incr(NULL, key, ud, NULL), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, cas_and_set_if_version) {
+
+    st_table_t *t;
+    st_str_t found;
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    int value_buf[40] = {0};
+    int expected_buf[40] = {0};
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    st_table_new(table_pool, &t);
+
+    int k = 1;
+    st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+    st_str_t expected = st_str_wrap(expected_buf, sizeof(expected_buf));
+    st_str_t absent = st_str_null;
+
+    // key must not exist if expected is null.
+    value_buf[0] = 1;
+    st_ut_eq(ST_OK, st_table_cas(t, key, absent, value), "");
+    st_ut_eq(ST_NOT_EQUAL, st_table_cas(t, key, absent, value), "");
+
+    // value is set only if current value is expected.
+    expected_buf[0] = 2;
+    value_buf[0] = 3;
+    st_ut_eq(ST_NOT_EQUAL, st_table_cas(t, key, expected, value), "");
+
+    expected_buf[0] = 1;
+    st_ut_eq(ST_OK, st_table_cas(t, key, expected, value), "");
+    st_ut_eq(ST_NOT_EQUAL, st_table_cas(t, key, expected, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(3, *(int *)found.bytes, "");
+
+    // value of different type or length is not equal.
+    expected_buf[0] = 3;
+    expected = (st_str_t)st_str_wrap(expected_buf, sizeof(expected_buf) - 4);
+    st_ut_eq(ST_NOT_EQUAL, st_table_cas(t, key, expected, value), "");
+
+    int missing = 2;
+    st_str_t missing_key = st_str_wrap_common(&missing, ST_TYPES_INTEGER, sizeof(missing));
+    expected = (st_str_t)st_str_wrap(expected_buf, sizeof(expected_buf));
+    st_ut_eq(ST_NOT_EQUAL, st_table_cas(t, missing_key, expected, value), "");
+
+    st_ut_eq(1, t->element_cnt, "");
+    st_ut_eq(1, remain_element_cnt(table_pool, element_size), "");
+
+    // value is set only if table is not modified since version is got.
+    int64_t version = st_table_get_version(t);
+    st_ut_eq(0, version % 2, "");
+
+    value_buf[0] = 4;
+    st_ut_eq(ST_OK, st_table_set_if_version(t, key, value, version), "");
+    st_ut_eq(ST_TABLE_MODIFIED, st_table_set_if_version(t, key, value, version), "");
+
+    version = st_table_get_version(t);
+    st_ut_eq(ST_OK, st_table_set_key_value(t, missing_key, value), "");
+    st_ut_eq(ST_TABLE_MODIFIED, st_table_set_if_version(t, key, value, version), "");
+
+    version = st_table_get_version(t);
+    value_buf[0] = 5;
+    st_ut_eq(ST_OK, st_table_set_if_version(t, key, value, version), "");
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(5, *(int *)found.bytes, "");
+
+    st_ut_eq(2, t->element_cnt, "");
+    st_ut_eq(2, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_set_if_version(t, key, value, -1), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_cas(NULL, key, expected, value), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return st_str_cmp((st_str_t *)a, (st_str_t *)b);
+}
+
+st_test(table, key_prefix_order) {
+
+    st_table_t *t;
+    st_str_t found;
+    st_str_t key;
+    st_table_iter_t iter;
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    // keys share long prefixes and some of them differ only in length or
+    // trailing 0, the order must be the same as st_str_cmp.
+    struct {
+        char *bytes;
+        int len;
+    } cases[] = {
+        {"a",                  1},
+        {"a\0",                2},
+        {"a\0\0\0\0\0\0\0\0",    9},
+        {"ab",                 2},
+        {"abcdefg",            7},
+        {"abcdefgh",           8},
+        {"abcdefgh\0",         9},
+        {"abcdefgha",          9},
+        {"abcdefgz",           8},
+        {"http://x/aaaaaaaa1", 18},
+        {"http://x/aaaaaaaa2", 18},
+        {"http://x/aaaaaaab",  17},
+        {"\xff",               1},
+        {"\xff\xff",           2},
+    };
+
+    st_str_t sorted[st_nelts(cases)];
+
+    st_table_new(table_pool, &t);
+
+    for (int i = st_nelts(cases) - 1; i >= 0; i--) {
+        key = (st_str_t)st_str_wrap(cases[i].bytes, cases[i].len);
+        sorted[i] = key;
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, key), "");
+        st_ut_eq(ST_EXISTED, st_table_add_key_value(t, key, key), "");
+    }
+
+    qsort(sorted, st_nelts(cases), sizeof(st_str_t), cmp_str);
+
+    for (int round = 0; round < 2; round++) {
+        // search in rbtree first and then in hash index.
+        if (round == 1) {
+            st_ut_eq(ST_OK, st_table_enable_hash_index(t), "");
+        }
+
+        st_ut_eq(ST_OK, st_table_iter_init(t, &iter, NULL, 0), "");
+
+        for (int i = 0; i < st_nelts(cases); i++) {
+            st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &key, &found), "");
+            st_ut_eq(0, st_str_cmp(&sorted[i], &key), "wrong order of key %d", i);
+
+            st_ut_eq(ST_OK, st_table_get_value(t, sorted[i], &found), "");
+            st_ut_eq(0, st_str_cmp(&sorted[i], &found), "");
+        }
+
+        st_ut_eq(ST_ITER_FINISH, st_table_iter_next(t, &iter, &key, &found), "");
+
+        key = (st_str_t)st_str_wrap("abcdefgh\0\0", 10);
+        st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+    }
+
+    for (int i = 0; i < st_nelts(cases); i++) {
+        st_ut_eq(ST_OK, st_table_remove_key(t, sorted[i]), "");
+    }
+
+    st_ut_eq(0, t->element_cnt, "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, get_value_copy) {
+
+    st_table_t *t;
+    st_table_t *sub;
+    st_str_t copied = st_str_null;
+    int value_buf[40] = {0};
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    st_table_new(table_pool, &t);
+    st_table_new(table_pool, &sub);
+
+    for (int i = 0; i < 100; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        value_buf[0] = i;
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    for (int i = 0; i < 200; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        // search in rbtree first and then in hash index.
+        if (i == 100) {
+            st_ut_eq(ST_OK, st_table_enable_hash_index(t), "");
+        }
+
+        int k = i % 100;
+        key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+
+        st_ut_eq(ST_OK, st_table_get_value_copy(t, key, &copied), "");
+        st_ut_eq(k, *(int *)copied.bytes, "");
+        st_ut_eq(sizeof(value_buf), copied.len, "");
+        st_ut_eq(1, copied.bytes_owned, "");
+
+        st_str_destroy(&copied);
+    }
+
+    int k = 100;
+    st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value_copy(t, key, &copied), "");
+    st_ut_eq(NULL, copied.bytes, "");
+
+    // table value can not be copied without lock.
+    st_str_t value = st_str_wrap_common(&sub, ST_TYPES_TABLE, sizeof(sub));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    st_ut_eq(ST_AGAIN, st_table_get_value_copy(t, key, &copied), "");
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+
+    // removed element is not freed until lock free readers left.
+    k = 0;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    value = (st_str_t)st_str_wrap(value_buf, sizeof(value_buf));
+
+    int slot = st_table_reader_enter(table_pool);
+
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(100, remain_element_cnt(table_pool, element_size), "");
+
+    st_table_reader_leave(table_pool, slot);
+
+    k = 1;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(98, remain_element_cnt(table_pool, element_size), "");
+
+    // a dead process left in read section holds back freeing until its
+    // slot is cleaned.
+    int pid = fork();
+    if (pid == 0) {
+        st_table_reader_enter(table_pool);
+        exit(0);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    k = 2;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(98, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_OK, st_table_reader_clean(table_pool, pid), "");
+
+    k = 3;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(96, remain_element_cnt(table_pool, element_size), "");
+
+    // a process getting no reader slot does not read without lock.
+    st_table_reclaim_t *reclaim = &table_pool->reclaim;
+    pid_t busy_pid = 1 << 30;
+
+    for (int i = 0; i < ST_TABLE_READER_SLOT_CNT; i++) {
+        if (reclaim->slots[i].pid == 0) {
+            reclaim->slots[i].pid = busy_pid;
+        }
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        st_table_borrow_t borrow;
+
+        k = 4;
+        key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+
+        st_table_borrow_begin(table_pool, &borrow);
+
+        int failed = st_table_reader_enter(table_pool) != ST_AGAIN
+                     || st_table_get_value_copy(t, key, &copied) != ST_AGAIN
+                     || st_table_borrow_value(&borrow, t, key, &copied) != ST_AGAIN;
+
+        exit(failed);
+    }
+
+    waitpid(pid, &status, 0);
+    st_ut_eq(0, WEXITSTATUS(status), "");
+
+    st_ut_eq(ST_OK, st_table_reader_clean(table_pool, busy_pid), "");
+
+    // value larger than the buffer on stack.
+    char large[1000];
+    memset(large, 'x', sizeof(large));
+
+    value = (st_str_t)st_str_wrap(large, sizeof(large));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+
+    st_ut_eq(ST_OK, st_table_get_value_copy(t, key, &copied), "");
+    st_ut_eq(sizeof(large), copied.len, "");
+    st_ut_eq(0, memcmp(large, copied.bytes, sizeof(large)), "");
+    st_ut_eq(1, copied.bytes_owned, "");
+    st_str_destroy(&copied);
+
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+
+    // version is even when table is not being modified.
+    st_ut_eq(0, t->version % 2, "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_get_value_copy(NULL, key, &copied), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_get_value_copy(t, key, NULL), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, iter_next_key_value) {
+
+    int i;
+    st_table_t *t;
+    int value_buf[40] = {0};
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    st_list_t all = ST_LIST_INIT(all);
+
+    st_table_new(table_pool, &t);
+
+    for (i = 0; i < 100; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        value_buf[0] = i;
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_table_add_key_value(t, key, value);
+    }
+
+    st_str_t k;
+    st_str_t v1;
+    st_str_t v2;
+    st_table_iter_t iter;
+
+    int sides[] = { ST_SIDE_LEFT_EQ, ST_SIDE_RIGHT_EQ };
+    for (int cnt = 0; cnt < st_nelts(sides); cnt++) {
+        int null_index     = -1;
+        int boundary_index = 100;
+        int boundary_value = 99;
+
+        if (sides[cnt] == ST_SIDE_RIGHT_EQ) {
+            null_index     = 100;
+            boundary_index = -1;
+            boundary_value = 0;
+        }
+
+        for (int i = -1; i < 101; i++) {
+            st_str_t init_key = st_str_wrap_common(&i,
+                                                   ST_TYPES_INTEGER,
+                                                   sizeof(i));
+
+            int ret = st_table_iter_init(t, &iter, &init_key, sides[cnt]);
+            st_ut_eq(ST_OK, ret, "failed to init iterator with init_key");
+            if (i == null_index) {
+                st_ut_eq(NULL, iter.element, "init_key le failed");
+            }
+            else {
+                int value = *(int *)(iter.element->value.bytes);
+
+                if (i == boundary_index) {
+                    st_ut_eq(boundary_value, value, "failed to init iter");
+                }
+                else {
+                    st_ut_eq(i, value, "failed to init iter");
+                }
+            }
+        }
+    }
+
+    st_table_iter_init(t, &iter, NULL, 0);
+
+    for (i = 0; i < 100; i++) {
+        st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &k, &v1), "");
+
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &v2), "");
+
+        st_ut_eq(0, st_str_cmp(&k, &key), "");
+        st_ut_eq(0, st_str_cmp(&v1, &v2), "");
+    }
+
+    st_ut_eq(ST_ITER_FINISH, st_table_iter_next(t, &iter, &k, &v1), "");
+
+    st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+    value_buf[0] = 100;
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+    st_ut_eq(0, st_table_add_key_value(t, key, value), "");
+
+    st_ut_eq(ST_TABLE_MODIFIED, st_table_iter_next(t, &iter, &k, &v1), "");
+
+    st_table_remove_all(t);
+    st_table_free(t);
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, snapshot) {
+
+    st_table_t *t;
+    st_table_t *other;
+    st_str_t k;
+    st_str_t v;
+    st_table_snapshot_t snapshot;
+    int value_buf[40] = {0};
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    st_table_new(table_pool, &t);
+
+    // keys in array part and in rbtree.
+    for (int i = -50; i <= 50; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        value_buf[0] = i;
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    int counter = 0;
+    int delta = 1;
+    char *ck = "counter";
+    st_str_t counter_key = st_str_wrap(ck, strlen(ck));
+    st_str_t d = st_str_wrap_common(&delta, ST_TYPES_INTEGER, sizeof(delta));
+    st_ut_eq(ST_OK, st_table_incr(t, counter_key, d, &counter), "");
+
+    st_table_new(table_pool, &other);
+
+    st_ut_eq(ST_OK, st_table_snapshot_init(t, &snapshot), "");
+    st_ut_eq(102, snapshot.cnt, "");
+    st_ut_eq(snapshot.pin, t->pin, "");
+    st_ut_eq(1, table_pool->pins[t->pin - 1].holder_cnt, "");
+
+    // other tables are not pinned.
+    st_ut_eq(0, other->pin, "");
+
+    // modify table after snapshot is taken, nothing in snapshot is changed.
+    for (int i = -50; i <= 50; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        if (i % 2 == 0) {
+            st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+            continue;
+        }
+
+        value_buf[0] = i * 10;
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+        st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+    }
+
+    st_ut_eq(ST_OK, st_table_incr(t, counter_key, d, &counter), "");
+    st_ut_eq(2, counter, "");
+
+    // replaced and removed elements are not freed while snapshot is alive.
+    st_ut_eq(101 + 50, remain_element_cnt(table_pool, element_size), "");
+
+    // string key is less than integer key.
+    st_ut_eq(ST_OK, st_table_snapshot_next(&snapshot, &k, &v), "");
+    st_ut_eq(0, st_str_cmp(&k, &counter_key), "");
+    st_ut_eq(1, *(int *)v.bytes, "");
+
+    for (int i = -50; i <= 50; i++) {
+        st_ut_eq(ST_OK, st_table_snapshot_next(&snapshot, &k, &v), "");
+
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(0, st_str_cmp(&k, &key), "");
+        st_ut_eq(i, *(int *)v.bytes, "");
+    }
+
+    st_ut_eq(ST_ITER_FINISH, st_table_snapshot_next(&snapshot, &k, &v), "");
+
+    // elements kept by the pin are freed as it is released.
+    st_ut_eq(ST_OK, st_table_snapshot_destroy(&snapshot), "");
+    st_ut_eq(0, t->pin, "");
+    st_ut_eq(50, remain_element_cnt(table_pool, element_size), "");
+    st_ut_eq(ST_UNINITED, st_table_snapshot_next(&snapshot, &k, &v), "");
+
+    // the pin held by a dead process is released by cleaning it.
+    pid_t pid = fork();
+    if (pid == 0) {
+        st_table_snapshot_init(t, &snapshot);
+        exit(0);
+    }
+
+    waitpid(pid, NULL, 0);
+    st_ut_ne(0, t->pin, "");
+
+    int i = 1;
+    st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(50, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_OK, st_table_reader_clean(table_pool, pid), "");
+    st_ut_eq(0, t->pin, "");
+    st_ut_eq(49, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_snapshot_init(NULL, &snapshot), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_snapshot_init(t, NULL), "");
+
+    // elements are collected in batches.
+    for (int i = 0; i < ST_TABLE_SNAPSHOT_BATCH * 2 + 1; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(other, key, value), "");
+    }
+
+    st_ut_eq(ST_OK, st_table_snapshot_init(other, &snapshot), "");
+    st_ut_eq(ST_TABLE_SNAPSHOT_BATCH * 2 + 1, snapshot.cnt, "");
+    st_ut_eq(ST_OK, st_table_snapshot_destroy(&snapshot), "");
+
+    st_table_remove_all(other);
+    st_table_free(other);
+    st_table_remove_all(t);
+    st_table_free(t);
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, borrow) {
+
+    st_table_t *t;
+    st_table_t *sub;
+    st_str_t v;
+    st_table_borrow_t borrow;
+    int value_buf[40] = {0};
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    st_table_new(table_pool, &t);
+    st_table_new(table_pool, &sub);
+
+    for (int i = 0; i < 10; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        value_buf[0] = i;
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    int k = 1;
+    st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+    st_ut_eq(ST_OK, st_table_borrow_begin(table_pool, &borrow), "");
+    st_ut_eq(0, t->pin, "");
+
+    // only the table borrowed from is pinned, and only once.
+    st_ut_eq(ST_OK, st_table_borrow_value(&borrow, t, key, &v), "");
+    st_ut_eq(1, *(int *)v.bytes, "");
+    st_ut_eq(sizeof(value_buf), v.len, "");
+    st_ut_ne(0, t->pin, "");
+    st_ut_eq(0, sub->pin, "");
+
+    st_ut_eq(ST_OK, st_table_borrow_value(&borrow, t, key, &v), "");
+    st_ut_eq(1, borrow.pin_cnt, "");
+    st_ut_eq(1, table_pool->pins[t->pin - 1].holder_cnt, "");
+
+    // borrowed value is neither overwritten in place nor freed.
+    value_buf[0] = 100;
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+    st_ut_eq(1, *(int *)v.bytes, "");
+
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(11, remain_element_cnt(table_pool, element_size), "");
+    st_ut_eq(1, *(int *)v.bytes, "");
+
+    st_ut_eq(ST_NOT_FOUND, st_table_borrow_value(&borrow, t, key, &v), "");
+
+    k = 100;
+    st_str_t tvalue = st_str_wrap_common(&sub, ST_TYPES_TABLE, sizeof(sub));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, tvalue), "");
+    st_ut_eq(ST_UNSUPPORTED, st_table_borrow_value(&borrow, t, key, &v), "");
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_borrow_value(NULL, t, key, &v), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_borrow_value(&borrow, NULL, key, &v), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_borrow_value(&borrow, t, key, NULL), "");
+
+    st_ut_eq(ST_OK, st_table_borrow_end(&borrow), "");
+    st_ut_eq(0, t->pin, "");
+    st_ut_eq(ST_ARG_INVALID, st_table_borrow_end(&borrow), "");
+
+    // value is overwritten in place without guard.
+    k = 2;
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &v), "");
+
+    value_buf[0] = 200;
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+    st_ut_eq(200, *(int *)v.bytes, "");
+
+    // retired elements are freed by the next retiring without guard.
+    k = 3;
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(8, remain_element_cnt(table_pool, element_size), "");
+
+    // the pin held by a dead process is released by cleaning it.
+    pid_t pid = fork();
+    if (pid == 0) {
+        k = 4;
+        st_table_borrow_begin(table_pool, &borrow);
+        st_table_borrow_value(&borrow, t, key, &v);
+        exit(0);
+    }
+
+    waitpid(pid, NULL, 0);
+    st_ut_ne(0, t->pin, "");
+
+    k = 4;
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(8, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_OK, st_table_reader_clean(table_pool, pid), "");
+    st_ut_eq(0, t->pin, "");
+
+    k = 5;
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(6, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_borrow_begin(NULL, &borrow), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_borrow_begin(table_pool, NULL), "");
+
+    st_table_remove_all(t);
+    st_table_free(t);
+    free_table_pool(table_pool, shm_fd);
+}
+
+void add_sub_table(st_table_t *table, char *name, st_table_t *sub) {
+
+    char key_buf[11] = {0};
+    int value_buf[40] = {0};
+
+    memcpy(key_buf, name, strlen(name));
+    st_str_t key = st_str_wrap(key_buf, strlen(key_buf));
+
+    memcpy(value_buf, &sub, (size_t)sizeof(sub));
+    st_str_t value = st_str_wrap_common(value_buf, ST_TYPES_TABLE, sizeof(value_buf));
+
+    st_assert(st_table_add_key_value(table, key, value) == ST_OK);
+}
+
+st_test(table, cache_limit) {
+
+    st_table_t *t;
+    st_table_t *sub;
+    st_str_t found;
+    int value_buf[40] = {0};
+    int shm_fd;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+    int64_t slab_size = st_slab_obj_size(element_size);
+
+    st_table_new(table_pool, &t);
+    st_ut_eq(ST_OK, st_gc_add_root(&table_pool->gc, &t->gc_head), "");
+
+    for (int i = 1; i <= 10; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    st_ut_eq(10 * slab_size, t->used_bytes, "");
+
+    // elements have no cache tail before cache mode is enabled.
+    st_ut_eq(1, st_list_empty(&t->clock), "");
+
+    // elements added before cache mode is enabled are copied with cache tail,
+    // and evicted in key order.
+    st_ut_eq(ST_OK, st_table_set_cache_limit(t, 8, 0), "");
+    st_ut_eq(8, t->element_cnt, "");
+    st_ut_eq(8, remain_element_cnt(table_pool, element_size), "");
+
+    for (int i = 1; i <= 10; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(i <= 2 ? ST_NOT_FOUND : ST_OK, st_table_get_value(t, key, &found), "");
+    }
+
+    // new elements and 3 to 10 are referenced, the clock hand clears all of
+    // them at the first pass.
+    for (int i = 11; i <= 12; i++) {
+        st_str_t key = st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+        st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+        st_ut_eq(8, t->element_cnt, "");
+    }
+
+    int evicted[] = {3, 4};
+    for (int i = 0; i < st_nelts(evicted); i++) {
+        st_str_t key = st_str_wrap_common(&evicted[i], ST_TYPES_INTEGER, sizeof(int));
+        st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+    }
+
+    // 5 is read again, 6 is not.
+    int k = 5;
+    st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+
+    k = 13;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+
+    k = 6;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+
+    k = 5;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+
+    // byte limit.
+    st_ut_eq(ST_OK, st_table_set_cache_limit(t, 0, 4 * slab_size), "");
+    st_ut_eq(4, t->element_cnt, "");
+    st_ut_eq(4 * slab_size, t->used_bytes, "");
+    st_ut_eq(4, remain_element_cnt(table_pool, element_size), "");
+
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(3 * slab_size, t->used_bytes, "");
+
+    // table referenced by evicted element is freed by gc.
+    st_ut_eq(ST_OK, st_table_set_cache_limit(t, 1, 0), "");
+
+    st_table_new(table_pool, &sub);
+    add_sub_table(t, "sub", sub);
+    st_ut_eq(1, t->element_cnt, "");
+    st_ut_eq(2, remain_table_cnt(table_pool), "");
+
+    k = 1;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    st_ut_eq(1, t->element_cnt, "");
+
+    run_gc_one_round(&table_pool->gc);
+    run_gc_one_round(&table_pool->gc);
+    st_ut_eq(1, remain_table_cnt(table_pool), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(0, t->used_bytes, "");
+    st_ut_eq(1, st_list_empty(&t->clock), "");
+
+    st_ut_eq(ST_ARG_INVALID, st_table_set_cache_limit(t, -1, 0), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_set_cache_limit(NULL, 1, 0), "");
+
+    st_ut_eq(ST_OK, st_gc_remove_root(&table_pool->gc, &t->gc_head, 0), "");
+    st_table_free(t);
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, ttl) {
+
+    st_table_t *t;
+    st_table_t *sub;
+    st_table_iter_t iter;
+    st_str_t key;
+    st_str_t found;
+    int value_buf[40] = {0};
+    int shm_fd;
+    int64_t now = 0;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    st_table_new(table_pool, &t);
+    st_ut_eq(ST_OK, st_gc_add_root(&table_pool->gc, &t->gc_head), "");
+
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+    // 1, 2 and 5 expire soon, 3 expires one hour later, 4 never expires.
+    int64_t ttls[] = {100 * 1000, 100 * 1000, 3600LL * 1000 * 1000, 0, 100 * 1000};
+
+    for (int i = 1; i <= 5; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        if (ttls[i - 1] == 0) {
+            st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+        } else {
+            st_ut_eq(ST_OK, st_table_set_key_value_ex(t, key, value, ttls[i - 1]), "");
+        }
+    }
+
+    st_ut_eq(5, t->element_cnt, "");
+    st_ut_ne(NULL, t->ttl, "");
+
+    int k = 1;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+
+    usleep(150 * 1000);
+
+    // expired elements are invisible but still in table until they are reaped.
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value_copy(t, key, &found), "");
+    st_ut_eq(5, t->element_cnt, "");
+
+    st_ut_eq(ST_OK, st_table_iter_init(t, &iter, NULL, 0), "");
+
+    int visible[] = {3, 4};
+    for (int i = 0; i < st_nelts(visible); i++) {
+        st_str_t expected = st_str_wrap_common(&visible[i], ST_TYPES_INTEGER, sizeof(int));
+
+        st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &key, &found), "");
+        st_ut_eq(0, st_str_cmp(&key, &expected), "");
+    }
+
+    st_ut_eq(ST_ITER_FINISH, st_table_iter_next(t, &iter, &key, &found), "");
+
+    // expired key can be added again, and setting without ttl makes it
+    // persistent.
+    k = 1;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+
+    k = 3;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_set_key_value(t, key, value), "");
+
+    st_ut_eq(5, t->element_cnt, "");
+    st_ut_eq(5, remain_element_cnt(table_pool, element_size), "");
+
+    // expired elements are reaped by gc after their slot of the wheel passed.
+    st_ut_eq(ST_OK, st_time_in_usec(&now), "");
+    usleep(ST_TABLE_TTL_SLOT_USEC - now % ST_TABLE_TTL_SLOT_USEC + 50 * 1000);
+
+    run_gc_one_round(&table_pool->gc);
+
+    st_ut_eq(3, t->element_cnt, "");
+    st_ut_eq(3, remain_element_cnt(table_pool, element_size), "");
+
+    for (int i = 0; i < ST_TABLE_TTL_SLOT_CNT; i++) {
+        st_ut_eq(1, st_list_empty(&t->ttl->slots[i]), "");
+    }
+
+    // table value can not expire.
+    st_table_new(table_pool, &sub);
+    memcpy(value_buf, &sub, sizeof(sub));
+    st_str_t tvalue = st_str_wrap_common(value_buf, ST_TYPES_TABLE, sizeof(value_buf));
+
+    st_ut_eq(ST_ARG_INVALID, st_table_set_key_value_ex(t, key, tvalue, 1000), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_set_key_value_ex(t, key, value, 0), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_set_key_value_ex(NULL, key, value, 1000), "");
+    st_table_free(sub);
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_gc_remove_root(&table_pool->gc, &t->gc_head, 0), "");
+    st_table_free(t);
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, ttl_slot_processed_in_steps) {
+
+    st_table_t *t;
+    st_str_t key;
+    int value_buf[40] = {0};
+    int shm_fd;
+    int64_t now = 0;
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int max_cnt = table_pool->gc.max_free_cnt;
+    int cnt = max_cnt * 4;
+
+    st_table_new(table_pool, &t);
+    st_ut_eq(ST_OK, st_gc_add_root(&table_pool->gc, &t->gc_head), "");
+
+    st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+    // add all keys at the beginning of a slot, so that they are in one slot.
+    st_ut_eq(ST_OK, st_time_in_usec(&now), "");
+    usleep(ST_TABLE_TTL_SLOT_USEC - now % ST_TABLE_TTL_SLOT_USEC + 10 * 1000);
+
+    st_ut_eq(ST_OK, st_time_in_usec(&now), "");
+    int64_t slot = now / ST_TABLE_TTL_SLOT_USEC;
+
+    // keys expiring a round of the wheel later are before the expiring one.
+    for (int i = 1; i <= cnt + 1; i++) {
+        int64_t ttl = (int64_t)ST_TABLE_TTL_SLOT_CNT * ST_TABLE_TTL_SLOT_USEC;
+        if (i == cnt + 1) {
+            ttl = 100 * 1000;
+        }
+
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(ST_OK, st_table_set_key_value_ex(t, key, value, ttl), "");
+    }
+
+    st_ut_eq(ST_OK, st_time_in_usec(&now), "");
+    st_ut_eq(slot, now / ST_TABLE_TTL_SLOT_USEC, "");
+
+    usleep(ST_TABLE_TTL_SLOT_USEC - now % ST_TABLE_TTL_SLOT_USEC + 10 * 1000);
+
+    // elements not expired are checked once, the slot is finished in steps.
+    for (int i = 0; i < cnt / max_cnt + 1; i++) {
+        int visited_cnt = 0;
+
+        st_ut_eq(ST_OK, st_table_expire(table_pool, max_cnt, &visited_cnt), "");
+        st_ut_ge(max_cnt, visited_cnt, "");
+    }
+
+    st_ut_eq(cnt, t->element_cnt, "");
+    st_ut_eq(slot + 1, t->ttl->next_slot, "");
+    st_ut_eq(1, st_list_empty(&t->ttl->checked), "");
+
+    int remained = 0;
+    st_list_t *node = NULL;
+
+    st_list_for_each(node, &t->ttl->slots[slot % ST_TABLE_TTL_SLOT_CNT]) {
+        remained++;
+    }
+
+    st_ut_eq(cnt, remained, "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_gc_remove_root(&table_pool->gc, &t->gc_head, 0), "");
+    st_table_free(t);
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, sharded) {
+
+    st_table_t *t;
+    st_table_t *sub;
+    st_table_iter_t iter;
+    st_str_t key;
+    st_str_t found;
+    int shm_fd;
+    int slots[ST_TABLE_MAX_SHARD_CNT];
+
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    st_ut_eq(ST_ARG_INVALID, st_table_new_sharded(table_pool, 1, &t), "");
+    st_ut_eq(ST_ARG_INVALID, st_table_new_sharded(table_pool, ST_TABLE_MAX_SHARD_CNT + 1, &t), "");
+
+    st_ut_eq(ST_OK, st_table_new_sharded(table_pool, 4, &t), "");
+    st_ut_eq(ST_OK, st_gc_add_root(&table_pool->gc, &t->gc_head), "");
+    st_ut_eq(5, remain_table_cnt(table_pool), "");
+
+    // shards are in the order of address, as transaction locks tables.
+    for (int i = 1; i < t->shard_cnt; i++) {
+        st_ut_lt((uintptr_t)t->shards[i - 1], (uintptr_t)t->shards[i], "");
+    }
+
+    for (int i = 1; i <= 100; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, key), "");
+    }
+
+    // keys are spread among shards, and the table itself has no element.
+    int64_t total = 0;
+    for (int i = 0; i < t->shard_cnt; i++) {
+        st_ut_gt(t->shards[i]->element_cnt, 0, "");
+        total += t->shards[i]->element_cnt;
+    }
+
+    st_ut_eq(100, total, "");
+    st_ut_eq(0, t->element_cnt, "");
+
+    for (int i = 1; i <= 100; i++) {
+        key = (st_str_t)st_str_wrap_common(&i, ST_TYPES_INTEGER, sizeof(i));
+
+        st_table_t *shard = st_table_shard_of(t, key);
+        st_ut_eq(ST_OK, st_table_get_value(shard, key, &found), "");
+        st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+        st_ut_eq(i, *(int *)found.bytes, "");
+
+        st_ut_eq(ST_OK, st_table_get_value_copy(t, key, &found), "");
+        st_ut_eq(i, *(int *)found.bytes, "");
+        st_str_destroy(&found);
+    }
+
+    // shards are merged in key order.
+    st_table_rdlock_all(t, slots);
+
+    int k = 50;
+    st_str_t init_key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_iter_init(t, &iter, &init_key, ST_SIDE_RIGHT_EQ), "");
+
+    for (int i = 50; i <= 100; i++) {
+        st_ut_eq(ST_OK, st_table_iter_next(t, &iter, &key, &found), "");
+        st_ut_eq(i, *(int *)key.bytes, "");
+    }
+
+    st_ut_eq(ST_ITER_FINISH, st_table_iter_next(t, &iter, &key, &found), "");
+
+    st_ut_eq(ST_OK, st_table_iter_init(t, &iter, NULL, 0), "");
+
+    st_table_rdunlock_all(t, slots);
+
+    // any shard modified is a modification of the table.
+    k = 7;
+    key = (st_str_t)st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+    st_ut_eq(ST_OK, st_table_remove_key(t, key), "");
+    st_ut_eq(ST_NOT_FOUND, st_table_get_value(t, key, &found), "");
+
+    st_table_rdlock_all(t, slots);
+    st_ut_eq(ST_TABLE_MODIFIED, st_table_iter_next(t, &iter, &key, &found), "");
+    st_table_rdunlock_all(t, slots);
+
+    st_ut_eq(ST_UNSUPPORTED, st_table_get_version(t), "");
+    st_ut_eq(ST_UNSUPPORTED, st_table_set_if_version(t, key, key, 0), "");
+
+    // set_many writes every shard once, and the later value of a key wins.
+    int many_keys[21];
+    int many_values[21];
+    st_str_t keys[21];
+    st_str_t values[21];
+    int64_t versions[ST_TABLE_MAX_SHARD_CNT];
+
+    for (int i = 0; i < 21; i++) {
+        many_keys[i] = i < 20 ? i + 1 : 3;
+        many_values[i] = 1000 + i;
+
+        keys[i] = (st_str_t)st_str_wrap_common(&many_keys[i], ST_TYPES_INTEGER, sizeof(int));
+        values[i] = (st_str_t)st_str_wrap_common(&many_values[i], ST_TYPES_INTEGER, sizeof(int));
+    }
+
+    for (int i = 0; i < t->shard_cnt; i++) {
+        versions[i] = t->shards[i]->version;
+    }
+
+    st_ut_eq(ST_OK, st_table_set_many(t, keys, values, 21), "");
+
+    for (int i = 0; i < t->shard_cnt; i++) {
+        st_ut_eq(versions[i] + 2, t->shards[i]->version, "");
+    }
+
+    for (int i = 0; i < 20; i++) {
+        st_ut_eq(ST_OK, st_table_get_value(t, keys[i], &found), "");
+        st_ut_eq(i == 2 ? 1020 : 1000 + i, *(int *)found.bytes, "");
+    }
+
+    // table value in a shard is reachable from the sharded table.
+    st_table_new(table_pool, &sub);
+    add_sub_table(t, "sub", sub);
+
+    run_gc_one_round(&table_pool->gc);
+    run_gc_one_round(&table_pool->gc);
+    st_ut_eq(6, remain_table_cnt(table_pool), "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+
+    run_gc_one_round(&table_pool->gc);
+    run_gc_one_round(&table_pool->gc);
+    st_ut_eq(5, remain_table_cnt(table_pool), "");
+
+    st_ut_eq(ST_OK, st_gc_remove_root(&table_pool->gc, &t->gc_head, 0), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+    st_ut_eq(0, remain_table_cnt(table_pool), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+st_test(table, add_remove_table) {
+
+    st_table_t *root, *table, *t;
+    char key_buf[11] = {0};
+    int value_buf[40] = {0};
+    int shm_fd;
+
+    int element_size = sizeof(st_table_element_t) + sizeof(key_buf) + sizeof(value_buf);
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    st_table_new(table_pool, &root);
+    st_ut_eq(st_gc_add_root(&table_pool->gc, &root->gc_head), ST_OK, "");
+
+    st_table_new(table_pool, &table);
+    add_sub_table(root, "test_table", table);
+
+    st_ut_eq(2, remain_table_cnt(table_pool), "");
+    st_ut_eq(1, remain_element_cnt(table_pool, element_size), "");
+
+    for (int i = 0; i < 100; i++) {
+        sprintf(key_buf, "%010d", i);
+        st_table_new(table_pool, &t);
+        add_sub_table(table, key_buf, t);
+
+        st_ut_eq(i + 3, remain_table_cnt(table_pool), "");
+        st_ut_eq(i + 2, remain_element_cnt(table_pool, element_size), "");
+    }
+
+    for (int i = 0; i < 100; i++) {
+        sprintf(key_buf, "%010d", i);
+        st_str_t key = st_str_wrap(key_buf, strlen(key_buf));
+        st_ut_eq(ST_OK, st_table_remove_key(table, key), "");
+
+        run_gc_one_round(&table_pool->gc);
+        run_gc_one_round(&table_pool->gc);
+
+        st_ut_eq(101 - i, remain_table_cnt(table_pool), "");
+        st_ut_eq(100 - i, remain_element_cnt(table_pool, element_size), "");
+    }
+
+    st_ut_eq(ST_OK, st_table_remove_all(root), "");
+    run_gc_one_round(&table_pool->gc);
+
+    st_ut_eq(ST_OK, st_gc_remove_root(&table_pool->gc, &root->gc_head, 0), "");
+    st_ut_eq(ST_OK, st_table_free(root), "");
+
+    st_ut_eq(0, remain_table_cnt(table_pool), "");
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    free_table_pool(table_pool, shm_fd);
+}
+
+int block_all_children(int sem_id) {
+    union semun sem_args;
+    sem_args.val = 0;
+
+    int ret = semctl(sem_id, 0, SETVAL, sem_args);
+    if (ret == -1) {
+        return ST_ERR;
+    }
+
+    return ST_OK;
+}
+
+int wakeup_all_children(int sem_id, int children_cnt) {
+    struct sembuf sem = {.sem_num = 0, .sem_op = children_cnt, .sem_flg = SEM_UNDO};
+
+    int ret = semop(sem_id, &sem, 1);
+    if (ret == -1) {
+        return ST_ERR;
+    }
+
+    return ST_OK;
+}
+
+int wait_sem(int sem_id) {
+    struct sembuf sem = {.sem_num = 0, .sem_op = -1, .sem_flg = SEM_UNDO};
+
+    int ret = semop(sem_id, &sem, 1);
+    if (ret == -1) {
+        return ST_ERR;
+    }
+
+    return ST_OK;
+}
+
+static int run_processes(int sem_id, process_f func, void *arg, int *pids,
+                         int process_cnt) {
+
+    int child;
+
+    int ret = block_all_children(sem_id);
+    if (ret == ST_ERR) {
+        return ret;
+    }
+
+    for (int i = 0; i < process_cnt; i++) {
+
+        child = fork();
+
+        if (child == 0) {
+
+            set_process_to_cpu(i);
+
+            ret = wait_sem(sem_id);
+            if (ret == ST_ERR) {
+                exit(ret);
+            }
+
+            ret = func(i, arg);
+            exit(ret);
+        }
+
+        pids[i] = child;
+    }
+
+    sleep(2);
+
+    ret = wakeup_all_children(sem_id, process_cnt);
+    if (ret != ST_OK) {
+        return ret;
+    }
+
+    return wait_children(pids, process_cnt);
+}
+
+static int new_tables(int process_id, st_table_t *root) {
+
+    int ret;
+    st_table_t *t;
+    char key_buf[11] = {0};
+    st_table_pool_t *table_pool = root->pool;
 
     for (int i = 0; i < 100; i++) {
         ret = st_table_new(table_pool, &t);
@@ -732,6 +2923,156 @@ st_test(table, test_table_in_processes) {
     free_table_pool(table_pool, shm_fd);
 }
 
+static int read_write_without_lock(int process_id, st_table_t *table) {
+
+    int ret;
+    int value_buf[40];
+    st_str_t copied = st_str_null;
+
+    for (int round = 0; round < 20000; round++) {
+        int k = round % 64;
+        st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+
+        if (process_id == 0) {
+            for (int i = 0; i < 40; i++) {
+                value_buf[i] = round;
+            }
+
+            st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+
+            // remove and add some keys to make rbtree rotate.
+            if (round % 3 == 0) {
+                ret = st_table_remove_key(table, key);
+                if (ret != ST_OK) {
+                    return ret;
+                }
+            }
+
+            ret = st_table_set_key_value(table, key, value);
+            if (ret != ST_OK) {
+                return ret;
+            }
+
+            continue;
+        }
+
+        ret = st_table_get_value_copy(table, key, &copied);
+        if (ret == ST_AGAIN || ret == ST_NOT_FOUND) {
+            continue;
+        }
+
+        if (ret != ST_OK) {
+            return ret;
+        }
+
+        int *values = (int *)copied.bytes;
+
+        for (int i = 0; i < 40; i++) {
+            if (values[i] != values[0] || values[i] % 64 != k) {
+                return ST_STATE_INVALID;
+            }
+        }
+
+        st_str_destroy(&copied);
+    }
+
+    return ST_OK;
+}
+
+st_test(table, get_value_copy_in_processes) {
+
+    int shm_fd;
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+    int value_buf[40] = {0};
+    int element_size = sizeof(st_table_element_t) + sizeof(int) + sizeof(value_buf);
+
+    int sem_id = semget(5679, 1, 06666 | IPC_CREAT);
+    st_ut_ne(-1, sem_id, "");
+
+    int pids[5];
+
+    st_table_t *t;
+    st_table_new(table_pool, &t);
+
+    for (int k = 0; k < 64; k++) {
+        st_str_t key = st_str_wrap_common(&k, ST_TYPES_INTEGER, sizeof(k));
+
+        for (int i = 0; i < 40; i++) {
+            value_buf[i] = k;
+        }
+
+        st_str_t value = st_str_wrap(value_buf, sizeof(value_buf));
+        st_ut_eq(ST_OK, st_table_add_key_value(t, key, value), "");
+    }
+
+    st_ut_eq(ST_OK, run_processes(sem_id, (process_f)read_write_without_lock, t, pids, 5), "");
+
+    st_ut_eq(ST_OK, st_table_enable_hash_index(t), "");
+
+    st_ut_eq(ST_OK, run_processes(sem_id, (process_f)read_write_without_lock, t, pids, 5), "");
+
+    for (int i = 0; i < ST_TABLE_READER_SLOT_CNT; i++) {
+        st_table_reader_slot_t *slot = &table_pool->reclaim.slots[i];
+        st_ut_eq(0, slot->readers[0] + slot->readers[1], "");
+    }
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    st_ut_eq(0, remain_element_cnt(table_pool, element_size), "");
+
+    semctl(sem_id, 0, IPC_RMID);
+    free_table_pool(table_pool, shm_fd);
+}
+
+static int incr_counter(int process_id, st_table_t *table) {
+
+    int one = 1;
+    char *k = "counter";
+
+    st_str_t key = st_str_wrap(k, strlen(k));
+    st_str_t delta = st_str_wrap_common(&one, ST_TYPES_INTEGER, sizeof(one));
+
+    for (int i = 0; i < 10000; i++) {
+        int ret = st_table_incr(table, key, delta, NULL);
+        if (ret != ST_OK) {
+            return ret;
+        }
+    }
+
+    return ST_OK;
+}
+
+st_test(table, incr_in_processes) {
+
+    int shm_fd;
+    st_table_pool_t *table_pool = alloc_table_pool(&shm_fd);
+
+    int sem_id = semget(5680, 1, 06666 | IPC_CREAT);
+    st_ut_ne(-1, sem_id, "");
+
+    int pids[5];
+
+    st_table_t *t;
+    st_table_new(table_pool, &t);
+
+    st_ut_eq(ST_OK, run_processes(sem_id, (process_f)incr_counter, t, pids, 5), "");
+
+    char *k = "counter";
+    st_str_t key = st_str_wrap(k, strlen(k));
+    st_str_t found;
+
+    st_ut_eq(ST_OK, st_table_get_value(t, key, &found), "");
+    st_ut_eq(50000, *(int *)found.bytes, "");
+    st_ut_eq(1, t->element_cnt, "");
+
+    st_ut_eq(ST_OK, st_table_remove_all(t), "");
+    st_ut_eq(ST_OK, st_table_free(t), "");
+
+    semctl(sem_id, 0, IPC_RMID);
+    free_table_pool(table_pool, shm_fd);
+}
+
 st_test(table, clear_circular_ref_in_same_table) {
 
     st_table_t *root, *t;